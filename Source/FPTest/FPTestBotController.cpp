@@ -0,0 +1,167 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestBotController.h"
+#include "FPTestCharacter.h"
+#include "TP_WeaponComponent.h"
+#include "TP_WeaponSpawnerComponent.h"
+#include "EngineUtils.h"
+
+AFPTestBotController::AFPTestBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AFPTestBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	Random.Initialize(GetUniqueID());
+	HomeLocation = InPawn->GetActorLocation();
+	MoveTarget = HomeLocation;
+
+	SpawnerLocations.Reset();
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		TInlineComponentArray<UTP_WeaponSpawnerComponent*> Spawners(*It);
+		for (const UTP_WeaponSpawnerComponent* Spawner : Spawners)
+		{
+			SpawnerLocations.Add(Spawner->GetComponentLocation());
+		}
+	}
+}
+
+void AFPTestBotController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	AFPTestCharacter* BotCharacter = Cast<AFPTestCharacter>(GetPawn());
+	if (!BotCharacter)
+	{
+		return;
+	}
+
+	UpdateMovement(*BotCharacter, DeltaSeconds);
+	UpdateAim(*BotCharacter, DeltaSeconds);
+
+	if (UTP_WeaponComponent* Weapon = BotCharacter->GetWeapon())
+	{
+		if (!bHadWeapon)
+		{
+			bHadWeapon = true;
+			EnterFireMode(*Weapon);
+		}
+		UpdateFiring(*Weapon, DeltaSeconds);
+	}
+}
+
+void AFPTestBotController::UpdateMovement(AFPTestCharacter& BotCharacter, float DeltaSeconds)
+{
+	const FVector Location = BotCharacter.GetActorLocation();
+
+	// Without a weapon we walk straight to the closest spawner, the pickup overlap does the rest
+	if (!BotCharacter.GetHasRifle() && SpawnerLocations.Num() > 0)
+	{
+		MoveTarget = SpawnerLocations[0];
+		for (const FVector& SpawnerLocation : SpawnerLocations)
+		{
+			if (FVector::DistSquared2D(Location, SpawnerLocation) < FVector::DistSquared2D(Location, MoveTarget))
+			{
+				MoveTarget = SpawnerLocation;
+			}
+		}
+	}
+	else
+	{
+		TimeUntilNewMoveTarget -= DeltaSeconds;
+		if (TimeUntilNewMoveTarget <= 0.0f || FVector::DistSquared2D(Location, MoveTarget) < FMath::Square(100.0f))
+		{
+			const FVector2D Offset = FVector2D(Random.FRandRange(-1.0f, 1.0f), Random.FRandRange(-1.0f, 1.0f)) * WanderRadius;
+			MoveTarget = HomeLocation + FVector(Offset, 0.0f);
+			TimeUntilNewMoveTarget = Random.FRandRange(3.0f, 6.0f);
+		}
+	}
+
+	// No pathfinding, so the load test also runs on maps without a nav mesh
+	const FVector Direction = (MoveTarget - Location).GetSafeNormal2D();
+	BotCharacter.AddMovementInput(Direction);
+}
+
+void AFPTestBotController::UpdateAim(AFPTestCharacter& BotCharacter, float DeltaSeconds)
+{
+	TimeUntilNewAimTarget -= DeltaSeconds;
+	if (TimeUntilNewAimTarget <= 0.0f || !AimTarget.IsValid())
+	{
+		TimeUntilNewAimTarget = 0.5f;
+		AimTarget.Reset();
+
+		float ClosestDistanceSquared = TNumericLimits<float>::Max();
+		for (TActorIterator<AFPTestCharacter> It(GetWorld()); It; ++It)
+		{
+			const float DistanceSquared = FVector::DistSquared(It->GetActorLocation(), BotCharacter.GetActorLocation());
+			if (*It != &BotCharacter && DistanceSquared < ClosestDistanceSquared)
+			{
+				ClosestDistanceSquared = DistanceSquared;
+				AimTarget = *It;
+			}
+		}
+	}
+
+	const FVector AimLocation = AimTarget.IsValid() ? AimTarget->GetActorLocation() : MoveTarget;
+	SetControlRotation((AimLocation - BotCharacter.GetActorLocation()).Rotation());
+}
+
+void AFPTestBotController::UpdateFiring(UTP_WeaponComponent& Weapon, float DeltaSeconds)
+{
+	if (Weapon.CurrentAmmunition <= 0)
+	{
+		Weapon.Reload();
+	}
+
+	TimeInFireMode += DeltaSeconds;
+	if (TimeInFireMode >= ModeCycleSeconds)
+	{
+		Weapon.ToggleType();
+		EnterFireMode(Weapon);
+	}
+
+	switch (Weapon.ShootType)
+	{
+	case EWeaponShootType::Single:
+		TimeSinceShot += DeltaSeconds;
+		if (TimeSinceShot >= SingleFireInterval)
+		{
+			TimeSinceShot = 0.0f;
+			Weapon.HoldTrigger();
+		}
+		break;
+	case EWeaponShootType::Automatic:
+		Weapon.HoldTrigger();
+		break;
+	case EWeaponShootType::Charged:
+		if (!bCharging)
+		{
+			bCharging = true;
+			TimeCharging = 0.0f;
+			Weapon.PressTrigger();
+		}
+		TimeCharging += DeltaSeconds;
+		if (TimeCharging >= ChargeSeconds)
+		{
+			bCharging = false;
+			Weapon.HoldTrigger();
+		}
+		break;
+	}
+}
+
+void AFPTestBotController::EnterFireMode(UTP_WeaponComponent& Weapon)
+{
+	TimeInFireMode = 0.0f;
+	TimeSinceShot = SingleFireInterval;
+	bCharging = false;
+
+	if (Weapon.ShootType == EWeaponShootType::Automatic)
+	{
+		Weapon.PressTrigger();
+	}
+}
@@ -0,0 +1,76 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "Math/RandomStream.h"
+#include "FPTestBotController.generated.h"
+
+class AFPTestCharacter;
+class UTP_WeaponComponent;
+
+/**
+ * Simple bot used by the load test
+ * Walks to the closest weapon spawner until it has a weapon, then wanders around and fires continuously,
+ * switching through all fire modes of the weapon
+ */
+UCLASS()
+class FPTEST_API AFPTestBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AFPTestBotController();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Seconds the bot stays in a fire mode before toggling to the next one */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bot)
+	float ModeCycleSeconds = 5.0f;
+
+	/** Seconds between two shots in the Single fire mode */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bot)
+	float SingleFireInterval = 0.3f;
+
+	/** Seconds a charged shot gets charged */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bot)
+	float ChargeSeconds = 1.0f;
+
+	/** Radius around the spawn location the bot wanders in */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bot)
+	float WanderRadius = 3000.0f;
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+
+private:
+	/** Walks to a weapon or wanders around */
+	void UpdateMovement(AFPTestCharacter& BotCharacter, float DeltaSeconds);
+
+	/** Aims at the closest other character */
+	void UpdateAim(AFPTestCharacter& BotCharacter, float DeltaSeconds);
+
+	/** Fires with the current fire mode, reloads and toggles the fire mode */
+	void UpdateFiring(UTP_WeaponComponent& Weapon, float DeltaSeconds);
+
+	/** Starts the fire mode the weapon is in now */
+	void EnterFireMode(UTP_WeaponComponent& Weapon);
+
+	/** Locations of all weapon spawners in the world */
+	TArray<FVector> SpawnerLocations;
+
+	/** Character we aim at */
+	TWeakObjectPtr<AFPTestCharacter> AimTarget;
+
+	FRandomStream Random;
+	FVector HomeLocation = FVector::ZeroVector;
+	FVector MoveTarget = FVector::ZeroVector;
+	float TimeUntilNewMoveTarget = 0.0f;
+	float TimeUntilNewAimTarget = 0.0f;
+	float TimeInFireMode = 0.0f;
+	float TimeSinceShot = 0.0f;
+	float TimeCharging = 0.0f;
+	bool bCharging = false;
+	bool bHadWeapon = false;
+};
@@ -7,10 +7,13 @@
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 
+#include "FPTestCosmetics.h"
 #include "FPTestGameMode.h"
+#include "FPTestLagCompensationSubsystem.h"
+#include "FPTestSignificanceSubsystem.h"
 
 #include "Net/UnrealNetwork.h"
-#include <Kismet/GameplayStatics.h>
+#include "Net/Core/PushModel/PushModel.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -59,26 +62,83 @@ void AFPTestCharacter::BeginPlay()
 		}
 	}
 
+	// Both meshes are only for the looks, the capsule does the collision and the hits
+	if (FFPTestCosmetics::AreStripped(GetWorld()))
+	{
+		FFPTestCosmetics::StripMesh(Mesh1P);
+		FFPTestCosmetics::StripMesh(GetMesh());
+	}
+	else if (UFPTestSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UFPTestSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterCharacter(this);
+	}
+
+	// The server keeps a history of our capsule, so shots can be rewound to what the shooter saw
+	if (HasAuthority())
+	{
+		if (UFPTestLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UFPTestLagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+}
+
+void AFPTestCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UFPTestSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UFPTestSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterCharacter(this);
+	}
+
+	if (UFPTestLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UFPTestLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
-void AFPTestCharacter::Server_OnDamageTaken_Implementation(uint32 Damage)
+bool AFPTestCharacter::ApplyDamage(int32 Damage, AFPTestGameMode* GameMode)
 {
 	// Reduce health by the damage amount
-	Health -= Damage;
-	if (Health < 0)
+	int32 NewHealth = Health - Damage;
+	if (NewHealth < 0)
 	{
 		// This logic handles the respawn
 		// just did it for fun, gets the player start and teleports the player there instantly
-		AFPTestGameMode* GameMode = Cast<AFPTestGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
-		AActor* PlayerStart = GameMode->FindPlayerStart(GetController());
+		AActor* PlayerStart = GameMode ? GameMode->ChooseRespawnPoint(GetController()) : nullptr;
 		if (!PlayerStart)
-			return;
+		{
+			SetHealth(NewHealth);
+			return false;
+		}
 
 		// Also recover Health
-		Health = MaxHealth;
+		// Damage of the frame beyond our health is gone, it hit us where we were before the respawn
+		SetHealth(MaxHealth);
 		SetActorLocation(PlayerStart->GetActorLocation());
+		return true;
+	}
+
+	SetHealth(NewHealth);
+	return false;
+}
+
+void AFPTestCharacter::SetHealth(int32 NewHealth)
+{
+	if (Health == NewHealth)
+	{
+		return;
 	}
 
+	// Only marked dirty when it changed, so the health is not compared every net update
+	Health = NewHealth;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AFPTestCharacter, Health, this);
+	OnHealthChanged.Broadcast(Health);
+}
+
+void AFPTestCharacter::OnRep_Health()
+{
 	OnHealthChanged.Broadcast(Health);
 }
 
@@ -130,10 +190,37 @@ void AFPTestCharacter::Look(const FInputActionValue& Value)
 
 void AFPTestCharacter::SetHasRifle(bool bNewHasRifle)
 {
+	if (bHasRifle == bNewHasRifle)
+	{
+		return;
+	}
+
 	bHasRifle = bNewHasRifle;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AFPTestCharacter, bHasRifle, this);
 }
 
 bool AFPTestCharacter::GetHasRifle()
 {
 	return bHasRifle;
-}
\ No newline at end of file
+}
+
+void AFPTestCharacter::SetWeapon(UTP_WeaponComponent* NewWeapon)
+{
+	Weapon = NewWeapon;
+}
+
+UTP_WeaponComponent* AFPTestCharacter::GetWeapon() const
+{
+	return Weapon;
+}
+
+void AFPTestCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Push based, they are only compared when they got marked dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AFPTestCharacter, Health, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AFPTestCharacter, bHasRifle, Params);
+}
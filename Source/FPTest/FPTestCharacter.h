@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "InputActionValue.h"
+#include "FPTestSignificance.h"
 #include "FPTestCharacter.generated.h"
 
 class UInputComponent;
@@ -13,6 +14,8 @@ class USceneComponent;
 class UCameraComponent;
 class UAnimMontage;
 class USoundBase;
+class UTP_WeaponComponent;
+class AFPTestGameMode;
 
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnHealthChanged, int32, NewHealth);
@@ -32,7 +35,7 @@ public:
 	int32 MaxHealth = 30;
 
 	// Property to replicate with RepNotify
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
+	UPROPERTY(ReplicatedUsing = OnRep_Health, VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
 	int32 Health=0;
 
 	/** Pawn mesh: 1st person view (arms; seen only by self) */
@@ -62,18 +65,22 @@ public:
 protected:
 	virtual void BeginPlay();
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 
-	/** Called when the Character receives Damage */
-	UFUNCTION(Server, reliable)
-	void Server_OnDamageTaken(uint32 Damage);
+	/**
+	 * Applies the damage of all hits of a frame, only called on the server by the damage subsystem
+	 * Returns true if we died and got respawned
+	 */
+	bool ApplyDamage(int32 Damage, AFPTestGameMode* GameMode);
 		
 	/** Look Input Action */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* LookAction;
 
 	/** Bool for AnimBP to switch to another animation set */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Weapon)
+	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadOnly, Category = Weapon)
 	bool bHasRifle;
 
 	/** Setter to set the bool */
@@ -84,6 +91,19 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	bool GetHasRifle();
 
+	/** Setter for the weapon we carry */
+	void SetWeapon(UTP_WeaponComponent* NewWeapon);
+
+	/** Weapon we carry, null if we have none */
+	UFUNCTION(BlueprintCallable, Category = Weapon)
+	UTP_WeaponComponent* GetWeapon() const;
+
+	/** Bucket the significance subsystem put us in, always High where it does not run */
+	EFPTestSignificance GetSignificance() const { return Significance; }
+
+	/** Only called by the significance subsystem */
+	void SetSignificance(EFPTestSignificance NewSignificance) { Significance = NewSignificance; }
+
 protected:
 	/** Called for movement input */
 	void Move(const FInputActionValue& Value);
@@ -91,6 +111,22 @@ protected:
 	/** Called for looking input */
 	void Look(const FInputActionValue& Value);
 
+	/** Sets the health and lets it replicate */
+	void SetHealth(int32 NewHealth);
+
+	/** Lets the clients know about the new health */
+	UFUNCTION()
+	void OnRep_Health();
+
+	// Override Replicate Properties function
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Weapon we carry */
+	UPROPERTY(Transient)
+	TObjectPtr<UTP_WeaponComponent> Weapon;
+
+	EFPTestSignificance Significance = EFPTestSignificance::High;
+
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
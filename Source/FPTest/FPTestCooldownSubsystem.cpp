@@ -0,0 +1,80 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestCooldownSubsystem.h"
+#include "FPTestStats.h"
+#include "TP_WeaponSpawnerComponent.h"
+#include "Engine/World.h"
+
+void UFPTestCooldownSubsystem::ScheduleRespawn(UTP_WeaponSpawnerComponent* Spawner, float Delay)
+{
+	UWorld* const World = GetWorld();
+	if (!World || !Spawner)
+	{
+		return;
+	}
+
+	const double Deadline = World->GetTimeSeconds() + Delay;
+	RespawnDeadlines.Add(Deadline);
+	RespawnSpawners.Add(Spawner);
+	NextRespawnDeadline = FMath::Min(NextRespawnDeadline, Deadline);
+}
+
+void UFPTestCooldownSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWorld* const World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	const double Now = World->GetTimeSeconds();
+	if (Now < NextRespawnDeadline)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(Cooldowns);
+
+	// Collect everything that is due first, spawning might schedule new respawns
+	TArray<TPair<double, TWeakObjectPtr<UTP_WeaponSpawnerComponent>>, TInlineAllocator<8>> DueRespawns;
+	NextRespawnDeadline = TNumericLimits<double>::Max();
+	for (int32 Index = RespawnDeadlines.Num() - 1; Index >= 0; Index--)
+	{
+		if (RespawnDeadlines[Index] <= Now)
+		{
+			DueRespawns.Emplace(RespawnDeadlines[Index], RespawnSpawners[Index]);
+			RespawnDeadlines.RemoveAtSwap(Index, 1, false);
+			RespawnSpawners.RemoveAtSwap(Index, 1, false);
+		}
+		else
+		{
+			NextRespawnDeadline = FMath::Min(NextRespawnDeadline, RespawnDeadlines[Index]);
+		}
+	}
+
+	// The swap removal mixed up the order, respawn in the order the deadlines passed
+	DueRespawns.Sort([](const TPair<double, TWeakObjectPtr<UTP_WeaponSpawnerComponent>>& A, const TPair<double, TWeakObjectPtr<UTP_WeaponSpawnerComponent>>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	for (const TPair<double, TWeakObjectPtr<UTP_WeaponSpawnerComponent>>& Respawn : DueRespawns)
+	{
+		if (UTP_WeaponSpawnerComponent* Spawner = Respawn.Value.Get())
+		{
+			Spawner->SpawnWeapon();
+		}
+	}
+}
+
+TStatId UFPTestCooldownSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestCooldownSubsystem, STATGROUP_Tickables);
+}
+
+bool UFPTestCooldownSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,42 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestCooldownSubsystem.generated.h"
+
+class UTP_WeaponSpawnerComponent;
+
+/**
+ * Keeps the weapon respawns of a world in flat arrays
+ * Respawns are checked once per tick instead of having one timer with a lambda per pickup
+ * The fire cooldowns of the weapons are part of their simulation, see FFPTestWeaponSimulation
+ */
+UCLASS()
+class FPTEST_API UFPTestCooldownSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Lets the spawner spawn its weapon again after the delay */
+	void ScheduleRespawn(UTP_WeaponSpawnerComponent* Spawner, float Delay);
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Time at which each respawn is due */
+	TArray<double> RespawnDeadlines;
+
+	/** Spawner of each respawn, same index as RespawnDeadlines */
+	TArray<TWeakObjectPtr<UTP_WeaponSpawnerComponent>> RespawnSpawners;
+
+	/** Earliest of all respawn deadlines, so most ticks do nothing */
+	double NextRespawnDeadline = TNumericLimits<double>::Max();
+};
@@ -0,0 +1,38 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestCosmetics.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+
+static int32 GFPTestCosmeticsStrip = 1;
+static FAutoConsoleVariableRef CVarFPTestCosmeticsStrip(
+	TEXT("FPTest.Cosmetics.Strip"),
+	GFPTestCosmeticsStrip,
+	TEXT("1: Dedicated servers and headless games skip cosmetic meshes, animation and effects, for actors beginning play afterwards.\n")
+	TEXT("0: Everybody does all of it."));
+
+bool FFPTestCosmetics::AreStripped(const UWorld* World)
+{
+	return GFPTestCosmeticsStrip != 0 && World && (World->GetNetMode() == NM_DedicatedServer || !FApp::CanEverRender());
+}
+
+void FFPTestCosmetics::StripMesh(USkeletalMeshComponent* Mesh)
+{
+	if (!Mesh)
+	{
+		return;
+	}
+
+	// Without a tick there is no animation update, and nothing is rendered to evaluate a pose for
+	Mesh->SetComponentTickEnabled(false);
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	Mesh->KinematicBonesUpdateToPhysics = EKinematicBonesUpdateToPhysics::SkipAllBones;
+
+	// Frees the anim instance with all its memory, montages played on it are gone with it
+	if (Mesh->GetAnimInstance())
+	{
+		Mesh->SetAnimInstanceClass(nullptr);
+	}
+}
@@ -0,0 +1,24 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USkeletalMeshComponent;
+class UWorld;
+
+/**
+ * What a world without anybody looking at it can leave out
+ * Dedicated servers and headless games (-nullrhi) strip the cosmetic work: meshes which are only for the looks
+ * do not tick, evaluate poses or keep an anim instance, and sounds, montages and other effects are not played.
+ * The meshes keep their asset, weapons still attach to their sockets.
+ * Turned off with FPTest.Cosmetics.Strip 0, e.g. to compare load tests with and without it
+ */
+struct FPTEST_API FFPTestCosmetics
+{
+	/** If the world strips its cosmetics, checked when the actors begin play */
+	static bool AreStripped(const UWorld* World);
+
+	/** Turns off ticking, pose evaluation and the anim instance of a mesh which is only for the looks */
+	static void StripMesh(USkeletalMeshComponent* Mesh);
+};
@@ -0,0 +1,5 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestCounters.h"
+
+std::atomic<int64> FFPTestCounters::Totals[static_cast<int32>(EFPTestCounter::Num)] = {};
@@ -0,0 +1,61 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/** Everything counted by FPTEST_COUNT, also used as index into the running totals */
+enum class EFPTestCounter : uint8
+{
+	ShotsFired,
+	ShotsResolved,
+	Traces,
+	CharacterHits,
+	RPCsSent,
+	RPCsReceived,
+	VoicesStarted,
+	VoicesCulled,
+	DamageEvents,
+	DamagedCharacters,
+	ShotsConfirmed,
+	ShotsRejected,
+	ShotViolations,
+	ShotViolationsOrigin,
+	ShotViolationsAim,
+	ShotViolationsCadence,
+	ShotViolationsAmmo,
+	PickUps,
+	TelemetryRecords,
+	TelemetryDropped,
+	ImpulsesMerged,
+	BodiesTouched,
+	Num
+};
+
+/**
+ * Running totals of everything counted with FPTEST_COUNT, the stats and csv only see the counts per frame
+ * Kept in shipping too, the load test reads them at the start and the end of a run to get rates
+ * Telemetry is counted from any thread, so the totals are atomic
+ */
+struct FPTEST_API FFPTestCounters
+{
+	static void Add(EFPTestCounter Counter, int64 Amount)
+	{
+		Totals[static_cast<int32>(Counter)].fetch_add(Amount, std::memory_order_relaxed);
+	}
+
+	static int64 Get(EFPTestCounter Counter)
+	{
+		return Totals[static_cast<int32>(Counter)].load(std::memory_order_relaxed);
+	}
+
+	/** Puts a total back, for benchmarks which should not show up in it */
+	static void Set(EFPTestCounter Counter, int64 Value)
+	{
+		Totals[static_cast<int32>(Counter)].store(Value, std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic<int64> Totals[static_cast<int32>(EFPTestCounter::Num)];
+};
@@ -0,0 +1,189 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestDamageSubsystem.h"
+#include "FPTestCharacter.h"
+#include "FPTestGameMode.h"
+#include "FPTestStats.h"
+#include "FPTestTelemetry.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+void UFPTestDamageSubsystem::QueueDamage(AFPTestCharacter* Target, AFPTestCharacter* Instigator, int32 Damage, EWeaponShootType ShootType)
+{
+	if (!Target || Damage <= 0)
+	{
+		return;
+	}
+
+	FFPTestDamageEvent& Event = Events.AddDefaulted_GetRef();
+	Event.Target = Target;
+	Event.Instigator = Instigator;
+	Event.Damage = Damage;
+	Event.ShootType = ShootType;
+	FPTEST_COUNT(DamageEvents, 1);
+}
+
+void UFPTestDamageSubsystem::ResolveDamage()
+{
+	if (Events.Num() == 0)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(ResolveDamage);
+
+	UWorld* const World = GetWorld();
+
+	// Sum up per character, in the order the characters got hit first
+	TargetDamages.Reset();
+	TargetIndices.Reset();
+	for (int32 EventIndex = 0; EventIndex < Events.Num(); EventIndex++)
+	{
+		const FFPTestDamageEvent& Event = Events[EventIndex];
+		AFPTestCharacter* Target = Event.Target.Get();
+		if (!Target)
+		{
+			continue;
+		}
+
+		int32& TargetIndex = TargetIndices.FindOrAdd(Target, INDEX_NONE);
+		if (TargetIndex == INDEX_NONE)
+		{
+			TargetIndex = TargetDamages.AddDefaulted();
+			TargetDamages[TargetIndex].Target = Target;
+		}
+
+		FTargetDamage& TargetDamage = TargetDamages[TargetIndex];
+		TargetDamage.Damage += Event.Damage;
+		TargetDamage.NumHits++;
+		TargetDamage.LastEvent = EventIndex;
+	}
+
+	// Looked up once for all characters instead of once per hit
+	AFPTestGameMode* GameMode = World ? World->GetAuthGameMode<AFPTestGameMode>() : nullptr;
+	const float Time = World ? World->GetTimeSeconds() : 0.0f;
+
+	for (const FTargetDamage& TargetDamage : TargetDamages)
+	{
+		// Taken before, a killed character gets moved to its respawn point
+		const FVector TargetLocation = TargetDamage.Target->GetActorLocation();
+		const bool bKilled = TargetDamage.Target->ApplyDamage(TargetDamage.Damage, GameMode);
+
+		const FFPTestDamageEvent& LastEvent = Events[TargetDamage.LastEvent];
+		const AFPTestCharacter* Instigator = LastEvent.Instigator.Get();
+
+		FFPTestDamageRecord Record;
+		Record.Time = Time;
+		Record.TargetId = TargetDamage.Target->GetUniqueID();
+		Record.InstigatorId = Instigator ? Instigator->GetUniqueID() : 0;
+		Record.Damage = static_cast<uint16>(FMath::Min(TargetDamage.Damage, static_cast<int32>(MAX_uint16)));
+		Record.NumHits = static_cast<uint8>(FMath::Min(TargetDamage.NumHits, static_cast<int32>(MAX_uint8)));
+		Record.ShootType = static_cast<uint8>(LastEvent.ShootType);
+		Record.bKilled = bKilled ? 1 : 0;
+		AddRecord(Record);
+
+		if (FFPTestTelemetry::IsRecording())
+		{
+			FFPTestTelemetryRecord TelemetryRecord;
+			TelemetryRecord.Type = bKilled ? EFPTestTelemetryType::Kill : EFPTestTelemetryType::Damage;
+			TelemetryRecord.Time = Time;
+			TelemetryRecord.ShooterId = Record.InstigatorId;
+			TelemetryRecord.TargetId = Record.TargetId;
+			TelemetryRecord.Location = FVector3f(TargetLocation);
+			TelemetryRecord.Damage = Record.Damage;
+			TelemetryRecord.ShootType = Record.ShootType;
+			FFPTestTelemetry::Record(TelemetryRecord);
+		}
+	}
+
+	FPTEST_COUNT(DamagedCharacters, TargetDamages.Num());
+	Events.Reset();
+}
+
+void UFPTestDamageSubsystem::AddRecord(const FFPTestDamageRecord& Record)
+{
+	if (Records.Num() == 0)
+	{
+		Records.SetNum(LogCapacity);
+	}
+
+	Records[Head] = Record;
+	Head = (Head + 1) % LogCapacity;
+	NumRecords = FMath::Min(NumRecords + 1, LogCapacity);
+}
+
+void UFPTestDamageSubsystem::DumpLog(const FString& Path) const
+{
+	const int32 Oldest = (Head - NumRecords + LogCapacity) % LogCapacity;
+
+	if (Path.IsEmpty())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Damage: %d of %d records"), NumRecords, LogCapacity);
+		for (int32 Index = 0; Index < NumRecords; Index++)
+		{
+			const FFPTestDamageRecord& Record = Records[(Oldest + Index) % LogCapacity];
+			UE_LOG(LogTemp, Display, TEXT("  %.3f target %u instigator %u damage %u hits %u mode %u%s"),
+				Record.Time, Record.TargetId, Record.InstigatorId, Record.Damage, Record.NumHits, Record.ShootType, Record.bKilled ? TEXT(" killed") : TEXT(""));
+		}
+		return;
+	}
+
+	FString Csv = TEXT("Time,Target,Instigator,Damage,Hits,ShootType,Killed\n");
+	for (int32 Index = 0; Index < NumRecords; Index++)
+	{
+		const FFPTestDamageRecord& Record = Records[(Oldest + Index) % LogCapacity];
+		Csv += FString::Printf(TEXT("%.3f,%u,%u,%u,%u,%u,%u\n"),
+			Record.Time, Record.TargetId, Record.InstigatorId, Record.Damage, Record.NumHits, Record.ShootType, Record.bKilled);
+	}
+
+	if (FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		UE_LOG(LogTemp, Display, TEXT("Damage: %d records written to %s"), NumRecords, *Path);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Damage: could not write %s"), *Path);
+	}
+}
+
+void UFPTestDamageSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// After all tick groups and tickable objects, so the hits of the shot resolver are applied in the same frame
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UFPTestDamageSubsystem::OnWorldPostActorTick);
+}
+
+void UFPTestDamageSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	Events.Reset();
+
+	Super::Deinitialize();
+}
+
+void UFPTestDamageSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		ResolveDamage();
+	}
+}
+
+bool UFPTestDamageSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFPTestDamageDump(
+	TEXT("FPTest.Damage.Dump"),
+	TEXT("Writes the damage records to the log. Argument: [File] writes them as csv instead, relative to the saved directory."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UFPTestDamageSubsystem* Damage = World ? World->GetSubsystem<UFPTestDamageSubsystem>() : nullptr)
+		{
+			Damage->DumpLog(Args.Num() > 0 ? FPaths::ProjectSavedDir() / Args[0] : FString());
+		}
+	}));
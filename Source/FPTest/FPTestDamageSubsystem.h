@@ -0,0 +1,115 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestWeaponTypes.h"
+#include "FPTestDamageSubsystem.generated.h"
+
+class AFPTestCharacter;
+
+/** A hit on a character which is not applied yet */
+struct FFPTestDamageEvent
+{
+	TWeakObjectPtr<AFPTestCharacter> Target;
+	TWeakObjectPtr<AFPTestCharacter> Instigator;
+	int32 Damage = 0;
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+};
+
+/** What happened to a character in one frame, 16 bytes so a lot of them fit into the log */
+struct FFPTestDamageRecord
+{
+	/** Server time of the frame */
+	float Time = 0.0f;
+
+	/** GetUniqueID of the characters, the instigator is the one of the last hit, 0 if it was gone already */
+	uint32 TargetId = 0;
+	uint32 InstigatorId = 0;
+
+	/** Damage of all hits of the frame */
+	uint16 Damage = 0;
+
+	/** Amount of hits of the frame */
+	uint8 NumHits = 0;
+
+	/** Fire mode of the last hit */
+	uint8 ShootType : 7;
+
+	/** If the character died and respawned */
+	uint8 bKilled : 1;
+
+	FFPTestDamageRecord()
+		: ShootType(0)
+		, bKilled(0)
+	{
+	}
+};
+
+/**
+ * Server side damage
+ * Hits only get queued during the frame. After all ticks, the damage is summed up per character
+ * and every hit character gets one health update, one respawn check and one OnHealthChanged.
+ * One record per character and frame goes into a ring buffer, see FPTest.Damage.Dump
+ */
+UCLASS()
+class FPTEST_API UFPTestDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Amount of records kept, the oldest gets overwritten */
+	static constexpr int32 LogCapacity = 4096;
+
+	/** Queues the hit, it is applied at the end of the frame */
+	void QueueDamage(AFPTestCharacter* Target, AFPTestCharacter* Instigator, int32 Damage, EWeaponShootType ShootType);
+
+	/** Applies all queued hits, called after the ticks of the world */
+	void ResolveDamage();
+
+	/** Writes the records to the log, or as csv to the file if a path is given */
+	void DumpLog(const FString& Path) const;
+
+	/** Amount of hits which wait for the end of the frame */
+	int32 GetNumQueuedEvents() const { return Events.Num(); }
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	/** Adds a record to the ring buffer */
+	void AddRecord(const FFPTestDamageRecord& Record);
+
+	/** Hits of this frame, in the order they came in */
+	TArray<FFPTestDamageEvent> Events;
+
+	/** Sum of the hits of one character, only used while resolving but kept to not allocate every frame */
+	struct FTargetDamage
+	{
+		AFPTestCharacter* Target = nullptr;
+		int32 Damage = 0;
+		int32 NumHits = 0;
+		int32 LastEvent = INDEX_NONE;
+	};
+	TArray<FTargetDamage> TargetDamages;
+	TMap<AFPTestCharacter*, int32> TargetIndices;
+
+	TArray<FFPTestDamageRecord> Records;
+
+	/** Where the next record gets written */
+	int32 Head = 0;
+
+	/** Amount of valid records */
+	int32 NumRecords = 0;
+
+	FDelegateHandle PostActorTickHandle;
+};
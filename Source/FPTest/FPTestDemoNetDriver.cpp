@@ -0,0 +1,21 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestDemoNetDriver.h"
+#include "FPTestStats.h"
+
+void UFPTestDemoNetDriver::TickFlush(float DeltaSeconds)
+{
+	// Playback happens in TickDispatch, only time the recording
+	if (!IsRecording())
+	{
+		LastRecordMs = 0.0f;
+		Super::TickFlush(DeltaSeconds);
+		return;
+	}
+
+	FPTEST_SCOPE(ReplayRecord);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	Super::TickFlush(DeltaSeconds);
+	LastRecordMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
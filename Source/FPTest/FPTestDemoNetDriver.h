@@ -0,0 +1,27 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DemoNetDriver.h"
+#include "FPTestDemoNetDriver.generated.h"
+
+/**
+ * Demo net driver of the project, registered for DemoNetDriver in DefaultEngine.ini
+ * Weapon events are the replicated counters of the fire visual state and health a pushed property,
+ * so the replay stores them as property deltas and no RPC payloads. This only measures the recording.
+ */
+UCLASS(transient, config = Engine)
+class FPTEST_API UFPTestDemoNetDriver : public UDemoNetDriver
+{
+	GENERATED_BODY()
+
+public:
+	virtual void TickFlush(float DeltaSeconds) override;
+
+	/** Time the last frame spent recording, 0 while playing back */
+	float GetLastRecordMs() const { return LastRecordMs; }
+
+private:
+	float LastRecordMs = 0.0f;
+};
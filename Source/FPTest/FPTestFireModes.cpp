@@ -0,0 +1,125 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestFireModes.h"
+#include "FPTestWeaponDefinition.h"
+#include "FPTestWeaponSimulation.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Kernels
+
+template<>
+struct TFPTestFireModeKernel<EWeaponShootType::Single>
+{
+	static constexpr bool bRepeatsWhileHeld = false;
+
+	static void Started(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+	}
+
+	static void Triggered(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+		Simulation.Fire(FireMode, 1);
+	}
+};
+
+template<>
+struct TFPTestFireModeKernel<EWeaponShootType::Automatic>
+{
+	static constexpr bool bRepeatsWhileHeld = true;
+
+	static void Started(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+		Simulation.StartCooldown();
+	}
+
+	static void Triggered(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+		// The cooldown only stores when the next shot is allowed
+		// If the fire rate is higher than the tick rate, several shots are due in one tick
+		const int32 NumShots = Simulation.ConsumeCooldown(FireMode.Cooldown, FireMode.MaxShotsPerFrame);
+		if (NumShots > 0)
+		{
+			Simulation.Fire(FireMode, NumShots);
+		}
+	}
+};
+
+template<>
+struct TFPTestFireModeKernel<EWeaponShootType::Charged>
+{
+	static constexpr bool bRepeatsWhileHeld = false;
+
+	static void Started(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+		Simulation.StartCharging(FireMode);
+	}
+
+	static void Triggered(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode)
+	{
+		Simulation.Fire(FireMode, 1);
+	}
+};
+
+namespace FPTestFireModes
+{
+	template<EWeaponShootType ShootType>
+	static constexpr FFPTestFireModeKernel MakeKernel()
+	{
+		return FFPTestFireModeKernel{ &TFPTestFireModeKernel<ShootType>::Started, &TFPTestFireModeKernel<ShootType>::Triggered, TFPTestFireModeKernel<ShootType>::bRepeatsWhileHeld };
+	}
+
+	// Indexed by the shoot type
+	static const FFPTestFireModeKernel Kernels[] =
+	{
+		MakeKernel<EWeaponShootType::Single>(),
+		MakeKernel<EWeaponShootType::Automatic>(),
+		MakeKernel<EWeaponShootType::Charged>(),
+	};
+	static_assert(UE_ARRAY_COUNT(Kernels) == static_cast<int32>(EWeaponShootType::Num), "Every shoot type needs a kernel");
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FFPTestFireModeTable
+
+FFPTestFireModeTable::FFPTestFireModeTable()
+{
+	FMemory::Memset(IndexByShootType, InvalidIndex, sizeof(IndexByShootType));
+}
+
+void FFPTestFireModeTable::Build(TConstArrayView<FFPTestFireModeDefinition> Definitions)
+{
+	Modes.Reset();
+	InputActions.Reset();
+	FMemory::Memset(IndexByShootType, InvalidIndex, sizeof(IndexByShootType));
+
+	for (const FFPTestFireModeDefinition& Definition : Definitions)
+	{
+		const uint8 ShootTypeIndex = static_cast<uint8>(Definition.ShootType);
+		if (ShootTypeIndex >= static_cast<uint8>(EWeaponShootType::Num) || IndexByShootType[ShootTypeIndex] != InvalidIndex)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FireModeTable: skipping invalid or duplicated shoot type %d"), ShootTypeIndex);
+			continue;
+		}
+
+		IndexByShootType[ShootTypeIndex] = static_cast<uint8>(Modes.Num());
+
+		FFPTestFireMode& FireMode = Modes.AddDefaulted_GetRef();
+		FireMode.Kernel = &GetKernel(Definition.ShootType);
+		FireMode.ImpactModifier = Definition.ImpactModifier;
+		FireMode.Cooldown = FMath::Max(Definition.Cooldown, 0.0f);
+		FireMode.Damage = FMath::Max(Definition.Damage, 0);
+		FireMode.MaxShotsPerFrame = FMath::Max(Definition.MaxShotsPerFrame, 1);
+		FireMode.ProjectileSpeed = FMath::Max(Definition.ProjectileSpeed, 0.0f);
+		FireMode.ProjectileGravityScale = Definition.ProjectileGravityScale;
+		FireMode.ProjectileDrag = FMath::Max(Definition.ProjectileDrag, 0.0f);
+		FireMode.ShootType = Definition.ShootType;
+
+		InputActions.Add(Definition.InputAction);
+	}
+}
+
+const FFPTestFireModeKernel& FFPTestFireModeTable::GetKernel(EWeaponShootType ShootType)
+{
+	check(static_cast<uint8>(ShootType) < static_cast<uint8>(EWeaponShootType::Num));
+	return FPTestFireModes::Kernels[static_cast<uint8>(ShootType)];
+}
@@ -0,0 +1,112 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FPTestWeaponTypes.h"
+
+class UInputAction;
+class FFPTestWeaponSimulation;
+struct FFPTestFireMode;
+struct FFPTestFireModeDefinition;
+
+/** Trigger functions of a fire mode, called by the weapon simulation for the input of the mode */
+struct FFPTestFireModeKernel
+{
+	using FTriggerFunction = void (*)(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode);
+
+	/** The trigger got pressed */
+	FTriggerFunction Started = nullptr;
+
+	/** The trigger got triggered, depending on the triggers of the input action. Modes repeating while held get it once per tick instead */
+	FTriggerFunction Triggered = nullptr;
+
+	/** If the mode keeps firing while the trigger is held, until it gets released */
+	bool bRepeatsWhileHeld = false;
+};
+
+/**
+ * Fire path of one shoot type
+ * Every shoot type specializes it in FPTestFireModes.cpp, the simulation of the weapon calls it through the kernel of the mode,
+ * so there is no switch over the shoot type when firing
+ * To add a mode, add it to EWeaponShootType, specialize this and add it to the kernel table
+ */
+template<EWeaponShootType ShootType>
+struct TFPTestFireModeKernel
+{
+	static constexpr bool bRepeatsWhileHeld = false;
+	static void Started(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode) {}
+	static void Triggered(FFPTestWeaponSimulation& Simulation, const FFPTestFireMode& FireMode) {}
+};
+
+/** Flattened fire mode, everything a shot needs in one place */
+struct FFPTestFireMode
+{
+	/** Kernel of the shoot type, never null */
+	const FFPTestFireModeKernel* Kernel = nullptr;
+
+	/** Modifier for the impulse applied to physics objects */
+	float ImpactModifier = 1.0f;
+
+	/** Seconds between two shots, 0 if the mode has no cooldown */
+	float Cooldown = 0.0f;
+
+	/** Damage dealt to characters */
+	int32 Damage = 0;
+
+	/** Limit of shots in one simulation tick if the cooldown is shorter than a tick */
+	int32 MaxShotsPerFrame = 1;
+
+	/** Bullets fly as projectiles if this is above 0, otherwise the shot is an instant trace */
+	float ProjectileSpeed = 0.0f;
+	float ProjectileGravityScale = 1.0f;
+	float ProjectileDrag = 0.0f;
+
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+};
+
+/**
+ * Fire modes of a weapon in one contiguous array, built once from a weapon definition
+ * Shoot types index into it directly, so looking up the mode of a received shot is a single load
+ */
+struct FPTEST_API FFPTestFireModeTable
+{
+	FFPTestFireModeTable();
+
+	/** Flattens the definitions, modes with an unknown or duplicated shoot type are skipped */
+	void Build(TConstArrayView<FFPTestFireModeDefinition> Definitions);
+
+	/** Mode of the shoot type, null if the weapon does not have it */
+	const FFPTestFireMode* Find(EWeaponShootType ShootType) const
+	{
+		const uint8 Index = IndexByShootType[FMath::Min<uint8>(static_cast<uint8>(ShootType), static_cast<uint8>(EWeaponShootType::Num))];
+		return Index != InvalidIndex ? &Modes[Index] : nullptr;
+	}
+
+	/** Index of the shoot type in the table, INDEX_NONE if the weapon does not have it */
+	int32 FindIndex(EWeaponShootType ShootType) const
+	{
+		const FFPTestFireMode* FireMode = Find(ShootType);
+		return FireMode ? static_cast<int32>(FireMode - Modes.GetData()) : INDEX_NONE;
+	}
+
+	int32 Num() const { return Modes.Num(); }
+	const FFPTestFireMode& operator[](int32 Index) const { return Modes[Index]; }
+
+	/** Input action the mode was defined with, can be null */
+	const UInputAction* GetInputAction(int32 Index) const { return InputActions[Index]; }
+
+	/** Kernel of the shoot type */
+	static const FFPTestFireModeKernel& GetKernel(EWeaponShootType ShootType);
+
+private:
+	static constexpr uint8 InvalidIndex = 0xFF;
+
+	TArray<FFPTestFireMode, TInlineAllocator<4>> Modes;
+
+	/** Only needed when binding the input, kept apart so it does not sit between the modes */
+	TArray<const UInputAction*, TInlineAllocator<4>> InputActions;
+
+	/** Index into Modes for every shoot type, the last entry stays invalid for out of range values */
+	uint8 IndexByShootType[static_cast<uint8>(EWeaponShootType::Num) + 1];
+};
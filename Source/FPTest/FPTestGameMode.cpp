@@ -2,6 +2,13 @@
 
 #include "FPTestGameMode.h"
 #include "FPTestCharacter.h"
+#include "FPTestStats.h"
+#include "EngineUtils.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/PlayerStart.h"
+#include "GameFramework/PlayerStartPIE.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
 #include "UObject/ConstructorHelpers.h"
 
 AFPTestGameMode::AFPTestGameMode()
@@ -11,4 +18,127 @@ AFPTestGameMode::AFPTestGameMode()
 	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnClassFinder(TEXT("/Game/FirstPerson/Blueprints/BP_FirstPersonCharacter"));
 	DefaultPawnClass = PlayerPawnClassFinder.Class;
 
+	// The spawn points get scored while the game runs
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AFPTestGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	bRecordReplay = UGameplayStatics::GetIntOption(Options, TEXT("Replay"), bRecordReplay ? 1 : 0) != 0
+		|| FParse::Param(FCommandLine::Get(), TEXT("FPTestReplay"));
+}
+
+void AFPTestGameMode::StartPlay()
+{
+	BuildSpawnPointIndex();
+
+	Super::StartPlay();
+
+	if (bRecordReplay)
+	{
+		StartReplayRecording();
+	}
+}
+
+void AFPTestGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Finalizes the file, otherwise the last checkpoint is missing
+	if (!ReplayName.IsEmpty())
+	{
+		if (UGameInstance* GameInstance = GetGameInstance())
+		{
+			GameInstance->StopRecordingReplay();
+		}
+		ReplayName.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFPTestGameMode::StartReplayRecording()
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	if (!GameInstance || !ReplayName.IsEmpty())
+	{
+		return;
+	}
+
+	ReplayName = FString::Printf(TEXT("FPTest-%s"), *FDateTime::Now().ToString());
+	ReplayStartTime = GetWorld()->GetTimeSeconds();
+	GameInstance->StartRecordingReplay(ReplayName, ReplayName);
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: recording %s"), *ReplayName);
+}
+
+void AFPTestGameMode::BuildSpawnPointIndex()
+{
+	SpawnPoints.Reset();
+	TArray<FVector> Locations;
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+	{
+		SpawnPoints.Add(*It);
+		Locations.Add(It->GetActorLocation());
+	}
+
+	SpawnPointIndex.Reset(Locations, SpawnPointScoreRange);
+}
+
+void AFPTestGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (SpawnPointIndex.Num() == 0)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(SpawnPointIndex);
+
+	// Only characters which changed their cell touch the grid
+	SpawnPointIndex.BeginCharacterUpdate();
+	for (TActorIterator<AFPTestCharacter> It(GetWorld()); It; ++It)
+	{
+		if (!It->IsPendingKillPending())
+		{
+			SpawnPointIndex.UpdateCharacter(It->GetUniqueID(), It->GetActorLocation());
+		}
+	}
+	SpawnPointIndex.EndCharacterUpdate();
+
+	SpawnPointIndex.ScoreSpawnPoints(SpawnPointsScoredPerTick);
+}
+
+AActor* AFPTestGameMode::ChooseRespawnPoint(AController* Player)
+{
+	FPTEST_SCOPE(ChooseSpawnPoint);
+
+	// Players can spawn before the game started and built the index
+	if (SpawnPointIndex.Num() == 0)
+	{
+		BuildSpawnPointIndex();
+	}
+
+	const int32 Best = SpawnPointIndex.GetBest();
+	if (Best == INDEX_NONE || !IsValid(SpawnPoints[Best]))
+	{
+		return Super::ChoosePlayerStart_Implementation(Player);
+	}
+
+	// So the next one respawning in the same frame does not end up at the same spot
+	SpawnPointIndex.MarkUsed(Best);
+	return SpawnPoints[Best];
+}
+
+AActor* AFPTestGameMode::ChoosePlayerStart_Implementation(AController* Player)
+{
+	// The first spawn and Play From Here go through the engine, it knows the PIE start and skips blocked starts
+	const bool bRespawn = Player && Player->StartSpot.IsValid();
+	if (!bRespawn || TActorIterator<APlayerStartPIE>(GetWorld()))
+	{
+		return Super::ChoosePlayerStart_Implementation(Player);
+	}
+
+	return ChooseRespawnPoint(Player);
 }
@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "FPTestSpawnPointIndex.h"
 #include "FPTestGameMode.generated.h"
 
+class APlayerStart;
+
 UCLASS(minimalapi)
 class AFPTestGameMode : public AGameModeBase
 {
@@ -13,6 +16,51 @@ class AFPTestGameMode : public AGameModeBase
 
 public:
 	AFPTestGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Player start furthest away from all characters, used for respawns. The first spawn is chosen by the engine */
+	AActor* ChooseRespawnPoint(AController* Player);
+
+	/** Name of the replay being recorded, empty if none */
+	const FString& GetReplayName() const { return ReplayName; }
+
+	/** World time the replay recording started at */
+	double GetReplayStartTime() const { return ReplayStartTime; }
+
+	/** Records the match into Saved/Demos, can be turned on with ?Replay=1 or -FPTestReplay */
+	UPROPERTY(EditAnywhere, Category = Replay)
+	bool bRecordReplay = false;
+
+protected:
+	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
+
+	/** Collects the player starts of the map into the spawn point index */
+	void BuildSpawnPointIndex();
+
+	/** Starts recording the match with a name from the current time */
+	void StartReplayRecording();
+
+	/** Characters further away from a spawn point than this do not make it better */
+	UPROPERTY(EditDefaultsOnly, Category = Spawning)
+	float SpawnPointScoreRange = 5000.0f;
+
+	/** Spawn points scored again every tick */
+	UPROPERTY(EditDefaultsOnly, Category = Spawning)
+	int32 SpawnPointsScoredPerTick = 8;
+
+private:
+	/** Player starts, same index as in the spawn point index */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<APlayerStart>> SpawnPoints;
+
+	FFPTestSpawnPointIndex SpawnPointIndex;
+
+	FString ReplayName;
+	double ReplayStartTime = 0.0;
 };
 
 
@@ -0,0 +1,116 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestImpulseSubsystem.h"
+#include "FPTestStats.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "PhysicsEngine/BodyInstance.h"
+
+static int32 GFPTestImpulsesBatch = 1;
+static FAutoConsoleVariableRef CVarFPTestImpulsesBatch(
+	TEXT("FPTest.Impulses.Batch"),
+	GFPTestImpulsesBatch,
+	TEXT("1: Shot impulses are summed up per body and applied once before the next physics step.\n")
+	TEXT("0: Every shot impulse is applied right away."));
+
+void UFPTestImpulseSubsystem::QueueImpulse(UPrimitiveComponent* Component, FName BoneName, const FVector& Impulse, const FVector& Location)
+{
+	if (!Component)
+	{
+		return;
+	}
+
+	if (GFPTestImpulsesBatch == 0)
+	{
+		FPTEST_COUNT(BodiesTouched, 1);
+		Component->AddImpulseAtLocation(Impulse, Location, BoneName);
+		return;
+	}
+
+	int32& BodyIndex = BodyIndices.FindOrAdd(MakeTuple(static_cast<const UPrimitiveComponent*>(Component), BoneName), INDEX_NONE);
+	if (BodyIndex == INDEX_NONE)
+	{
+		BodyIndex = Bodies.AddDefaulted();
+		Bodies[BodyIndex].Component = Component;
+		Bodies[BodyIndex].BoneName = BoneName;
+	}
+	else
+	{
+		FPTEST_COUNT(ImpulsesMerged, 1);
+	}
+
+	FFPTestBodyImpulse& Body = Bodies[BodyIndex];
+	Body.Impulse += Impulse;
+	Body.Moment += FVector::CrossProduct(Location, Impulse);
+}
+
+void UFPTestImpulseSubsystem::ApplyImpulses()
+{
+	if (Bodies.Num() == 0)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(ApplyImpulses);
+
+	int32 NumTouched = 0;
+	for (const FFPTestBodyImpulse& Body : Bodies)
+	{
+		// The body can be gone or stopped simulating since it got hit
+		UPrimitiveComponent* Component = Body.Component.Get();
+		if (!Component || !Component->IsSimulatingPhysics(Body.BoneName))
+		{
+			continue;
+		}
+
+		const FBodyInstance* BodyInstance = Component->GetBodyInstance(Body.BoneName);
+		if (!BodyInstance)
+		{
+			continue;
+		}
+
+		// An impulse at a location is the impulse plus (location - center of mass) x impulse around the center of mass
+		const FVector AngularImpulse = Body.Moment - FVector::CrossProduct(BodyInstance->GetCOMPosition(), Body.Impulse);
+		Component->AddImpulse(Body.Impulse, Body.BoneName);
+		if (!AngularImpulse.IsNearlyZero())
+		{
+			Component->AddAngularImpulseInRadians(AngularImpulse, Body.BoneName);
+		}
+		NumTouched++;
+	}
+	FPTEST_COUNT(BodiesTouched, NumTouched);
+
+	Bodies.Reset();
+	BodyIndices.Reset();
+}
+
+void UFPTestImpulseSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Before the first tick group, so the impulses of the last frame are in before the physics step of this one
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UFPTestImpulseSubsystem::OnWorldPreActorTick);
+}
+
+void UFPTestImpulseSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	Bodies.Reset();
+	BodyIndices.Reset();
+
+	Super::Deinitialize();
+}
+
+void UFPTestImpulseSubsystem::OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		ApplyImpulses();
+	}
+}
+
+bool UFPTestImpulseSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
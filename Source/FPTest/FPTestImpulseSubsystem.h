@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestImpulseSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+/** All impulses one body got during a frame */
+struct FFPTestBodyImpulse
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+
+	/** Bone of the body, none for single body components */
+	FName BoneName;
+
+	/** Sum of the impulses */
+	FVector Impulse = FVector::ZeroVector;
+
+	/** Sum of location x impulse, the angular part around the center of mass is taken from it when applying */
+	FVector Moment = FVector::ZeroVector;
+};
+
+/**
+ * Server side shot impulses on simulating bodies, e.g. everything with the Shootable collision profile
+ * Impulses only get summed up per body during the frame. At the start of the next frame, before the physics step,
+ * every body gets one linear and one angular impulse, which move it the same as all the single impulses at their locations.
+ * That wakes every body once and keeps the physics writes out of the shot resolution.
+ */
+UCLASS()
+class FPTEST_API UFPTestImpulseSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Queues an impulse at a location of the body, applied right away if FPTest.Impulses.Batch is 0 */
+	void QueueImpulse(UPrimitiveComponent* Component, FName BoneName, const FVector& Impulse, const FVector& Location);
+
+	/** Applies the queued impulses, called before the ticks of the world */
+	void ApplyImpulses();
+
+	/** Bodies which wait for their impulse */
+	int32 GetNumQueuedBodies() const { return Bodies.Num(); }
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	/** Bodies hit during the frame, in the order they got hit first */
+	TArray<FFPTestBodyImpulse> Bodies;
+	TMap<TTuple<const UPrimitiveComponent*, FName>, int32> BodyIndices;
+
+	FDelegateHandle PreActorTickHandle;
+};
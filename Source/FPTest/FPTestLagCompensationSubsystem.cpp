@@ -0,0 +1,525 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestLagCompensationSubsystem.h"
+#include "FPTestCharacter.h"
+#include "FPTestStats.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+static int32 GFPTestLagCompensation = 1;
+static FAutoConsoleVariableRef CVarFPTestLagCompensation(
+	TEXT("FPTest.LagCompensation.Enable"),
+	GFPTestLagCompensation,
+	TEXT("If shots on the server are traced against the character capsules rewound to the time the client fired."));
+
+static float GFPTestLagCompensationMaxRewind = 1.0f;
+static FAutoConsoleVariableRef CVarFPTestLagCompensationMaxRewind(
+	TEXT("FPTest.LagCompensation.MaxRewind"),
+	GFPTestLagCompensationMaxRewind,
+	TEXT("How many seconds a shot can be rewound at most, older shots are traced at the oldest allowed time."));
+
+static float GFPTestLagCompensationSampleRate = 60.0f;
+static FAutoConsoleVariableRef CVarFPTestLagCompensationSampleRate(
+	TEXT("FPTest.LagCompensation.SampleRate"),
+	GFPTestLagCompensationSampleRate,
+	TEXT("How many poses per second are kept at most, servers ticking faster only keep their newest pose at full rate."));
+
+namespace FPTestLagCompensation
+{
+	/**
+	 * Intersection of a normalized ray with a capsule given by the two sphere centers and the radius
+	 * Returns the distance along the ray, or a negative value when the ray misses or starts inside the capsule
+	 */
+	static float IntersectCapsule(const FVector& RayOrigin, const FVector& RayDir, const FVector& PointA, const FVector& PointB, float Radius)
+	{
+		const FVector BA = PointB - PointA;
+		const FVector OA = RayOrigin - PointA;
+		const double BABA = FVector::DotProduct(BA, BA);
+		const double BARD = FVector::DotProduct(BA, RayDir);
+		const double BAOA = FVector::DotProduct(BA, OA);
+		const double RDOA = FVector::DotProduct(RayDir, OA);
+		const double OAOA = FVector::DotProduct(OA, OA);
+		const double A = BABA - BARD * BARD;
+		const double B = BABA * RDOA - BAOA * BARD;
+		const double C = BABA * OAOA - BAOA * BAOA - Radius * Radius * BABA;
+
+		// Cylinder body, skipped when the ray is parallel to the axis
+		double Y = BARD > 0.0 ? 0.0 : BABA;
+		if (A > UE_KINDA_SMALL_NUMBER)
+		{
+			const double H = B * B - A * C;
+			if (H < 0.0)
+			{
+				return -1.0f;
+			}
+
+			const double T = (-B - FMath::Sqrt(H)) / A;
+			Y = BAOA + T * BARD;
+			if (Y > 0.0 && Y < BABA)
+			{
+				return static_cast<float>(T);
+			}
+		}
+
+		// Sphere caps
+		const FVector OC = (Y <= 0.0) ? OA : RayOrigin - PointB;
+		const double CapB = FVector::DotProduct(RayDir, OC);
+		const double CapC = FVector::DotProduct(OC, OC) - Radius * Radius;
+		const double CapH = CapB * CapB - CapC;
+		if (CapH > 0.0)
+		{
+			return static_cast<float>(-CapB - FMath::Sqrt(CapH));
+		}
+		return -1.0f;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FFPTestPoseHistory
+
+void FFPTestPoseHistory::SetMaxFrames(int32 NewMaxFrames)
+{
+	check(NewMaxFrames > 0);
+
+	MaxFrames = NewMaxFrames;
+	FrameTimes.SetNumZeroed(MaxFrames);
+	FrameNumbers.SetNumZeroed(MaxFrames);
+	Poses.SetNum(MaxFrames * TrackCapacity);
+	HeadFrame = MaxFrames - 1;
+	NumFrames = 0;
+}
+
+int32 FFPTestPoseHistory::AddTrack()
+{
+	int32 Track = INDEX_NONE;
+	if (FreeTracks.Num() > 0)
+	{
+		Track = FreeTracks.Pop(false);
+	}
+	else
+	{
+		Track = NumTracks++;
+		if (Track >= TrackCapacity)
+		{
+			GrowTracks(FMath::Max(16, TrackCapacity * 2));
+		}
+		TrackFirstFrame.Add(0);
+		ActiveTracks.Add(false);
+	}
+
+	// Poses written before are from a previous owner of this track
+	TrackFirstFrame[Track] = FrameCounter + 1;
+	ActiveTracks[Track] = true;
+	return Track;
+}
+
+void FFPTestPoseHistory::RemoveTrack(int32 Track)
+{
+	if (!ActiveTracks.IsValidIndex(Track) || !ActiveTracks[Track])
+	{
+		return;
+	}
+
+	ActiveTracks[Track] = false;
+	FreeTracks.Add(Track);
+}
+
+void FFPTestPoseHistory::GrowTracks(int32 NewTrackCapacity)
+{
+	TArray<FFPTestCapsulePose> NewPoses;
+	NewPoses.SetNum(MaxFrames * NewTrackCapacity);
+
+	for (int32 Frame = 0; Frame < MaxFrames && TrackCapacity > 0; Frame++)
+	{
+		FMemory::Memcpy(&NewPoses[Frame * NewTrackCapacity], &Poses[PoseIndex(Frame, 0)], TrackCapacity * sizeof(FFPTestCapsulePose));
+	}
+
+	Poses = MoveTemp(NewPoses);
+	TrackCapacity = NewTrackCapacity;
+}
+
+void FFPTestPoseHistory::BeginFrame(double Time, double MinInterval)
+{
+	check(MaxFrames > 0);
+
+	const bool bReplaceNewest = NumFrames >= 2 && FrameTimes[HeadFrame] - FrameTimes[FrameAt(NumFrames - 2)] < MinInterval;
+	if (!bReplaceNewest)
+	{
+		HeadFrame = (HeadFrame + 1) % MaxFrames;
+		NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+	}
+
+	// A replaced frame gets a new number too, so tracks added since then count as existing in it
+	FrameCounter++;
+
+	FrameTimes[HeadFrame] = Time;
+	FrameNumbers[HeadFrame] = FrameCounter;
+}
+
+void FFPTestPoseHistory::WritePose(int32 Track, const FFPTestCapsulePose& Pose)
+{
+	check(Track >= 0 && Track < NumTracks);
+	Poses[PoseIndex(HeadFrame, Track)] = Pose;
+}
+
+bool FFPTestPoseHistory::GetTimeRange(double& OutOldest, double& OutNewest) const
+{
+	if (NumFrames == 0)
+	{
+		return false;
+	}
+
+	OutOldest = FrameTimes[FrameAt(0)];
+	OutNewest = FrameTimes[HeadFrame];
+	return true;
+}
+
+bool FFPTestPoseHistory::FindFrames(double Time, int32& OutOlder, int32& OutNewer, float& OutAlpha) const
+{
+	if (NumFrames == 0)
+	{
+		return false;
+	}
+
+	if (Time >= FrameTimes[HeadFrame])
+	{
+		OutOlder = OutNewer = HeadFrame;
+		OutAlpha = 0.0f;
+		return true;
+	}
+
+	if (Time <= FrameTimes[FrameAt(0)])
+	{
+		OutOlder = OutNewer = FrameAt(0);
+		OutAlpha = 0.0f;
+		return true;
+	}
+
+	// Binary search the last frame which is not newer than Time
+	int32 Low = 0;
+	int32 High = NumFrames - 1;
+	while (High - Low > 1)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (FrameTimes[FrameAt(Mid)] <= Time)
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid;
+		}
+	}
+
+	OutOlder = FrameAt(Low);
+	OutNewer = FrameAt(High);
+
+	const double Span = FrameTimes[OutNewer] - FrameTimes[OutOlder];
+	OutAlpha = Span > 0.0 ? static_cast<float>((Time - FrameTimes[OutOlder]) / Span) : 0.0f;
+	return true;
+}
+
+bool FFPTestPoseHistory::GetPose(int32 Track, int32 Older, int32 Newer, float Alpha, FFPTestCapsulePose& OutPose) const
+{
+	if (!ActiveTracks.IsValidIndex(Track) || !ActiveTracks[Track])
+	{
+		return false;
+	}
+
+	const uint64 FirstFrame = TrackFirstFrame[Track];
+	const bool bOlderValid = FrameNumbers[Older] >= FirstFrame;
+	const bool bNewerValid = FrameNumbers[Newer] >= FirstFrame;
+
+	if (!bNewerValid)
+	{
+		return false;
+	}
+
+	const FFPTestCapsulePose& NewerPose = Poses[PoseIndex(Newer, Track)];
+	if (!bOlderValid || Older == Newer)
+	{
+		OutPose = NewerPose;
+		return true;
+	}
+
+	const FFPTestCapsulePose& OlderPose = Poses[PoseIndex(Older, Track)];
+	OutPose.Center = FMath::Lerp(OlderPose.Center, NewerPose.Center, Alpha);
+	OutPose.Rotation = FQuat::FastLerp(OlderPose.Rotation, NewerPose.Rotation, Alpha).GetNormalized();
+	OutPose.Radius = FMath::Lerp(OlderPose.Radius, NewerPose.Radius, Alpha);
+	OutPose.HalfHeight = FMath::Lerp(OlderPose.HalfHeight, NewerPose.HalfHeight, Alpha);
+	return true;
+}
+
+FFPTestRewindHit FFPTestPoseHistory::RewindTrace(double Time, const FVector& Start, const FVector& End, int32 IgnoreTrack) const
+{
+	FFPTestRewindHit Result;
+
+	int32 Older, Newer;
+	float Alpha;
+	if (!FindFrames(Time, Older, Newer, Alpha))
+	{
+		return Result;
+	}
+
+	const FVector Segment = End - Start;
+	const float SegmentLength = Segment.Size();
+	if (SegmentLength <= UE_KINDA_SMALL_NUMBER)
+	{
+		return Result;
+	}
+	const FVector RayDir = Segment / SegmentLength;
+
+	float ClosestDistance = SegmentLength;
+	FFPTestCapsulePose Pose;
+	for (int32 Track = 0; Track < NumTracks; Track++)
+	{
+		if (Track == IgnoreTrack || !GetPose(Track, Older, Newer, Alpha, Pose))
+		{
+			continue;
+		}
+
+		const FVector Axis = Pose.Rotation.GetUpVector() * FMath::Max(Pose.HalfHeight - Pose.Radius, 0.0f);
+		const float Distance = FPTestLagCompensation::IntersectCapsule(Start, RayDir, Pose.Center - Axis, Pose.Center + Axis, Pose.Radius);
+		if (Distance < 0.0f || Distance >= ClosestDistance)
+		{
+			continue;
+		}
+
+		ClosestDistance = Distance;
+		Result.Track = Track;
+		Result.Location = Start + RayDir * Distance;
+
+		// The normal points from the closest point on the capsule axis to the hit
+		const FVector ClosestOnAxis = FMath::ClosestPointOnSegment(Result.Location, Pose.Center - Axis, Pose.Center + Axis);
+		Result.Normal = (Result.Location - ClosestOnAxis).GetSafeNormal();
+	}
+
+	Result.Time = ClosestDistance / SegmentLength;
+	return Result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UFPTestLagCompensationSubsystem
+
+void UFPTestLagCompensationSubsystem::RegisterCharacter(AFPTestCharacter* Character)
+{
+	if (!Character || FindTrack(Character) != INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Track = History.AddTrack();
+	if (Track >= TrackCharacters.Num())
+	{
+		TrackCharacters.SetNum(Track + 1);
+	}
+	TrackCharacters[Track] = Character;
+
+	// Shot traces skip the current collision of the character, the rewound capsule is traced instead
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Character);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		Primitive->SetMaskFilterOnBodyInstance(FPTEST_MASKFILTER_CHARACTER);
+	}
+}
+
+void UFPTestLagCompensationSubsystem::UnregisterCharacter(AFPTestCharacter* Character)
+{
+	const int32 Track = FindTrack(Character);
+	if (Track == INDEX_NONE)
+	{
+		return;
+	}
+
+	History.RemoveTrack(Track);
+	TrackCharacters[Track].Reset();
+}
+
+int32 UFPTestLagCompensationSubsystem::FindTrack(const AFPTestCharacter* Character) const
+{
+	return TrackCharacters.IndexOfByPredicate([Character](const TWeakObjectPtr<AFPTestCharacter>& TrackCharacter)
+	{
+		return TrackCharacter.Get() == Character;
+	});
+}
+
+bool UFPTestLagCompensationSubsystem::IsEnabled() const
+{
+	return GFPTestLagCompensation != 0 && History.GetNumFrames() > 0;
+}
+
+AFPTestCharacter* UFPTestLagCompensationSubsystem::RewindTrace(double Time, const FVector& Start, const FVector& End, float MaxTime, const AFPTestCharacter* IgnoreCharacter, FHitResult& OutHit) const
+{
+	FPTEST_SCOPE(LagCompensationRewind);
+
+	double Oldest, Newest;
+	if (!History.GetTimeRange(Oldest, Newest))
+	{
+		return nullptr;
+	}
+
+	// A full history is sized to cover MaxRewind, if it does not the shot would be traced against a wrong pose
+	const double MinTime = Newest - GFPTestLagCompensationMaxRewind;
+	if (Time < Oldest && Oldest > MinTime && History.GetNumFrames() == History.GetMaxFrames() && !bWarnedShortHistory)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("LagCompensation: the history only covers %.3f of %.3f seconds, old shots are traced at its oldest pose"),
+			Newest - Oldest, GFPTestLagCompensationMaxRewind);
+		bWarnedShortHistory = true;
+	}
+
+	// Never trust the client time further than MaxRewind
+	const double RewindTime = FMath::Clamp(Time, FMath::Max(Oldest, MinTime), Newest);
+
+	const FVector TraceEnd = FMath::Lerp(Start, End, MaxTime);
+	const FFPTestRewindHit RewindHit = History.RewindTrace(RewindTime, Start, TraceEnd, IgnoreCharacter ? FindTrack(IgnoreCharacter) : INDEX_NONE);
+	if (RewindHit.Track == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	AFPTestCharacter* Character = TrackCharacters[RewindHit.Track].Get();
+	if (!Character)
+	{
+		return nullptr;
+	}
+
+	// Fill it like the blocking hit of a line trace, so it can be handled like any other shot hit
+	OutHit = FHitResult(Character, Character->GetCapsuleComponent(), RewindHit.Location, RewindHit.Normal);
+	OutHit.bBlockingHit = true;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.Time = RewindHit.Time * MaxTime;
+	OutHit.Distance = (RewindHit.Location - Start).Size();
+	return Character;
+}
+
+void UFPTestLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWorld* const World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(LagCompensationRecord);
+
+	// Sized from the rewind window and the sample rate, so it covers the window however fast the server ticks
+	const float SampleRate = FMath::Max(GFPTestLagCompensationSampleRate, 1.0f);
+	const int32 RequiredFrames = FMath::CeilToInt32(FMath::Max(GFPTestLagCompensationMaxRewind, 0.0f) * SampleRate) + 2;
+	if (History.GetMaxFrames() != RequiredFrames)
+	{
+		History.SetMaxFrames(RequiredFrames);
+		bWarnedShortHistory = false;
+	}
+
+	// Record all characters at the end of the frame, after they moved
+	History.BeginFrame(World->GetTimeSeconds(), 1.0 / SampleRate);
+
+	FFPTestCapsulePose Pose;
+	for (int32 Track = 0; Track < TrackCharacters.Num(); Track++)
+	{
+		const AFPTestCharacter* Character = TrackCharacters[Track].Get();
+		if (!Character)
+		{
+			continue;
+		}
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		Pose.Center = Capsule->GetComponentLocation();
+		Pose.Rotation = Capsule->GetComponentQuat();
+		Pose.Radius = Capsule->GetScaledCapsuleRadius();
+		Pose.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+		History.WritePose(Track, Pose);
+	}
+}
+
+TStatId UFPTestLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+bool UFPTestLagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Benchmark
+
+static void FPTestLagCompensationBenchmark(const TArray<FString>& Args)
+{
+	// 100 characters with 1 second of history at a 60 Hz server tick
+	const int32 NumCharacters = 100;
+	const int32 TickRate = 60;
+	const int32 NumShots = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+
+	FRandomStream Random(1234);
+	FFPTestPoseHistory History;
+	History.SetMaxFrames(TickRate);
+	for (int32 Index = 0; Index < NumCharacters; Index++)
+	{
+		History.AddTrack();
+	}
+
+	// Characters walk on random lines through a 10000 x 10000 area
+	TArray<FVector> StartLocations, Velocities;
+	for (int32 Index = 0; Index < NumCharacters; Index++)
+	{
+		StartLocations.Add(FVector(Random.FRandRange(-5000.0f, 5000.0f), Random.FRandRange(-5000.0f, 5000.0f), 96.0f));
+		Velocities.Add(FVector(Random.FRandRange(-600.0f, 600.0f), Random.FRandRange(-600.0f, 600.0f), 0.0f));
+	}
+
+	FFPTestCapsulePose Pose;
+	Pose.Radius = 55.0f;
+	Pose.HalfHeight = 96.0f;
+	for (int32 Frame = 0; Frame < TickRate; Frame++)
+	{
+		const double Time = static_cast<double>(Frame) / TickRate;
+		History.BeginFrame(Time);
+		for (int32 Index = 0; Index < NumCharacters; Index++)
+		{
+			Pose.Center = StartLocations[Index] + Velocities[Index] * Time;
+			History.WritePose(Index, Pose);
+		}
+	}
+
+	// Every shot aims at a random character, so a good amount of them actually hit
+	TArray<FVector> ShotStarts, ShotEnds;
+	TArray<double> ShotTimes;
+	ShotStarts.Reserve(NumShots);
+	ShotEnds.Reserve(NumShots);
+	ShotTimes.Reserve(NumShots);
+	for (int32 Shot = 0; Shot < NumShots; Shot++)
+	{
+		const int32 Target = Random.RandHelper(NumCharacters);
+		const double Time = Random.FRandRange(0.0f, 1.0f);
+		const FVector TargetLocation = StartLocations[Target] + Velocities[Target] * Time;
+		const FVector Start = TargetLocation + Random.GetUnitVector() * 2000.0f;
+		ShotStarts.Add(Start);
+		ShotEnds.Add(Start + (TargetLocation - Start).GetSafeNormal() * 100000.0f);
+		ShotTimes.Add(Time);
+	}
+
+	int32 NumHits = 0;
+	const double StartSeconds = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < NumShots; Shot++)
+	{
+		if (History.RewindTrace(ShotTimes[Shot], ShotStarts[Shot], ShotEnds[Shot]).Track != INDEX_NONE)
+		{
+			NumHits++;
+		}
+	}
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+	UE_LOG(LogTemp, Display, TEXT("LagCompensation Benchmark: %d characters, %d frames, %d shots, %d hits, %.3f ms total, %.1f ns per shot"),
+		NumCharacters, History.GetNumFrames(), NumShots, NumHits, ElapsedSeconds * 1000.0, ElapsedSeconds * 1.0e9 / FMath::Max(NumShots, 1));
+}
+
+static FAutoConsoleCommand CmdFPTestLagCompensationBenchmark(
+	TEXT("FPTest.LagCompensation.Benchmark"),
+	TEXT("Measures the rewind cost per shot at 100 characters with 1 second of history. Optional argument: number of shots."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPTestLagCompensationBenchmark));
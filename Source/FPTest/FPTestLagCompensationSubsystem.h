@@ -0,0 +1,164 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestLagCompensationSubsystem.generated.h"
+
+class AFPTestCharacter;
+
+// Mask filter set on all primitives of a lag compensated character
+// Shot traces ignore this mask and test the rewound capsules instead of the current ones
+#define FPTEST_MASKFILTER_CHARACTER		0x01
+
+/** Capsule of a character at one point in time */
+struct FFPTestCapsulePose
+{
+	FVector Center = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	float Radius = 0.0f;
+	float HalfHeight = 0.0f;
+};
+
+/** Result of a trace against rewound capsules */
+struct FFPTestRewindHit
+{
+	/** Track which got hit, INDEX_NONE if nothing got hit */
+	int32 Track = INDEX_NONE;
+	/** Time along the traced segment, 0 is start and 1 is end */
+	float Time = 1.0f;
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::ZeroVector;
+};
+
+/**
+ * Fixed size history of capsule poses, one track per character
+ * Memory is allocated once for MaxFrames * track capacity and only grows when more tracks are added than ever before
+ * Poses are stored frame major, so rewinding all tracks to one point in time reads two contiguous rows
+ */
+class FPTEST_API FFPTestPoseHistory
+{
+public:
+	/** Amount of frames we keep, has to cover the max rewind time at the sample rate */
+	int32 GetMaxFrames() const { return MaxFrames; }
+
+	/** Reallocates the frames and drops all recorded poses, the tracks are kept */
+	void SetMaxFrames(int32 NewMaxFrames);
+
+	/** Adds a track and returns its index, the track only has valid poses from the next frame on */
+	int32 AddTrack();
+
+	/** Removes a track, its index might get reused by a later AddTrack */
+	void RemoveTrack(int32 Track);
+
+	/**
+	 * Starts a new frame, the poses of all tracks get written with WritePose afterwards
+	 * The newest frame gets replaced instead until it is MinInterval newer than the one before it,
+	 * so the older frames are at least MinInterval apart however fast the server ticks
+	 */
+	void BeginFrame(double Time, double MinInterval = 0.0);
+
+	/** Writes the pose of a track into the current frame */
+	void WritePose(int32 Track, const FFPTestCapsulePose& Pose);
+
+	/** Time of the oldest and newest frame, returns false if there is no frame yet */
+	bool GetTimeRange(double& OutOldest, double& OutNewest) const;
+
+	/** Finds the two frames around Time and the interpolation alpha between them, Time is clamped to the history */
+	bool FindFrames(double Time, int32& OutOlder, int32& OutNewer, float& OutAlpha) const;
+
+	/** Interpolated pose of a track between two frames, returns false if the track has no pose in these frames */
+	bool GetPose(int32 Track, int32 Older, int32 Newer, float Alpha, FFPTestCapsulePose& OutPose) const;
+
+	/** Rewinds all tracks to Time and finds the closest capsule hit along Start to End, never allocates */
+	FFPTestRewindHit RewindTrace(double Time, const FVector& Start, const FVector& End, int32 IgnoreTrack = INDEX_NONE) const;
+
+	int32 GetNumFrames() const { return NumFrames; }
+
+private:
+	/** Index into Poses for the given frame and track */
+	FORCEINLINE int32 PoseIndex(int32 Frame, int32 Track) const { return Frame * TrackCapacity + Track; }
+
+	/** Physical frame index of the logical index, 0 is the oldest frame */
+	FORCEINLINE int32 FrameAt(int32 LogicalIndex) const { return (HeadFrame - NumFrames + 1 + LogicalIndex + MaxFrames) % MaxFrames; }
+
+	/** Grows the storage, only happens when adding a track */
+	void GrowTracks(int32 NewTrackCapacity);
+
+	/** All poses, MaxFrames rows of TrackCapacity poses */
+	TArray<FFPTestCapsulePose> Poses;
+
+	/** Time of each frame */
+	TArray<double> FrameTimes;
+
+	/** Running frame number of each frame, used to know if a track already existed in that frame */
+	TArray<uint64> FrameNumbers;
+
+	/** Frame number from which on a track has valid poses */
+	TArray<uint64> TrackFirstFrame;
+
+	/** Tracks which are currently in use */
+	TBitArray<> ActiveTracks;
+
+	/** Removed tracks which can be reused */
+	TArray<int32> FreeTracks;
+
+	int32 MaxFrames = 0;
+	int32 TrackCapacity = 0;
+	int32 NumTracks = 0;
+	int32 HeadFrame = 0;
+	int32 NumFrames = 0;
+	uint64 FrameCounter = 0;
+};
+
+/**
+ * Server side lag compensation
+ * Records the capsule of every character at FPTest.LagCompensation.SampleRate, so shots can be traced against the world
+ * like the shooting client saw it at the time it fired. The history is sized to cover FPTest.LagCompensation.MaxRewind.
+ * Only the capsule is recorded, not the bodies of the character mesh: the characters only have the owner only arms mesh,
+ * and servers strip the pose of their meshes (see FFPTestCosmetics), so the capsule is the only hit shape they have.
+ */
+UCLASS()
+class FPTEST_API UFPTestLagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Starts recording the character, only done on the server */
+	void RegisterCharacter(AFPTestCharacter* Character);
+
+	/** Stops recording the character */
+	void UnregisterCharacter(AFPTestCharacter* Character);
+
+	/** If shots should be traced against the rewound capsules */
+	bool IsEnabled() const;
+
+	/**
+	 * Traces the rewound capsules of all characters but the IgnoreCharacter
+	 * MaxTime limits the segment, so a blocking hit of the world trace can be passed in
+	 * Returns the character which got hit and fills OutHit like a blocking hit of a line trace
+	 */
+	AFPTestCharacter* RewindTrace(double Time, const FVector& Start, const FVector& End, float MaxTime, const AFPTestCharacter* IgnoreCharacter, FHitResult& OutHit) const;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Index of the track of the character, INDEX_NONE if not registered */
+	int32 FindTrack(const AFPTestCharacter* Character) const;
+
+	/** Recorded poses of all characters */
+	FFPTestPoseHistory History;
+
+	/** Character of each track, indexed by track */
+	TArray<TWeakObjectPtr<AFPTestCharacter>> TrackCharacters;
+
+	/** If we already warned about a history shorter than the rewind window */
+	mutable bool bWarnedShortHistory = false;
+};
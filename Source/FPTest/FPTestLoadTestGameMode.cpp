@@ -0,0 +1,348 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestLoadTestGameMode.h"
+#include "FPTestBotController.h"
+#include "FPTestCosmetics.h"
+#include "FPTestCounters.h"
+#include "FPTestDemoNetDriver.h"
+#include "FPTestReplicationStats.h"
+#include "Dom/JsonObject.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace FPTestLoadTest
+{
+	/** Adds average, percentiles and max of the samples to the json object */
+	static TSharedRef<FJsonObject> MakeDistribution(TArray<float> Samples)
+	{
+		TSharedRef<FJsonObject> Distribution = MakeShared<FJsonObject>();
+		if (Samples.Num() == 0)
+		{
+			return Distribution;
+		}
+
+		Samples.Sort();
+		double Sum = 0.0;
+		for (const float Sample : Samples)
+		{
+			Sum += Sample;
+		}
+
+		const auto Percentile = [&Samples](float Fraction)
+		{
+			return Samples[FMath::Clamp(FMath::FloorToInt32(Fraction * Samples.Num()), 0, Samples.Num() - 1)];
+		};
+
+		Distribution->SetNumberField(TEXT("avg"), Sum / Samples.Num());
+		Distribution->SetNumberField(TEXT("p50"), Percentile(0.50f));
+		Distribution->SetNumberField(TEXT("p95"), Percentile(0.95f));
+		Distribution->SetNumberField(TEXT("p99"), Percentile(0.99f));
+		Distribution->SetNumberField(TEXT("max"), Samples.Last());
+		return Distribution;
+	}
+
+	/** Number at Object.Field of the results, false if there is none */
+	static bool GetResult(const FJsonObject& Results, const TCHAR* Object, const TCHAR* Field, double& OutValue)
+	{
+		const TSharedPtr<FJsonObject>* Child = nullptr;
+		return Results.TryGetObjectField(Object, Child) && Child->IsValid() && (*Child)->TryGetNumberField(Field, OutValue);
+	}
+
+	/** This run against the results of an earlier one, nullptr if those can not be read */
+	static TSharedPtr<FJsonObject> MakeComparison(const FString& BaselinePath, const FJsonObject& Results)
+	{
+		FString BaselineJson;
+		TSharedPtr<FJsonObject> Baseline;
+		if (!FFileHelper::LoadFileToString(BaselineJson, *BaselinePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineJson), Baseline) || !Baseline.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("LoadTest: could not read the baseline %s"), *BaselinePath);
+			return nullptr;
+		}
+
+		double BaselineBots = 0.0;
+		Baseline->TryGetNumberField(TEXT("bots"), BaselineBots);
+		UE_CLOG(BaselineBots != Results.GetNumberField(TEXT("bots")), LogTemp, Warning, TEXT("LoadTest: the baseline ran %.0f bots, this run %.0f"),
+			BaselineBots, Results.GetNumberField(TEXT("bots")));
+
+		TSharedRef<FJsonObject> Comparison = MakeShared<FJsonObject>();
+		Comparison->SetStringField(TEXT("baseline"), BaselinePath);
+		Comparison->SetNumberField(TEXT("baselineBots"), BaselineBots);
+
+		const TSharedPtr<FJsonObject>* BaselinePerBot = nullptr;
+		bool bBaselineStripped = false;
+		if (Baseline->TryGetObjectField(TEXT("perBot"), BaselinePerBot) && BaselinePerBot->IsValid())
+		{
+			(*BaselinePerBot)->TryGetBoolField(TEXT("cosmeticsStripped"), bBaselineStripped);
+		}
+		Comparison->SetBoolField(TEXT("baselineCosmeticsStripped"), bBaselineStripped);
+
+		const auto Compare = [&](const TCHAR* Object, const TCHAR* Field)
+		{
+			double Value = 0.0;
+			double BaselineValue = 0.0;
+			if (!GetResult(Results, Object, Field, Value) || !GetResult(*Baseline, Object, Field, BaselineValue))
+			{
+				return;
+			}
+
+			TSharedRef<FJsonObject> Difference = MakeShared<FJsonObject>();
+			Difference->SetNumberField(TEXT("baseline"), BaselineValue);
+			Difference->SetNumberField(TEXT("run"), Value);
+			Difference->SetNumberField(TEXT("difference"), Value - BaselineValue);
+			Comparison->SetObjectField(FString::Printf(TEXT("%s.%s"), Object, Field), Difference);
+
+			UE_LOG(LogTemp, Display, TEXT("LoadTest: %s.%s %.4f, baseline %.4f, difference %+.4f"), Object, Field, Value, BaselineValue, Value - BaselineValue);
+		};
+
+		Compare(TEXT("perBot"), TEXT("gameThreadMs"));
+		Compare(TEXT("perBot"), TEXT("usedPhysicalKB"));
+		Compare(TEXT("gameThreadMs"), TEXT("avg"));
+		Compare(TEXT("gameThreadMs"), TEXT("p95"));
+		Compare(TEXT("memory"), TEXT("peakUsedPhysicalMB"));
+		return Comparison;
+	}
+}
+
+AFPTestLoadTestGameMode::AFPTestLoadTestGameMode()
+	: Super()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	BotControllerClass = AFPTestBotController::StaticClass();
+}
+
+void AFPTestLoadTestGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	NumBots = UGameplayStatics::GetIntOption(Options, TEXT("Bots"), NumBots);
+	WarmupSeconds = UGameplayStatics::HasOption(Options, TEXT("Warmup")) ? FCString::Atof(*UGameplayStatics::ParseOption(Options, TEXT("Warmup"))) : WarmupSeconds;
+	DurationSeconds = UGameplayStatics::HasOption(Options, TEXT("Duration")) ? FCString::Atof(*UGameplayStatics::ParseOption(Options, TEXT("Duration"))) : DurationSeconds;
+	bExitWhenDone = UGameplayStatics::GetIntOption(Options, TEXT("ExitWhenDone"), bExitWhenDone ? 1 : 0) != 0;
+}
+
+void AFPTestLoadTestGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	UsedPhysicalBeforeBots = FPlatformMemory::GetStats().UsedPhysical;
+	SpawnBots();
+}
+
+void AFPTestLoadTestGameMode::SpawnBots()
+{
+	UWorld* const World = GetWorld();
+	if (!World || !BotControllerClass)
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 Index = 0; Index < NumBots; Index++)
+	{
+		AFPTestBotController* Bot = World->SpawnActor<AFPTestBotController>(BotControllerClass, SpawnParams);
+		if (!Bot)
+		{
+			continue;
+		}
+
+		RestartPlayer(Bot);
+
+		// All bots would stand in each other at the same player start, so spread them on a circle
+		if (APawn* BotPawn = Bot->GetPawn())
+		{
+			const float Angle = 2.0f * PI * Index / FMath::Max(NumBots, 1);
+			const FVector Offset(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f);
+			BotPawn->SetActorLocation(BotPawn->GetActorLocation() + Offset * (200.0f + 10.0f * NumBots), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("LoadTest: spawned %d bots, warmup %.1f s, duration %.1f s"), NumBots, WarmupSeconds, DurationSeconds);
+}
+
+void AFPTestLoadTestGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	PhaseTime += DeltaSeconds;
+
+	switch (Phase)
+	{
+	case ELoadTestPhase::Warmup:
+		if (PhaseTime >= WarmupSeconds)
+		{
+			BeginMeasuring();
+		}
+		break;
+	case ELoadTestPhase::Measuring:
+		FrameTimesMs.Add(DeltaSeconds * 1000.0f);
+		GameThreadTimesMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+		if (const UFPTestDemoNetDriver* DemoNetDriver = Cast<UFPTestDemoNetDriver>(GetWorld()->GetDemoNetDriver()))
+		{
+			// The demo driver flushes after the game mode ticked, so this is the recording of the frame before
+			ReplayRecordTimesMs.Add(DemoNetDriver->GetLastRecordMs());
+		}
+		if (PhaseTime >= DurationSeconds)
+		{
+			FinishMeasuring();
+		}
+		break;
+	case ELoadTestPhase::Done:
+		break;
+	}
+}
+
+void AFPTestLoadTestGameMode::BeginMeasuring()
+{
+	Phase = ELoadTestPhase::Measuring;
+	PhaseTime = 0.0f;
+
+	const int32 ExpectedFrames = FMath::CeilToInt32(DurationSeconds * 120.0f);
+	FrameTimesMs.Reset(ExpectedFrames);
+	GameThreadTimesMs.Reset(ExpectedFrames);
+	ReplayRecordTimesMs.Reset(GetReplayName().IsEmpty() ? 0 : ExpectedFrames);
+
+	// The totals of the same counters the stats and the csv show
+	StartShotsFired = FFPTestCounters::Get(EFPTestCounter::ShotsFired);
+	StartShotsResolved = FFPTestCounters::Get(EFPTestCounter::ShotsResolved);
+	StartCharacterHits = FFPTestCounters::Get(EFPTestCounter::CharacterHits);
+	StartServerRPCs = FFPTestCounters::Get(EFPTestCounter::RPCsReceived);
+	StartPickUps = FFPTestCounters::Get(EFPTestCounter::PickUps);
+	StartShotViolations = FFPTestCounters::Get(EFPTestCounter::ShotViolations);
+
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		StartNetInBytes = NetDriver->InTotalBytes;
+		StartNetOutBytes = NetDriver->OutTotalBytes;
+	}
+
+	PeakUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	UsedPhysicalWithBots = PeakUsedPhysical;
+
+	UE_LOG(LogTemp, Display, TEXT("LoadTest: measuring"));
+}
+
+void AFPTestLoadTestGameMode::FinishMeasuring()
+{
+	Phase = ELoadTestPhase::Done;
+
+	FString OutputPath;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("FPTestLoadTestOutput="), OutputPath))
+	{
+		OutputPath = FPaths::ProjectSavedDir() / TEXT("LoadTest") / FString::Printf(TEXT("LoadTest-%s.json"), *FDateTime::Now().ToString());
+	}
+
+	if (WriteResults(OutputPath))
+	{
+		UE_LOG(LogTemp, Display, TEXT("LoadTest: results written to %s"), *OutputPath);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("LoadTest: could not write results to %s"), *OutputPath);
+	}
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+bool AFPTestLoadTestGameMode::WriteResults(const FString& Path) const
+{
+	const double Seconds = FMath::Max(PhaseTime, UE_SMALL_NUMBER);
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	TSharedRef<FJsonObject> Results = MakeShared<FJsonObject>();
+	Results->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Results->SetNumberField(TEXT("bots"), NumBots);
+	Results->SetNumberField(TEXT("durationSeconds"), Seconds);
+	Results->SetNumberField(TEXT("frames"), FrameTimesMs.Num());
+	Results->SetObjectField(TEXT("frameMs"), FPTestLoadTest::MakeDistribution(FrameTimesMs));
+	Results->SetObjectField(TEXT("gameThreadMs"), FPTestLoadTest::MakeDistribution(GameThreadTimesMs));
+
+	// The server only receives server RPCs, the bots of a standalone run call them locally and count them the same way
+	const int64 ServerRPCs = FFPTestCounters::Get(EFPTestCounter::RPCsReceived) - StartServerRPCs;
+	Results->SetNumberField(TEXT("shotsFiredPerSecond"), (FFPTestCounters::Get(EFPTestCounter::ShotsFired) - StartShotsFired) / Seconds);
+	Results->SetNumberField(TEXT("shotsResolvedPerSecond"), (FFPTestCounters::Get(EFPTestCounter::ShotsResolved) - StartShotsResolved) / Seconds);
+	Results->SetNumberField(TEXT("characterHitsPerSecond"), (FFPTestCounters::Get(EFPTestCounter::CharacterHits) - StartCharacterHits) / Seconds);
+	Results->SetNumberField(TEXT("serverRPCs"), ServerRPCs);
+	Results->SetNumberField(TEXT("serverRPCsPerSecond"), ServerRPCs / Seconds);
+	Results->SetNumberField(TEXT("pickUps"), FFPTestCounters::Get(EFPTestCounter::PickUps) - StartPickUps);
+	Results->SetNumberField(TEXT("shotViolations"), FFPTestCounters::Get(EFPTestCounter::ShotViolations) - StartShotViolations);
+
+	TSharedRef<FJsonObject> Net = MakeShared<FJsonObject>();
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		Net->SetNumberField(TEXT("connections"), NetDriver->ClientConnections.Num());
+		Net->SetNumberField(TEXT("inBytesPerSecond"), (NetDriver->InTotalBytes - StartNetInBytes) / Seconds);
+		Net->SetNumberField(TEXT("outBytesPerSecond"), (NetDriver->OutTotalBytes - StartNetOutBytes) / Seconds);
+	}
+
+	const FFPTestReplicationStats ReplicationStats = FFPTestReplicationStats::Gather(*GetWorld());
+	Net->SetNumberField(TEXT("replicatedActors"), ReplicationStats.NumActors);
+	Net->SetNumberField(TEXT("dormantActors"), ReplicationStats.NumDormantActors);
+	Net->SetNumberField(TEXT("comparedPropertiesPerTickBefore"), ReplicationStats.ComparedPerTickBefore);
+	Net->SetNumberField(TEXT("comparedPropertiesPerTickAfter"), ReplicationStats.ComparedPerTickAfter);
+	Results->SetObjectField(TEXT("net"), Net);
+
+	if (!GetReplayName().IsEmpty())
+	{
+		// The file grows from the start of the recording, so the rate is taken over the whole recording
+		const int64 ReplayBytes = IFileManager::Get().FileSize(*(FPaths::ProjectSavedDir() / TEXT("Demos") / (GetReplayName() + TEXT(".replay"))));
+		const double ReplayMinutes = FMath::Max(GetWorld()->GetTimeSeconds() - GetReplayStartTime(), UE_DOUBLE_SMALL_NUMBER) / 60.0;
+
+		TSharedRef<FJsonObject> Replay = MakeShared<FJsonObject>();
+		Replay->SetStringField(TEXT("name"), GetReplayName());
+		Replay->SetObjectField(TEXT("recordMs"), FPTestLoadTest::MakeDistribution(ReplayRecordTimesMs));
+		Replay->SetNumberField(TEXT("fileBytes"), FMath::Max<int64>(ReplayBytes, 0));
+		Replay->SetNumberField(TEXT("megabytesPerMinute"), FMath::Max<int64>(ReplayBytes, 0) / (1024.0 * 1024.0) / ReplayMinutes);
+		Results->SetObjectField(TEXT("replay"), Replay);
+	}
+
+	TSharedRef<FJsonObject> Memory = MakeShared<FJsonObject>();
+	Memory->SetNumberField(TEXT("usedPhysicalMB"), MemoryStats.UsedPhysical / (1024.0 * 1024.0));
+	Memory->SetNumberField(TEXT("peakUsedPhysicalMB"), PeakUsedPhysical / (1024.0 * 1024.0));
+	Memory->SetNumberField(TEXT("usedVirtualMB"), MemoryStats.UsedVirtual / (1024.0 * 1024.0));
+	Results->SetObjectField(TEXT("memory"), Memory);
+
+	// What one bot with its character and weapon costs the server
+	double GameThreadMsSum = 0.0;
+	for (const float GameThreadMs : GameThreadTimesMs)
+	{
+		GameThreadMsSum += GameThreadMs;
+	}
+	const int32 NumBotsDivisor = FMath::Max(NumBots, 1);
+
+	TSharedRef<FJsonObject> PerBot = MakeShared<FJsonObject>();
+	PerBot->SetBoolField(TEXT("cosmeticsStripped"), FFPTestCosmetics::AreStripped(GetWorld()));
+	PerBot->SetNumberField(TEXT("gameThreadMs"), GameThreadTimesMs.Num() > 0 ? GameThreadMsSum / GameThreadTimesMs.Num() / NumBotsDivisor : 0.0);
+	PerBot->SetNumberField(TEXT("usedPhysicalKB"), (static_cast<double>(UsedPhysicalWithBots) - static_cast<double>(UsedPhysicalBeforeBots)) / 1024.0 / NumBotsDivisor);
+	Results->SetObjectField(TEXT("perBot"), PerBot);
+
+	// Against a run with the other settings, e.g. what stripping the cosmetics saves
+	FString BaselinePath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("FPTestLoadTestBaseline="), BaselinePath))
+	{
+		if (const TSharedPtr<FJsonObject> Comparison = FPTestLoadTest::MakeComparison(BaselinePath, *Results))
+		{
+			Results->SetObjectField(TEXT("comparison"), Comparison);
+		}
+	}
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Results, Writer))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(Json, *Path);
+}
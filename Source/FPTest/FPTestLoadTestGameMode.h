@@ -0,0 +1,104 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FPTestGameMode.h"
+#include "FPTestLoadTestGameMode.generated.h"
+
+class AFPTestBotController;
+
+/**
+ * Game mode for headless load tests
+ * Spawns bots which pick up weapons and fire continuously, measures the server and writes the results as json
+ *
+ * Example, without a GPU:
+ * UnrealEditor FPTest.uproject /Game/FirstPerson/Maps/FirstPersonMap?listen?game=/Script/FPTest.FPTestLoadTestGameMode?Bots=64?Warmup=10?Duration=60
+ *     -game -nullrhi -nosound -unattended -FPTestLoadTestOutput=LoadTest.json
+ *
+ * With ?Replay=1 the match is recorded and the results contain the recording time per frame and the replay size per minute.
+ * For the overhead compare against the same run without it, e.g. ?Bots=32 with and without ?Replay=1.
+ *
+ * The per bot game thread time and memory show what the cosmetics cost, compare a dedicated server with 64 bots
+ * with and without them: -server -nullrhi ...?Bots=64 and the same with -dpcvars=FPTest.Cosmetics.Strip=0
+ * -FPTestLoadTestBaseline=<results of the other run> adds the differences to the results, see LoadTest.md
+ */
+UCLASS(minimalapi)
+class AFPTestLoadTestGameMode : public AFPTestGameMode
+{
+	GENERATED_BODY()
+
+public:
+	AFPTestLoadTestGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Bot class to spawn */
+	UPROPERTY(EditDefaultsOnly, Category = LoadTest)
+	TSubclassOf<AFPTestBotController> BotControllerClass;
+
+	/** Amount of bots, can be overridden with ?Bots= */
+	UPROPERTY(EditAnywhere, Category = LoadTest)
+	int32 NumBots = 32;
+
+	/** Seconds before the measurement starts, so all bots got a weapon. Can be overridden with ?Warmup= */
+	UPROPERTY(EditAnywhere, Category = LoadTest)
+	float WarmupSeconds = 10.0f;
+
+	/** Seconds the measurement runs, can be overridden with ?Duration= */
+	UPROPERTY(EditAnywhere, Category = LoadTest)
+	float DurationSeconds = 60.0f;
+
+	/** If the game exits once the results are written, can be overridden with ?ExitWhenDone= */
+	UPROPERTY(EditAnywhere, Category = LoadTest)
+	bool bExitWhenDone = true;
+
+protected:
+	/** Spawns the bots at the player starts */
+	void SpawnBots();
+
+	/** Remembers the counters at the start of the measurement */
+	void BeginMeasuring();
+
+	/** Writes the results and exits if wanted */
+	void FinishMeasuring();
+
+	/** Writes the results to the file, returns false if that failed */
+	bool WriteResults(const FString& Path) const;
+
+private:
+	enum class ELoadTestPhase : uint8
+	{
+		Warmup,
+		Measuring,
+		Done
+	};
+
+	ELoadTestPhase Phase = ELoadTestPhase::Warmup;
+	float PhaseTime = 0.0f;
+
+	/** Frame time of every measured frame */
+	TArray<float> FrameTimesMs;
+
+	/** Game thread time of every measured frame */
+	TArray<float> GameThreadTimesMs;
+
+	/** Replay recording time of every measured frame, empty if not recording */
+	TArray<float> ReplayRecordTimesMs;
+
+	int64 StartShotsFired = 0;
+	int64 StartShotsResolved = 0;
+	int64 StartCharacterHits = 0;
+	int64 StartServerRPCs = 0;
+	int64 StartPickUps = 0;
+	int64 StartShotViolations = 0;
+	uint64 StartNetInBytes = 0;
+	uint64 StartNetOutBytes = 0;
+	uint64 PeakUsedPhysical = 0;
+
+	/** Memory before the bots got spawned and once they all have a weapon */
+	uint64 UsedPhysicalBeforeBots = 0;
+	uint64 UsedPhysicalWithBots = 0;
+};
@@ -0,0 +1,261 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestPenetration.h"
+#include "FPTestCharacter.h"
+#include "FPTestLagCompensationSubsystem.h"
+#include "FPTestStats.h"
+#include "TP_WeaponComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+static float GFPTestPenetrationMinDamageScale = 0.1f;
+static FAutoConsoleVariableRef CVarFPTestPenetrationMinDamageScale(
+	TEXT("FPTest.Penetration.MinDamageScale"),
+	GFPTestPenetrationMinDamageScale,
+	TEXT("A shot stops once less than this part of its damage is left."));
+
+namespace FPTestPenetration
+{
+	/** Distance the next trace starts behind an exit, so it does not hit the same surface again */
+	static constexpr float ExitOffset = 0.1f;
+
+	/** Hits a shot usually has, so the buffer does not grow for the first shots */
+	static constexpr int32 ReservedHits = 8;
+}
+
+const FFPTestPenetrationMaterial& UFPTestPenetrationTable::Find(const UPhysicalMaterial* PhysicalMaterial) const
+{
+	if (PhysicalMaterial)
+	{
+		for (const FFPTestPenetrationMaterial& Material : Materials)
+		{
+			if (Material.PhysicalMaterial == PhysicalMaterial)
+			{
+				return Material;
+			}
+		}
+	}
+	return Default;
+}
+
+FFPTestPenetrationResolver::FFPTestPenetrationResolver()
+{
+	Hits.Reserve(FPTestPenetration::ReservedHits);
+}
+
+void FFPTestPenetrationResolver::Resolve(const UWorld& World, const FFPTestPenetrationShot& Shot, const FHitResult* FirstWorldHit)
+{
+	Hits.Reset();
+
+	const FVector Segment = Shot.EndLocation - Shot.StartLocation;
+	const double ShotLength = Segment.Size();
+	if (ShotLength <= UE_KINDA_SMALL_NUMBER || !Shot.QueryParams)
+	{
+		return;
+	}
+	const FVector Direction = Segment / ShotLength;
+
+	// Characters already hit get ignored, the params are copied so the batch keeps its own
+	FCollisionQueryParams QueryParams = *Shot.QueryParams;
+	const AFPTestCharacter* IgnoreCharacter = Shot.Shooter;
+
+	FVector SegmentStart = Shot.StartLocation;
+	float DamageScale = 1.0f;
+	int32 PenetrationsLeft = Shot.MaxPenetrations;
+
+	FHitResult WorldHit;
+	bool bWorldHit = FirstWorldHit != nullptr;
+	if (FirstWorldHit)
+	{
+		WorldHit = *FirstWorldHit;
+	}
+
+	for (bool bFirstSegment = true; ; bFirstSegment = false)
+	{
+		// The first segment got traced in the batch of the resolver
+		if (!bFirstSegment)
+		{
+			bWorldHit = World.LineTraceSingleByChannel(WorldHit, SegmentStart, Shot.EndLocation, COLLISION_SHOTTRACE, QueryParams);
+			FPTEST_COUNT(Traces, 1);
+		}
+
+		// The world trace did not see the characters, so test their rewound capsules up to the world hit
+		FHitResult RewindHit;
+		const AFPTestCharacter* HitCharacter = nullptr;
+		if (Shot.LagCompensation)
+		{
+			HitCharacter = Shot.LagCompensation->RewindTrace(Shot.ShotTime, SegmentStart, Shot.EndLocation, bWorldHit ? WorldHit.Time : 1.0f, IgnoreCharacter, RewindHit);
+		}
+
+		const FHitResult* Hit = HitCharacter ? &RewindHit : (bWorldHit ? &WorldHit : nullptr);
+		if (!Hit)
+		{
+			break;
+		}
+		HitCharacter = HitCharacter ? HitCharacter : Cast<AFPTestCharacter>(Hit->GetActor());
+
+		Hits.Add({ *Hit, DamageScale });
+
+		if (PenetrationsLeft-- <= 0 || !Shot.Table)
+		{
+			break;
+		}
+
+		const FFPTestPenetrationMaterial& Material = HitCharacter ? Shot.Table->Characters : Shot.Table->Find(Hit->PhysMaterial.Get());
+		if (Material.MaxThickness <= 0.0f)
+		{
+			break;
+		}
+
+		FVector Exit;
+		if (HitCharacter)
+		{
+			// Capsules are convex and not traced against, the way through is their width
+			const UCapsuleComponent* Capsule = HitCharacter->GetCapsuleComponent();
+			Exit = Hit->Location + Direction * (Capsule ? 2.0f * Capsule->GetScaledCapsuleRadius() : 0.0f);
+			IgnoreCharacter = HitCharacter;
+			QueryParams.AddIgnoredActor(HitCharacter);
+		}
+		else if (!FindExit(*Hit, Direction, Material.MaxThickness, Exit))
+		{
+			break;
+		}
+
+		const float Thickness = FVector::Dist(Hit->Location, Exit);
+		if (Thickness > Material.MaxThickness)
+		{
+			break;
+		}
+
+		DamageScale *= FMath::Max(1.0f - Thickness * Material.DamageFalloffPerCm, 0.0f);
+		if (DamageScale < GFPTestPenetrationMinDamageScale)
+		{
+			break;
+		}
+
+		SegmentStart = Exit + Direction * FPTestPenetration::ExitOffset;
+		if (FVector::DotProduct(SegmentStart - Shot.StartLocation, Direction) >= ShotLength)
+		{
+			break;
+		}
+	}
+}
+
+bool FFPTestPenetrationResolver::FindExit(const FHitResult& Hit, const FVector& Direction, float MaxThickness, FVector& OutExit) const
+{
+	UPrimitiveComponent* Component = Hit.GetComponent();
+	if (!Component)
+	{
+		return false;
+	}
+
+	// Traced backwards against the hit component only, the first hit from behind is where the shot comes out
+	FHitResult ExitHit;
+	const FVector TraceStart = Hit.Location + Direction * MaxThickness;
+	if (!Component->LineTraceComponent(ExitHit, TraceStart, Hit.Location, FCollisionQueryParams(SCENE_QUERY_STAT(FPTestPenetrationExit))))
+	{
+		return false;
+	}
+	FPTEST_COUNT(Traces, 1);
+
+	// Starting inside means the component is thicker than what we traced
+	if (ExitHit.bStartPenetrating)
+	{
+		return false;
+	}
+
+	OutExit = ExitHit.Location;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Benchmark
+
+static void FPTestPenetrationBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	const int32 NumShots = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+	const int32 MaxPenetrations = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 4;
+	const float ShotLength = 10000.0f;
+
+	// Shots start at the characters of the map and go in random directions, so they see the same geometry as real shots
+	TArray<FVector> Origins;
+	for (TActorIterator<AFPTestCharacter> It(World); It; ++It)
+	{
+		Origins.Add(It->GetActorLocation());
+	}
+	if (Origins.Num() == 0)
+	{
+		Origins.Add(FVector::ZeroVector);
+	}
+
+	FRandomStream Random(1234);
+	TArray<FVector> ShotStarts, ShotEnds;
+	ShotStarts.Reserve(NumShots);
+	ShotEnds.Reserve(NumShots);
+	for (int32 Shot = 0; Shot < NumShots; Shot++)
+	{
+		FVector Direction = Random.GetUnitVector();
+		Direction.Z *= 0.25f;
+		Direction = Direction.GetSafeNormal();
+
+		// Outside of the capsule, like the muzzle
+		const FVector Start = Origins[Random.RandHelper(Origins.Num())] + Direction * 100.0f;
+		ShotStarts.Add(Start);
+		ShotEnds.Add(Start + Direction * ShotLength);
+	}
+
+	// Goes through thin walls and characters
+	UFPTestPenetrationTable* Table = NewObject<UFPTestPenetrationTable>();
+	Table->Default.MaxThickness = 30.0f;
+	Table->Default.DamageFalloffPerCm = 0.02f;
+	Table->Characters.MaxThickness = 200.0f;
+	Table->Characters.DamageFalloffPerCm = 0.002f;
+
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FPTestShotTrace));
+
+	// What the resolver did before, the first blocking hit only
+	int32 NumSingleHits = 0;
+	FHitResult Hit;
+	double StartSeconds = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < NumShots; Shot++)
+	{
+		NumSingleHits += World->LineTraceSingleByChannel(Hit, ShotStarts[Shot], ShotEnds[Shot], COLLISION_SHOTTRACE, QueryParams) ? 1 : 0;
+	}
+	const double SingleSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+	FFPTestPenetrationResolver Resolver;
+	FFPTestPenetrationShot PenetrationShot;
+	PenetrationShot.Table = Table;
+	PenetrationShot.MaxPenetrations = MaxPenetrations;
+	PenetrationShot.QueryParams = &QueryParams;
+
+	int32 NumPenetrationHits = 0;
+	StartSeconds = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < NumShots; Shot++)
+	{
+		PenetrationShot.StartLocation = ShotStarts[Shot];
+		PenetrationShot.EndLocation = ShotEnds[Shot];
+		const bool bHit = World->LineTraceSingleByChannel(Hit, ShotStarts[Shot], ShotEnds[Shot], COLLISION_SHOTTRACE, QueryParams);
+		Resolver.Resolve(*World, PenetrationShot, bHit ? &Hit : nullptr);
+		NumPenetrationHits += Resolver.GetHits().Num();
+	}
+	const double PenetrationSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+	UE_LOG(LogTemp, Display, TEXT("Penetration Benchmark: %d shots, %d origins, max %d penetrations"), NumShots, Origins.Num(), MaxPenetrations);
+	UE_LOG(LogTemp, Display, TEXT("  Single hit:  %d hits, %.3f ms total, %.2f us per shot"),
+		NumSingleHits, SingleSeconds * 1000.0, SingleSeconds * 1.0e6 / FMath::Max(NumShots, 1));
+	UE_LOG(LogTemp, Display, TEXT("  Penetration: %d hits, %.3f ms total, %.2f us per shot"),
+		NumPenetrationHits, PenetrationSeconds * 1000.0, PenetrationSeconds * 1.0e6 / FMath::Max(NumShots, 1));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFPTestPenetrationBenchmark(
+	TEXT("FPTest.Penetration.Benchmark"),
+	TEXT("Compares the cost per shot of the single hit trace and the penetration in the current map. Optional arguments: number of shots, max penetrations."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPTestPenetrationBenchmark));
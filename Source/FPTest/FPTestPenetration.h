@@ -0,0 +1,116 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/HitResult.h"
+#include "FPTestPenetration.generated.h"
+
+class AFPTestCharacter;
+class UFPTestLagCompensationSubsystem;
+class UPhysicalMaterial;
+struct FCollisionQueryParams;
+
+/** How shots go through one physical material */
+USTRUCT(BlueprintType)
+struct FPTEST_API FFPTestPenetrationMaterial
+{
+	GENERATED_BODY()
+
+	/** Material this applies to */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration)
+	TObjectPtr<UPhysicalMaterial> PhysicalMaterial;
+
+	/** Thickest part a shot still goes through, 0 stops every shot */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration, meta = (ClampMin = "0", Units = "cm"))
+	float MaxThickness = 0.0f;
+
+	/** Part of the damage lost per cm of the material */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration, meta = (ClampMin = "0", ClampMax = "1"))
+	float DamageFalloffPerCm = 0.05f;
+};
+
+/**
+ * Which surfaces shots go through and how much damage they lose on the way
+ * Shared by all weapons using it, a weapon without a table stops at the first hit
+ */
+UCLASS(BlueprintType)
+class FPTEST_API UFPTestPenetrationTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Materials with their own values, a shot only looks at a few of them so they are searched in order */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration)
+	TArray<FFPTestPenetrationMaterial> Materials;
+
+	/** Surfaces without a material or with one which is not in the list */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration)
+	FFPTestPenetrationMaterial Default;
+
+	/** Characters, their capsule counts as thick as it is wide */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Penetration)
+	FFPTestPenetrationMaterial Characters;
+
+	/** Entry of the material, Default if it has none */
+	const FFPTestPenetrationMaterial& Find(const UPhysicalMaterial* PhysicalMaterial) const;
+};
+
+/** One hit of a shot going through things */
+struct FFPTestPenetrationHit
+{
+	FHitResult Hit;
+
+	/** Part of the damage and impulse which is left at this hit */
+	float DamageScale = 1.0f;
+};
+
+/** Everything the penetration of one shot needs */
+struct FFPTestPenetrationShot
+{
+	FVector StartLocation = FVector::ZeroVector;
+	FVector EndLocation = FVector::ZeroVector;
+
+	/** Server time the client fired at, for the rewound characters */
+	double ShotTime = 0.0;
+
+	/** Never hit by its own shots */
+	const AFPTestCharacter* Shooter = nullptr;
+
+	const UFPTestPenetrationTable* Table = nullptr;
+
+	/** Surfaces the shot may go through after the first hit */
+	int32 MaxPenetrations = 0;
+
+	/** Query params of the world traces */
+	const FCollisionQueryParams* QueryParams = nullptr;
+
+	/** Set if the world traces do not see the characters and they are tested against their rewound capsules */
+	const UFPTestLagCompensationSubsystem* LagCompensation = nullptr;
+};
+
+/**
+ * Follows a shot through everything its table lets it penetrate
+ * The first world hit comes from the batched trace of the resolver, only shots going into a penetrable surface trace again:
+ * backwards through the hit component to find the exit, then on from there. Thickness and falloff of the material reduce the damage.
+ * The hits are collected into a buffer which is kept over all shots, so resolving does not allocate once it has grown.
+ * Only used on the game thread
+ */
+class FPTEST_API FFPTestPenetrationResolver
+{
+public:
+	FFPTestPenetrationResolver();
+
+	/** Collects the hits of the shot, FirstWorldHit is the blocking hit of the trace from the start to the end, if there is one */
+	void Resolve(const UWorld& World, const FFPTestPenetrationShot& Shot, const FHitResult* FirstWorldHit);
+
+	/** Hits of the last resolved shot, in the order the shot reached them */
+	TConstArrayView<FFPTestPenetrationHit> GetHits() const { return Hits; }
+
+private:
+	/** Exit of the shot out of the hit component, false if it is thicker than MaxThickness */
+	bool FindExit(const FHitResult& Hit, const FVector& Direction, float MaxThickness, FVector& OutExit) const;
+
+	TArray<FFPTestPenetrationHit> Hits;
+};
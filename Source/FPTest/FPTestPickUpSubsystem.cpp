@@ -0,0 +1,298 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestPickUpSubsystem.h"
+#include "FPTestCharacter.h"
+#include "FPTestCounters.h"
+#include "FPTestStats.h"
+#include "TP_PickUpComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+int32 GFPTestPickUpSpatialHash = 0;
+static FAutoConsoleVariableRef CVarFPTestPickUpSpatialHash(
+	TEXT("FPTest.PickUps.SpatialHash"),
+	GFPTestPickUpSpatialHash,
+	TEXT("0: Pickups use physics overlap events.\n")
+	TEXT("1: Pickups are found by the pickup subsystem in a spatial hash. Only affects pickups which begin play afterwards."));
+
+static float GFPTestPickUpCellSize = 1000.0f;
+static FAutoConsoleVariableRef CVarFPTestPickUpCellSize(
+	TEXT("FPTest.PickUps.CellSize"),
+	GFPTestPickUpCellSize,
+	TEXT("Size of a cell of the pickup spatial hash. Only used when the first pickup gets registered."));
+
+void UFPTestPickUpSubsystem::RegisterPickUp(UTP_PickUpComponent* PickUp)
+{
+	if (!PickUp)
+	{
+		return;
+	}
+
+	if (EntryIndices.Num() == 0)
+	{
+		CellSize = FMath::Max(GFPTestPickUpCellSize, 1.0f);
+	}
+
+	const FVector Location = PickUp->GetComponentLocation();
+	const FIntPoint Cell = GetCell(Location);
+
+	int32 EntryIndex = INDEX_NONE;
+	if (const int32* ExistingIndex = EntryIndices.Find(PickUp))
+	{
+		// Pooled pickups come back somewhere else
+		EntryIndex = *ExistingIndex;
+		if (Entries[EntryIndex].Cell != Cell)
+		{
+			Cells.FindChecked(Entries[EntryIndex].Cell).RemoveSingleSwap(EntryIndex, false);
+			Cells.FindOrAdd(Cell).Add(EntryIndex);
+		}
+	}
+	else
+	{
+		EntryIndex = FreeEntries.Num() > 0 ? FreeEntries.Pop(false) : Entries.AddDefaulted();
+		EntryIndices.Add(PickUp, EntryIndex);
+		Cells.FindOrAdd(Cell).Add(EntryIndex);
+	}
+
+	FFPTestPickUpEntry& Entry = Entries[EntryIndex];
+	Entry.PickUp = PickUp;
+	Entry.Location = Location;
+	Entry.Radius = PickUp->GetScaledSphereRadius();
+	Entry.Cell = Cell;
+
+	MaxRadius = FMath::Max(MaxRadius, Entry.Radius);
+}
+
+void UFPTestPickUpSubsystem::UnregisterPickUp(UTP_PickUpComponent* PickUp)
+{
+	int32 EntryIndex = INDEX_NONE;
+	if (!EntryIndices.RemoveAndCopyValue(PickUp, EntryIndex))
+	{
+		return;
+	}
+
+	FFPTestPickUpEntry& Entry = Entries[EntryIndex];
+	if (TArray<int32>* CellEntries = Cells.Find(Entry.Cell))
+	{
+		CellEntries->RemoveSingleSwap(EntryIndex, false);
+	}
+	Entry.PickUp.Reset();
+	FreeEntries.Add(EntryIndex);
+}
+
+void UFPTestPickUpSubsystem::UpdatePickUps()
+{
+	UWorld* const World = GetWorld();
+	if (!World || EntryIndices.Num() == 0)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(PickUpUpdate);
+
+	// Broadcasting unregisters the pickup, so the hits are collected first
+	TArray<TPair<UTP_PickUpComponent*, AFPTestCharacter*>, TInlineAllocator<8>> PickedUp;
+
+	for (TActorIterator<AFPTestCharacter> It(World); It; ++It)
+	{
+		AFPTestCharacter* Character = *It;
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		if (!Capsule || !Capsule->IsCollisionEnabled())
+		{
+			continue;
+		}
+
+		// The capsule is a segment with a radius, a pickup touches it if its center is close enough to the segment
+		const FVector Location = Capsule->GetComponentLocation();
+		const float CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+		const float SegmentHalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+		const FVector SegmentStart = Location - FVector(0.0f, 0.0f, SegmentHalfHeight);
+		const FVector SegmentEnd = Location + FVector(0.0f, 0.0f, SegmentHalfHeight);
+
+		const float Reach = CapsuleRadius + MaxRadius;
+		const FIntPoint MinCell = GetCell(Location - FVector(Reach, Reach, 0.0f));
+		const FIntPoint MaxCell = GetCell(Location + FVector(Reach, Reach, 0.0f));
+
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+		{
+			for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+			{
+				const TArray<int32>* CellEntries = Cells.Find(FIntPoint(CellX, CellY));
+				if (!CellEntries)
+				{
+					continue;
+				}
+
+				for (const int32 EntryIndex : *CellEntries)
+				{
+					const FFPTestPickUpEntry& Entry = Entries[EntryIndex];
+					const float TouchDistance = CapsuleRadius + Entry.Radius;
+					if (FMath::PointDistToSegmentSquared(Entry.Location, SegmentStart, SegmentEnd) > FMath::Square(TouchDistance))
+					{
+						continue;
+					}
+
+					// Pooled weapons keep their pickup registered while their collision is off
+					UTP_PickUpComponent* PickUp = Entry.PickUp.Get();
+					if (PickUp && PickUp->IsCollisionEnabled())
+					{
+						PickedUp.Emplace(PickUp, Character);
+					}
+				}
+			}
+		}
+	}
+
+	for (const TPair<UTP_PickUpComponent*, AFPTestCharacter*>& Pair : PickedUp)
+	{
+		// Two characters can reach the same pickup in one tick, the first one gets it like with the overlaps
+		if (EntryIndices.Contains(Pair.Key))
+		{
+			Pair.Key->NotifyPickUp(Pair.Value);
+		}
+	}
+}
+
+FIntPoint UFPTestPickUpSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+void UFPTestPickUpSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdatePickUps();
+}
+
+TStatId UFPTestPickUpSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestPickUpSubsystem, STATGROUP_Tickables);
+}
+
+bool UFPTestPickUpSubsystem::IsTickable() const
+{
+	return EntryIndices.Num() > 0;
+}
+
+bool UFPTestPickUpSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+namespace FPTestPickUps
+{
+	/** Moves characters through a field of pickups and measures the moves and the pickup checks */
+	static void RunBenchmark(UWorld& World, bool bSpatialHash, int32 NumPickUps, int32 NumCharacters, int32 NumFrames)
+	{
+		const int32 OldSpatialHash = GFPTestPickUpSpatialHash;
+		const int64 OldPickUps = FFPTestCounters::Get(EFPTestCounter::PickUps);
+		GFPTestPickUpSpatialHash = bSpatialHash ? 1 : 0;
+
+		// High above the level, so nothing else gets in the way
+		const FVector Origin(0.0f, 0.0f, 100000.0f);
+		const float AreaSize = 20000.0f;
+		FRandomStream Random(1234);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		TArray<AActor*> PickUpActors;
+		TArray<UTP_PickUpComponent*> PickUps;
+		for (int32 Index = 0; Index < NumPickUps; Index++)
+		{
+			const FVector Location = Origin + FVector(Random.FRandRange(0.0f, AreaSize), Random.FRandRange(0.0f, AreaSize), 0.0f);
+			AActor* Actor = World.SpawnActor<AActor>(AActor::StaticClass(), FTransform(Location), SpawnParams);
+			if (!Actor)
+			{
+				continue;
+			}
+
+			// Begins play when registered, so it picks up the mode from the cvar
+			UTP_PickUpComponent* PickUp = NewObject<UTP_PickUpComponent>(Actor);
+			PickUp->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+			Actor->SetRootComponent(PickUp);
+			PickUp->SetWorldLocation(Location);
+			PickUp->RegisterComponent();
+
+			PickUpActors.Add(Actor);
+			PickUps.Add(PickUp);
+		}
+
+		TArray<AFPTestCharacter*> Characters;
+		TArray<FVector> Centers;
+		for (int32 Index = 0; Index < NumCharacters; Index++)
+		{
+			const FVector Center = Origin + FVector(Random.FRandRange(0.0f, AreaSize), Random.FRandRange(0.0f, AreaSize), 0.0f);
+			if (AFPTestCharacter* Character = World.SpawnActor<AFPTestCharacter>(AFPTestCharacter::StaticClass(), Center, FRotator::ZeroRotator, SpawnParams))
+			{
+				Characters.Add(Character);
+				Centers.Add(Center);
+			}
+		}
+
+		UFPTestPickUpSubsystem* PickUpSubsystem = World.GetSubsystem<UFPTestPickUpSubsystem>();
+
+		double TotalMs = 0.0;
+		double MaxMs = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			// Every character runs on its own circle, about 600 units per second at 60 fps
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Characters.Num(); Index++)
+			{
+				const float Angle = Frame * 0.02f + Index;
+				Characters[Index]->SetActorLocation(Centers[Index] + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * 500.0f);
+			}
+			if (bSpatialHash && PickUpSubsystem)
+			{
+				PickUpSubsystem->UpdatePickUps();
+			}
+			const double FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			TotalMs += FrameMs;
+			MaxMs = FMath::Max(MaxMs, FrameMs);
+
+			// Picked up pickups come back right away, so both modes always have all of them
+			for (UTP_PickUpComponent* PickUp : PickUps)
+			{
+				PickUp->ResetPickUp();
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("PickUp benchmark: %-12s %d pickups, %d characters, avg %.3f ms, max %.3f ms over %d frames, %lld pick ups"),
+			bSpatialHash ? TEXT("spatial hash") : TEXT("overlaps"), PickUps.Num(), Characters.Num(), TotalMs / FMath::Max(NumFrames, 1), MaxMs, NumFrames,
+			FFPTestCounters::Get(EFPTestCounter::PickUps) - OldPickUps);
+
+		for (AFPTestCharacter* Character : Characters)
+		{
+			Character->Destroy();
+		}
+		for (AActor* Actor : PickUpActors)
+		{
+			Actor->Destroy();
+		}
+
+		GFPTestPickUpSpatialHash = OldSpatialHash;
+		FFPTestCounters::Set(EFPTestCounter::PickUps, OldPickUps);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFPTestPickUpsBenchmark(
+	TEXT("FPTest.PickUps.Benchmark"),
+	TEXT("Compares overlap and spatial hash pickups with moving characters. Arguments: [PickUps=500] [Characters=64] [Frames=300]."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || !World->IsGameWorld())
+		{
+			return;
+		}
+
+		const int32 NumPickUps = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500;
+		const int32 NumCharacters = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 64;
+		const int32 NumFrames = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 300;
+
+		FPTestPickUps::RunBenchmark(*World, false, NumPickUps, NumCharacters, NumFrames);
+		FPTestPickUps::RunBenchmark(*World, true, NumPickUps, NumCharacters, NumFrames);
+	}));
@@ -0,0 +1,74 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestPickUpSubsystem.generated.h"
+
+class UTP_PickUpComponent;
+
+/** Value of FPTest.PickUps.SpatialHash, read when a pickup begins play */
+extern FPTEST_API int32 GFPTestPickUpSpatialHash;
+
+/** A pickup in the spatial hash */
+struct FFPTestPickUpEntry
+{
+	TWeakObjectPtr<UTP_PickUpComponent> PickUp;
+	FVector Location = FVector::ZeroVector;
+	float Radius = 0.0f;
+	FIntPoint Cell = FIntPoint::ZeroValue;
+};
+
+/**
+ * Pickups without physics overlaps
+ * With FPTest.PickUps.SpatialHash 1 the pickups do not generate overlap events, so moving characters do not update overlaps against them.
+ * Instead they are registered here in a uniform 2D grid and the characters are checked against the cells around them once per tick.
+ * The pickup still broadcasts OnPickUp as before.
+ */
+UCLASS()
+class FPTEST_API UFPTestPickUpSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Adds the pickup at its current location, or moves it there if it is already registered */
+	void RegisterPickUp(UTP_PickUpComponent* PickUp);
+
+	/** Removes the pickup, nothing happens if it is not registered */
+	void UnregisterPickUp(UTP_PickUpComponent* PickUp);
+
+	/** Checks all characters against the pickups around them */
+	void UpdatePickUps();
+
+	/** Amount of registered pickups */
+	int32 GetNumPickUps() const { return Entries.Num() - FreeEntries.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	// End of FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/** Pickups indexed by entry, freed entries are reused */
+	TArray<FFPTestPickUpEntry> Entries;
+	TArray<int32> FreeEntries;
+
+	/** Entry of every registered pickup */
+	TMap<TObjectKey<UTP_PickUpComponent>, int32> EntryIndices;
+
+	/** Entries in each cell */
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	/** Size of a cell, taken from FPTest.PickUps.CellSize when the first pickup gets registered */
+	float CellSize = 1000.0f;
+
+	/** Largest radius of all registered pickups, the cells around a character are chosen with it */
+	float MaxRadius = 0.0f;
+};
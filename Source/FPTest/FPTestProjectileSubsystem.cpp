@@ -0,0 +1,359 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestProjectileSubsystem.h"
+#include "FPTestCharacter.h"
+#include "FPTestFireModes.h"
+#include "FPTestStats.h"
+#include "FPTestTelemetry.h"
+#include "TP_WeaponComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static int32 GFPTestProjectilesEnable = 1;
+static FAutoConsoleVariableRef CVarFPTestProjectilesEnable(
+	TEXT("FPTest.Projectiles.Enable"),
+	GFPTestProjectilesEnable,
+	TEXT("1: Fire modes with a projectile speed fire ballistic projectiles.\n")
+	TEXT("0: All fire modes trace instantly."));
+
+static int32 GFPTestProjectilesMax = 65536;
+static FAutoConsoleVariableRef CVarFPTestProjectilesMax(
+	TEXT("FPTest.Projectiles.Max"),
+	GFPTestProjectilesMax,
+	TEXT("Projectiles in flight at most, shots above that trace instantly."));
+
+static float GFPTestProjectilesMaxLifetime = 5.0f;
+static FAutoConsoleVariableRef CVarFPTestProjectilesMaxLifetime(
+	TEXT("FPTest.Projectiles.MaxLifetime"),
+	GFPTestProjectilesMaxLifetime,
+	TEXT("Seconds a projectile flies before it is removed without hitting anything."));
+
+static int32 GFPTestProjectilesChunkSize = 2048;
+static FAutoConsoleVariableRef CVarFPTestProjectilesChunkSize(
+	TEXT("FPTest.Projectiles.ChunkSize"),
+	GFPTestProjectilesChunkSize,
+	TEXT("Projectiles stepped by one worker task, fewer projectiles than this are stepped on the game thread."));
+
+//////////////////////////////////////////////////////////////////////////
+// FFPTestProjectileBuffers
+
+void FFPTestProjectileBuffers::Add(const FVector& Location, const FVector& Velocity, float InGravityZ, float InDrag)
+{
+	PositionX.Add(Location.X);
+	PositionY.Add(Location.Y);
+	PositionZ.Add(Location.Z);
+	VelocityX.Add(Velocity.X);
+	VelocityY.Add(Velocity.Y);
+	VelocityZ.Add(Velocity.Z);
+	PreviousX.Add(Location.X);
+	PreviousY.Add(Location.Y);
+	PreviousZ.Add(Location.Z);
+	GravityZ.Add(InGravityZ);
+	Drag.Add(InDrag);
+	Age.Add(0.0f);
+}
+
+void FFPTestProjectileBuffers::RemoveAtSwap(int32 Index)
+{
+	PositionX.RemoveAtSwap(Index, 1, false);
+	PositionY.RemoveAtSwap(Index, 1, false);
+	PositionZ.RemoveAtSwap(Index, 1, false);
+	VelocityX.RemoveAtSwap(Index, 1, false);
+	VelocityY.RemoveAtSwap(Index, 1, false);
+	VelocityZ.RemoveAtSwap(Index, 1, false);
+	PreviousX.RemoveAtSwap(Index, 1, false);
+	PreviousY.RemoveAtSwap(Index, 1, false);
+	PreviousZ.RemoveAtSwap(Index, 1, false);
+	GravityZ.RemoveAtSwap(Index, 1, false);
+	Drag.RemoveAtSwap(Index, 1, false);
+	Age.RemoveAtSwap(Index, 1, false);
+}
+
+void FFPTestProjectileBuffers::Reset()
+{
+	for (TArray<float>* Array : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &PreviousX, &PreviousY, &PreviousZ, &GravityZ, &Drag, &Age })
+	{
+		Array->Reset();
+	}
+}
+
+void FFPTestProjectileBuffers::Reserve(int32 Number)
+{
+	for (TArray<float>* Array : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &PreviousX, &PreviousY, &PreviousZ, &GravityZ, &Drag, &Age })
+	{
+		Array->Reserve(Number);
+	}
+}
+
+void FFPTestProjectileBuffers::Step(float DeltaTime)
+{
+	const int32 NumProjectiles = Num();
+
+	// A multiple of 4, so only the last chunk has a scalar tail
+	const int32 ChunkSize = FMath::Max(Align(GFPTestProjectilesChunkSize, 4), 4);
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumProjectiles, ChunkSize);
+
+	ParallelFor(NumChunks, [this, ChunkSize, NumProjectiles, DeltaTime](int32 Chunk)
+	{
+		const int32 Start = Chunk * ChunkSize;
+		StepRange(Start, FMath::Min(Start + ChunkSize, NumProjectiles), DeltaTime);
+	}, NumChunks <= 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void FFPTestProjectileBuffers::StepRange(int32 Start, int32 End, float DeltaTime)
+{
+	// Explicit euler: drag and gravity change the velocity, then the velocity moves the position
+	const VectorRegister4Float Delta = VectorSetFloat1(DeltaTime);
+	const VectorRegister4Float One = VectorOne();
+	const VectorRegister4Float Zero = VectorZero();
+
+	int32 Index = Start;
+	for (; Index + 4 <= End; Index += 4)
+	{
+		const VectorRegister4Float DragFactor = VectorMax(VectorSubtract(One, VectorMultiply(VectorLoad(&Drag[Index]), Delta)), Zero);
+
+		const VectorRegister4Float VelX = VectorMultiply(VectorLoad(&VelocityX[Index]), DragFactor);
+		const VectorRegister4Float VelY = VectorMultiply(VectorLoad(&VelocityY[Index]), DragFactor);
+		const VectorRegister4Float VelZ = VectorMultiplyAdd(VectorLoad(&GravityZ[Index]), Delta, VectorMultiply(VectorLoad(&VelocityZ[Index]), DragFactor));
+
+		const VectorRegister4Float PosX = VectorLoad(&PositionX[Index]);
+		const VectorRegister4Float PosY = VectorLoad(&PositionY[Index]);
+		const VectorRegister4Float PosZ = VectorLoad(&PositionZ[Index]);
+
+		VectorStore(PosX, &PreviousX[Index]);
+		VectorStore(PosY, &PreviousY[Index]);
+		VectorStore(PosZ, &PreviousZ[Index]);
+		VectorStore(VectorMultiplyAdd(VelX, Delta, PosX), &PositionX[Index]);
+		VectorStore(VectorMultiplyAdd(VelY, Delta, PosY), &PositionY[Index]);
+		VectorStore(VectorMultiplyAdd(VelZ, Delta, PosZ), &PositionZ[Index]);
+		VectorStore(VelX, &VelocityX[Index]);
+		VectorStore(VelY, &VelocityY[Index]);
+		VectorStore(VelZ, &VelocityZ[Index]);
+		VectorStore(VectorAdd(VectorLoad(&Age[Index]), Delta), &Age[Index]);
+	}
+
+	for (; Index < End; Index++)
+	{
+		const float DragFactor = FMath::Max(1.0f - Drag[Index] * DeltaTime, 0.0f);
+		VelocityX[Index] *= DragFactor;
+		VelocityY[Index] *= DragFactor;
+		VelocityZ[Index] = VelocityZ[Index] * DragFactor + GravityZ[Index] * DeltaTime;
+
+		PreviousX[Index] = PositionX[Index];
+		PreviousY[Index] = PositionY[Index];
+		PreviousZ[Index] = PositionZ[Index];
+		PositionX[Index] += VelocityX[Index] * DeltaTime;
+		PositionY[Index] += VelocityY[Index] * DeltaTime;
+		PositionZ[Index] += VelocityZ[Index] * DeltaTime;
+		Age[Index] += DeltaTime;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UFPTestProjectileSubsystem
+
+bool UFPTestProjectileSubsystem::AreProjectilesEnabled()
+{
+	return GFPTestProjectilesEnable != 0;
+}
+
+bool UFPTestProjectileSubsystem::SpawnProjectile(UTP_WeaponComponent* Weapon, const FFPTestFireMode& FireMode, const FVector& Location, const FVector& Direction, double ShotTime, uint16 Sequence)
+{
+	const UWorld* World = GetWorld();
+	if (!World || Buffers.Num() >= GFPTestProjectilesMax)
+	{
+		return false;
+	}
+
+	Buffers.Add(Location, Direction * FireMode.ProjectileSpeed, World->GetGravityZ() * FireMode.ProjectileGravityScale, FireMode.ProjectileDrag);
+
+	FFPTestProjectileInfo& Info = Infos.AddDefaulted_GetRef();
+	Info.Weapon = Weapon;
+	Info.Shooter = Weapon ? Weapon->Character : nullptr;
+	Info.ImpactModifier = FireMode.ImpactModifier;
+	Info.Damage = FireMode.Damage;
+	Info.ShootType = FireMode.ShootType;
+	Info.ShotTime = ShotTime;
+	Info.Sequence = Sequence;
+	return true;
+}
+
+void UFPTestProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWorld* const World = GetWorld();
+	if (World && Buffers.Num() > 0)
+	{
+		{
+			FPTEST_SCOPE(ProjectileSweeps);
+			ResolveSweeps(*World);
+		}
+
+		{
+			FPTEST_SCOPE(ProjectileStep);
+			Buffers.Step(DeltaTime);
+		}
+
+		{
+			FPTEST_SCOPE(ProjectileSweeps);
+			SubmitSweeps(*World);
+		}
+	}
+
+	FPTEST_SET_VALUE(ActiveProjectiles, Buffers.Num());
+}
+
+void UFPTestProjectileSubsystem::ResolveSweeps(UWorld& World)
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FPTestProjectileSweep));
+	RemovedIndices.Reset();
+
+	FTraceDatum TraceData;
+	FHitResult SyncHit;
+	for (int32 Index = 0; Index < Buffers.Num(); Index++)
+	{
+		const FFPTestProjectileInfo& Info = Infos[Index];
+
+		const FHitResult* Hit = nullptr;
+		if (World.QueryTraceData(Info.TraceHandle, TraceData))
+		{
+			Hit = TraceData.OutHits.FindByPredicate([](const FHitResult& TraceHit) { return TraceHit.bBlockingHit; });
+		}
+		else if (World.IsTraceHandleValid(Info.TraceHandle, false))
+		{
+			// The sweep is not done yet, the projectile must not step past it, so it gets traced right here
+			SetSweepShooter(QueryParams, Info);
+			if (World.LineTraceSingleByChannel(SyncHit, Buffers.GetPreviousPosition(Index), Buffers.GetPosition(Index), COLLISION_SHOTTRACE, QueryParams))
+			{
+				Hit = &SyncHit;
+			}
+			FPTEST_COUNT(Traces, 1);
+		}
+		// Projectiles spawned this frame did not move yet and have no sweep
+
+		// Only a projectile which hit something resolved its shot, one which expired just ends
+		if (Hit)
+		{
+			ApplyHit(World, Info, *Hit);
+			RemovedIndices.Add(Index);
+			FPTEST_COUNT(ShotsResolved, 1);
+		}
+		else if (Buffers.Age[Index] >= GFPTestProjectilesMaxLifetime)
+		{
+			RemovedIndices.Add(Index);
+		}
+	}
+
+	// From the back, so the projectile swapped into a removed index is never one which gets removed as well
+	for (int32 Removed = RemovedIndices.Num() - 1; Removed >= 0; Removed--)
+	{
+		Buffers.RemoveAtSwap(RemovedIndices[Removed]);
+		Infos.RemoveAtSwap(RemovedIndices[Removed], 1, false);
+	}
+}
+
+void UFPTestProjectileSubsystem::SubmitSweeps(UWorld& World)
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FPTestProjectileSweep));
+	for (int32 Index = 0; Index < Buffers.Num(); Index++)
+	{
+		SetSweepShooter(QueryParams, Infos[Index]);
+		Infos[Index].TraceHandle = World.AsyncLineTraceByChannel(EAsyncTraceType::Single, Buffers.GetPreviousPosition(Index), Buffers.GetPosition(Index), COLLISION_SHOTTRACE, QueryParams);
+	}
+	FPTEST_COUNT(Traces, Buffers.Num());
+}
+
+void UFPTestProjectileSubsystem::SetSweepShooter(FCollisionQueryParams& QueryParams, const FFPTestProjectileInfo& Info)
+{
+	// Ignored by the sweep itself, so whatever is behind the shooter in the same step still gets hit
+	QueryParams.ClearIgnoredActors();
+	if (const AActor* Shooter = Info.Shooter.Get())
+	{
+		QueryParams.AddIgnoredActor(Shooter);
+	}
+}
+
+void UFPTestProjectileSubsystem::ApplyHit(UWorld& World, const FFPTestProjectileInfo& Info, const FHitResult& Hit) const
+{
+	UTP_WeaponComponent* Weapon = Info.Weapon.Get();
+	if (!Weapon)
+	{
+		return;
+	}
+
+	const AActor* HitActor = Hit.GetActor();
+
+	if (FFPTestTelemetry::IsRecording())
+	{
+		FFPTestTelemetryRecord Record;
+		Record.Type = EFPTestTelemetryType::Hit;
+		Record.Time = World.GetTimeSeconds();
+		Record.ShooterId = Weapon->Character ? Weapon->Character->GetUniqueID() : 0;
+		Record.TargetId = HitActor ? HitActor->GetUniqueID() : 0;
+		Record.Location = FVector3f(Hit.Location);
+		Record.SetDirection(Hit.TraceEnd - Hit.TraceStart);
+		Record.Damage = HitActor && HitActor->IsA<AFPTestCharacter>() ? static_cast<uint16>(FMath::Clamp(Info.Damage, 0, MAX_uint16)) : 0;
+		Record.LatencyMs = static_cast<uint16>(FMath::Clamp((Record.Time - Info.ShotTime) * 1000.0, 0.0, static_cast<double>(MAX_uint16)));
+		Record.Sequence = Info.Sequence;
+		Record.ShootType = static_cast<uint8>(Info.ShootType);
+		FFPTestTelemetry::Record(Record);
+	}
+
+	Weapon->ApplyShotHit(Hit, Info.ImpactModifier, Info.Damage, Info.ShootType);
+}
+
+TStatId UFPTestProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UFPTestProjectileSubsystem::Deinitialize()
+{
+	Buffers.Reset();
+	Infos.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UFPTestProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Benchmark
+
+static void FPTestProjectilesBenchmark(const TArray<FString>& Args)
+{
+	const int32 NumSteps = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+	const float DeltaTime = 1.0f / 60.0f;
+
+	for (const int32 NumProjectiles : { 1000, 10000, 50000 })
+	{
+		FRandomStream Random(1234);
+		FFPTestProjectileBuffers Buffers;
+		Buffers.Reserve(NumProjectiles);
+		for (int32 Index = 0; Index < NumProjectiles; Index++)
+		{
+			const FVector Location(Random.FRandRange(-5000.0f, 5000.0f), Random.FRandRange(-5000.0f, 5000.0f), 100.0f);
+			Buffers.Add(Location, Random.GetUnitVector() * 15000.0f, -980.0f, 0.1f);
+		}
+
+		const double StartSeconds = FPlatformTime::Seconds();
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			Buffers.Step(DeltaTime);
+		}
+		const double ElapsedSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+		UE_LOG(LogTemp, Display, TEXT("Projectiles Benchmark: %d projectiles, %d steps, %.3f ms per step, %.2f ns per projectile"),
+			NumProjectiles, NumSteps, ElapsedSeconds * 1000.0 / FMath::Max(NumSteps, 1), ElapsedSeconds * 1.0e9 / FMath::Max(NumSteps * NumProjectiles, 1));
+	}
+}
+
+static FAutoConsoleCommand CmdFPTestProjectilesBenchmark(
+	TEXT("FPTest.Projectiles.Benchmark"),
+	TEXT("Measures the step cost at 1k, 10k and 50k projectiles, without the sweeps. Optional argument: number of steps."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPTestProjectilesBenchmark));
@@ -0,0 +1,134 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "FPTestWeaponTypes.h"
+#include "FPTestProjectileSubsystem.generated.h"
+
+class UTP_WeaponComponent;
+struct FFPTestFireMode;
+
+/**
+ * Positions and velocities of all projectiles in flight, one array per component
+ * Stepping only touches these, four projectiles at a time with SIMD. Every array has the same length,
+ * a projectile is the same index in all of them and in the info of the subsystem.
+ * Positions are floats, enough precision for the maps of the project
+ */
+struct FPTEST_API FFPTestProjectileBuffers
+{
+	TArray<float> PositionX, PositionY, PositionZ;
+	TArray<float> VelocityX, VelocityY, VelocityZ;
+
+	/** Where the last step started, the sweep goes from there to the position */
+	TArray<float> PreviousX, PreviousY, PreviousZ;
+
+	/** Gravity including the scale of the fire mode */
+	TArray<float> GravityZ;
+
+	/** Part of the speed lost per second */
+	TArray<float> Drag;
+
+	/** Seconds in flight */
+	TArray<float> Age;
+
+	int32 Num() const { return PositionX.Num(); }
+
+	void Add(const FVector& Location, const FVector& Velocity, float InGravityZ, float InDrag);
+
+	/** Moves the last projectile into the index, like RemoveAtSwap of all arrays */
+	void RemoveAtSwap(int32 Index);
+
+	void Reset();
+
+	/** Grows all arrays for that many projectiles */
+	void Reserve(int32 Number);
+
+	/** Moves all projectiles, in parallel chunks once there are enough of them */
+	void Step(float DeltaTime);
+
+	/** Moves the projectiles in [Start, End) */
+	void StepRange(int32 Start, int32 End, float DeltaTime);
+
+	FVector GetPosition(int32 Index) const { return FVector(PositionX[Index], PositionY[Index], PositionZ[Index]); }
+	FVector GetPreviousPosition(int32 Index) const { return FVector(PreviousX[Index], PreviousY[Index], PreviousZ[Index]); }
+};
+
+/** What a projectile does once it hits, not needed while stepping */
+struct FFPTestProjectileInfo
+{
+	/** Weapon which fired the projectile, it applies the hit */
+	TWeakObjectPtr<UTP_WeaponComponent> Weapon;
+
+	/** Character which fired the projectile, its sweeps go through it */
+	TWeakObjectPtr<AActor> Shooter;
+
+	float ImpactModifier = 1.0f;
+	int32 Damage = 0;
+
+	/** Fire mode the projectile was fired with, the weapon can be in another one once it lands */
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+
+	/** Server time the client fired at, for the telemetry */
+	double ShotTime = 0.0;
+	uint16 Sequence = 0;
+
+	/** Sweep of the last step, submitted at the end of the frame and checked before the next step */
+	FTraceHandle TraceHandle;
+};
+
+/**
+ * Server side ballistic projectiles of fire modes with a projectile speed
+ * There is no actor per bullet. Every frame first applies the sweeps of the last step, removes what hit or expired,
+ * steps the rest on worker threads and submits the new sweeps as one batch of async line traces.
+ * Characters are hit where they are now, a projectile in flight is not lag compensated.
+ */
+UCLASS()
+class FPTEST_API UFPTestProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Starts a projectile, false if there are too many in flight */
+	bool SpawnProjectile(UTP_WeaponComponent* Weapon, const FFPTestFireMode& FireMode, const FVector& Location, const FVector& Direction, double ShotTime, uint16 Sequence);
+
+	/** If fire modes with a projectile speed fire projectiles, otherwise they trace like all others */
+	static bool AreProjectilesEnabled();
+
+	int32 GetNumProjectiles() const { return Buffers.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Applies the sweeps of the last step and removes the projectiles which hit something or expired */
+	void ResolveSweeps(UWorld& World);
+
+	/** Submits the sweep of every projectile from its previous to its current position */
+	void SubmitSweeps(UWorld& World);
+
+	/** Makes the sweep of the projectile ignore its shooter */
+	static void SetSweepShooter(FCollisionQueryParams& QueryParams, const FFPTestProjectileInfo& Info);
+
+	/** Applies the hit to the weapon of the projectile */
+	void ApplyHit(UWorld& World, const FFPTestProjectileInfo& Info, const FHitResult& Hit) const;
+
+	FFPTestProjectileBuffers Buffers;
+
+	/** Same index as in the buffers */
+	TArray<FFPTestProjectileInfo> Infos;
+
+	/** Projectiles to remove this frame, kept for the allocation */
+	TArray<int32> RemovedIndices;
+};
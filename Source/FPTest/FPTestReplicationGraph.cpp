@@ -0,0 +1,380 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestReplicationGraph.h"
+#include "FPTestCharacter.h"
+#include "TP_WeaponComponent.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+
+static int32 GFPTestRepGraphEnable = 1;
+static FAutoConsoleVariableRef CVarFPTestRepGraphEnable(
+	TEXT("FPTest.RepGraph.Enable"),
+	GFPTestRepGraphEnable,
+	TEXT("1: The game net driver uses the FPTest replication graph. 0: Default per actor relevancy. Only read when the net driver gets created."));
+
+namespace FPTestReplicationGraph
+{
+	/** Creates the graph for the game net driver of a game world */
+	static UReplicationDriver* CreateReplicationDriver(UNetDriver* ForNetDriver, const FURL& URL, UWorld* World)
+	{
+		if (GFPTestRepGraphEnable == 0 || FParse::Param(FCommandLine::Get(), TEXT("NoFPTestRepGraph")))
+		{
+			return nullptr;
+		}
+
+		if (!ForNetDriver || ForNetDriver->NetDriverName != NAME_GameNetDriver || !World || !World->IsGameWorld())
+		{
+			return nullptr;
+		}
+
+		return NewObject<UFPTestReplicationGraph>(GetTransientPackage());
+	}
+
+	/** Replicates with the given number of simulated connections and logs the average and max ms of the replication */
+	static void Benchmark(UWorld& World, UNetDriver& NetDriver, int32 NumConnections, int32 NumFrames)
+	{
+		// The simulated connections look through the pawns, so they are spread over the map like players
+		TArray<APawn*> Pawns;
+		for (TActorIterator<APawn> It(&World); It; ++It)
+		{
+			Pawns.Add(*It);
+		}
+
+		TArray<USimulatedClientNetConnection*> Connections;
+		Connections.Reserve(NumConnections);
+		for (int32 Index = 0; Index < NumConnections; Index++)
+		{
+			USimulatedClientNetConnection* Connection = NewObject<USimulatedClientNetConnection>();
+			Connection->InitConnection(&NetDriver, USOCK_Open, World.URL, 1000000);
+			Connection->InitSendBuffer();
+			if (Pawns.Num() > 0)
+			{
+				APawn* Pawn = Pawns[Index % Pawns.Num()];
+				Connection->OwningActor = Pawn;
+				Connection->ViewTarget = Pawn;
+			}
+			NetDriver.AddClientConnection(Connection);
+			Connections.Add(Connection);
+		}
+
+		const float DeltaSeconds = 1.0f / FMath::Max(NetDriver.GetNetServerMaxTickRate(), 1);
+
+		// The first frames open the channels and send everything, they are not what we want to measure
+		for (int32 Frame = 0; Frame < 10; Frame++)
+		{
+			NetDriver.ServerReplicateActors(DeltaSeconds);
+		}
+
+		double TotalMs = 0.0;
+		double MaxMs = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			NetDriver.ServerReplicateActors(DeltaSeconds);
+			const double FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			TotalMs += FrameMs;
+			MaxMs = FMath::Max(MaxMs, FrameMs);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("RepGraph benchmark: %d connections (%d total), %d pawns, avg %.3f ms, max %.3f ms over %d frames"),
+			NumConnections, NetDriver.ClientConnections.Num(), Pawns.Num(), TotalMs / FMath::Max(NumFrames, 1), MaxMs, NumFrames);
+
+		for (USimulatedClientNetConnection* Connection : Connections)
+		{
+			Connection->CleanUp();
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("FPTest.RepGraph.Benchmark"),
+		TEXT("Measures the server replication with simulated connections. Arguments are the connection counts, 32 64 128 if none are given. Start the server with -NoFPTestRepGraph to measure the default relevancy."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+			if (!NetDriver || !NetDriver->IsServer())
+			{
+				UE_LOG(LogTemp, Warning, TEXT("RepGraph benchmark: needs a listen or dedicated server"));
+				return;
+			}
+
+			TArray<int32> ConnectionCounts;
+			for (const FString& Arg : Args)
+			{
+				ConnectionCounts.Add(FMath::Max(FCString::Atoi(*Arg), 1));
+			}
+			if (ConnectionCounts.Num() == 0)
+			{
+				ConnectionCounts = { 32, 64, 128 };
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("RepGraph benchmark: %s"), Cast<UFPTestReplicationGraph>(NetDriver->GetReplicationDriver()) ? TEXT("replication graph") : TEXT("default relevancy"));
+			for (const int32 NumConnections : ConnectionCounts)
+			{
+				Benchmark(*World, *NetDriver, NumConnections, 120);
+			}
+		}));
+
+	static FDelayedAutoRegisterHelper RegisterReplicationDriver(EDelayedRegisterRunPhase::EndOfEngineInit, []()
+	{
+		UReplicationDriver::CreateReplicationDriverDelegate().BindStatic(&CreateReplicationDriver);
+	});
+}
+
+UFPTestReplicationGraph::UFPTestReplicationGraph()
+{
+	ReplicationConnectionManagerClass = UNetReplicationGraphConnection::StaticClass();
+}
+
+void UFPTestReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	AttachedWeapons.Reset();
+}
+
+void UFPTestReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Everything not listed gets the policy of its closest listed super class
+	ClassPolicies.Set(AActor::StaticClass(), EFPTestClassRepPolicy::Spatialize_Dynamic);
+	ClassPolicies.Set(AInfo::StaticClass(), EFPTestClassRepPolicy::RelevantAllConnections);
+	ClassPolicies.Set(ALevelScriptActor::StaticClass(), EFPTestClassRepPolicy::NotRouted);
+	ClassPolicies.Set(AReplicationGraphDebugActor::StaticClass(), EFPTestClassRepPolicy::NotRouted);
+	ClassPolicies.Set(APlayerController::StaticClass(), EFPTestClassRepPolicy::NotRouted);
+	ClassPolicies.Set(AGameStateBase::StaticClass(), EFPTestClassRepPolicy::RelevantAllConnections);
+	ClassPolicies.Set(APlayerState::StaticClass(), EFPTestClassRepPolicy::RelevantAllConnections);
+	ClassPolicies.Set(AFPTestCharacter::StaticClass(), EFPTestClassRepPolicy::Spatialize_Dynamic);
+
+	InitClassInfo(AActor::StaticClass(), true);
+	InitClassInfo(AFPTestCharacter::StaticClass(), true);
+	InitClassInfo(AGameStateBase::StaticClass(), false);
+	InitClassInfo(APlayerState::StaticClass(), false);
+	InitClassInfo(APlayerController::StaticClass(), false);
+}
+
+void UFPTestReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = CellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UFPTestReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UFPTestReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnection = CreateNewNode<UFPTestReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnection, RepGraphConnection);
+}
+
+void UFPTestReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	AddToNode(ActorInfo, GlobalInfo, GetActorPolicy(ActorInfo.Actor));
+}
+
+void UFPTestReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	TWeakObjectPtr<AActor> Character;
+	if (AttachedWeapons.RemoveAndCopyValue(ActorInfo.Actor, Character))
+	{
+		if (AActor* CharacterActor = Character.Get())
+		{
+			GlobalActorReplicationInfoMap.RemoveDependentActor(CharacterActor, ActorInfo.Actor);
+		}
+		return;
+	}
+
+	// Weapons still carried by a character which leaves would not replicate at all anymore, they go back into the grid
+	TArray<AActor*, TInlineAllocator<2>> CarriedWeapons;
+	for (const TPair<TObjectKey<AActor>, TWeakObjectPtr<AActor>>& AttachedWeapon : AttachedWeapons)
+	{
+		// The character is being destroyed already, so the weak pointer only resolves it even if pending kill
+		if (AttachedWeapon.Value.Get(true) == ActorInfo.Actor)
+		{
+			CarriedWeapons.Add(AttachedWeapon.Key.ResolveObjectPtr());
+		}
+	}
+	for (AActor* Weapon : CarriedWeapons)
+	{
+		RouteCarriedWeaponToGrid(Weapon, ActorInfo.Actor);
+	}
+
+	RemoveFromNode(ActorInfo, GetActorPolicy(ActorInfo.Actor));
+}
+
+void UFPTestReplicationGraph::OnWeaponAttached(AActor* Weapon, AActor* Character)
+{
+	if (!Weapon || !Character || AttachedWeapons.Contains(Weapon))
+	{
+		return;
+	}
+
+	// Out of the grid, the weapon now replicates together with the character
+	const FNewReplicatedActorInfo ActorInfo(Weapon);
+	RemoveFromNode(ActorInfo, GetActorPolicy(Weapon));
+	GlobalActorReplicationInfoMap.AddDependentActor(Character, Weapon);
+	AttachedWeapons.Add(Weapon, Character);
+}
+
+void UFPTestReplicationGraph::OnWeaponDetached(AActor* Weapon)
+{
+	TWeakObjectPtr<AActor> Character;
+	if (!Weapon || !AttachedWeapons.RemoveAndCopyValue(Weapon, Character))
+	{
+		return;
+	}
+
+	RouteCarriedWeaponToGrid(Weapon, Character.Get());
+}
+
+void UFPTestReplicationGraph::RouteCarriedWeaponToGrid(AActor* Weapon, AActor* Character)
+{
+	AttachedWeapons.Remove(Weapon);
+	if (!Weapon)
+	{
+		return;
+	}
+
+	if (Character)
+	{
+		GlobalActorReplicationInfoMap.RemoveDependentActor(Character, Weapon);
+	}
+
+	// A weapon being destroyed is removed from the graph on its own
+	if (!IsValid(Weapon))
+	{
+		return;
+	}
+
+	const FNewReplicatedActorInfo ActorInfo(Weapon);
+	AddToNode(ActorInfo, GlobalActorReplicationInfoMap.Get(Weapon), GetActorPolicy(Weapon));
+}
+
+UFPTestReplicationGraph* UFPTestReplicationGraph::Get(const UWorld* World)
+{
+	const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	return NetDriver ? Cast<UFPTestReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+}
+
+EFPTestClassRepPolicy UFPTestReplicationGraph::GetClassPolicy(const UClass* Class) const
+{
+	const EFPTestClassRepPolicy* Policy = ClassPolicies.Get(Class);
+	return Policy ? *Policy : EFPTestClassRepPolicy::Spatialize_Dynamic;
+}
+
+EFPTestClassRepPolicy UFPTestReplicationGraph::GetActorPolicy(const AActor* Actor) const
+{
+	// Only relevant to the owner is handled by the connection node, always relevant by the always relevant list
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return EFPTestClassRepPolicy::NotRouted;
+	}
+	if (Actor->bAlwaysRelevant)
+	{
+		return EFPTestClassRepPolicy::RelevantAllConnections;
+	}
+
+	// Weapons are blueprints, we know them by their component. Lying around they are dormant
+	if (Actor->FindComponentByClass<UTP_WeaponComponent>())
+	{
+		return EFPTestClassRepPolicy::Spatialize_Dormancy;
+	}
+
+	return GetClassPolicy(Actor->GetClass());
+}
+
+void UFPTestReplicationGraph::AddToNode(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo, EFPTestClassRepPolicy Policy)
+{
+	switch (Policy)
+	{
+	case EFPTestClassRepPolicy::NotRouted:
+		break;
+	case EFPTestClassRepPolicy::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	}
+}
+
+void UFPTestReplicationGraph::RemoveFromNode(const FNewReplicatedActorInfo& ActorInfo, EFPTestClassRepPolicy Policy)
+{
+	switch (Policy)
+	{
+	case EFPTestClassRepPolicy::NotRouted:
+		break;
+	case EFPTestClassRepPolicy::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EFPTestClassRepPolicy::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	}
+}
+
+void UFPTestReplicationGraph::InitClassInfo(UClass* Class, bool bSpatialize)
+{
+	const AActor* ActorDefaults = GetDefault<AActor>(Class);
+
+	FClassReplicationInfo ClassInfo;
+	if (bSpatialize)
+	{
+		ClassInfo.SetCullDistanceSquared(ActorDefaults->NetCullDistanceSquared);
+	}
+	ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorDefaults->NetUpdateFrequency);
+	GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+}
+
+void UFPTestReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		if (Viewer.InViewer)
+		{
+			ReplicationActorList.ConditionalAdd(Viewer.InViewer);
+		}
+		if (Viewer.ViewTarget)
+		{
+			ReplicationActorList.ConditionalAdd(Viewer.ViewTarget);
+		}
+		if (const APlayerController* PlayerController = Cast<APlayerController>(Viewer.InViewer))
+		{
+			if (APawn* Pawn = PlayerController->GetPawn())
+			{
+				ReplicationActorList.ConditionalAdd(Pawn);
+			}
+		}
+	}
+
+	Super::GatherActorListsForConnection(Params);
+}
@@ -0,0 +1,103 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "FPTestReplicationGraph.generated.h"
+
+/** How the replication graph routes the actors of a class */
+enum class EFPTestClassRepPolicy : uint8
+{
+	/** Not routed to a node, e.g. player controllers, the connection node takes care of them */
+	NotRouted,
+	/** Replicated to every connection */
+	RelevantAllConnections,
+	/** Spatialized, but never moves */
+	Spatialize_Static,
+	/** Spatialized and moves, updated every frame */
+	Spatialize_Dynamic,
+	/** Spatialized and moves only while awake */
+	Spatialize_Dormancy
+};
+
+/**
+ * Replication graph of the project
+ * Characters and weapons lying around are in a 2D grid, so a connection only looks at the cells around its viewers.
+ * Game state and player states are relevant for everybody and gathered from one list.
+ * A weapon carried by a character is not in the grid, it is a dependent of the character and replicates whenever the character does.
+ *
+ * Used for the game net driver unless FPTest.RepGraph.Enable is 0 or -NoFPTestRepGraph is passed
+ */
+UCLASS(transient, config = Engine)
+class FPTEST_API UFPTestReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UFPTestReplicationGraph();
+
+	// UReplicationGraph interface
+	virtual void ResetGameWorldState() override;
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	// End of UReplicationGraph interface
+
+	/** Makes the weapon a dependent of the character which picked it up */
+	void OnWeaponAttached(AActor* Weapon, AActor* Character);
+
+	/** Puts the weapon back into the grid */
+	void OnWeaponDetached(AActor* Weapon);
+
+	/** Replication graph of the world, null if the world does not use one */
+	static UFPTestReplicationGraph* Get(const UWorld* World);
+
+	/** Size of a grid cell */
+	UPROPERTY(config)
+	float CellSize = 10000.0f;
+
+	/** Lower corner of the grid, actors beyond it are clamped into the outer cells */
+	UPROPERTY(config)
+	FVector2D SpatialBias = FVector2D(-150000.0f, -150000.0f);
+
+private:
+	/** Policy of the class, looked up through the super classes and cached */
+	EFPTestClassRepPolicy GetClassPolicy(const UClass* Class) const;
+
+	/** Policy of the actor, weapons depend on whether they are carried */
+	EFPTestClassRepPolicy GetActorPolicy(const AActor* Actor) const;
+
+	/** Takes the weapon out of the dependents of the character and adds it to the grid again */
+	void RouteCarriedWeaponToGrid(AActor* Weapon, AActor* Character);
+
+	/** Adds or removes the actor to the node of the policy */
+	void AddToNode(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo, EFPTestClassRepPolicy Policy);
+	void RemoveFromNode(const FNewReplicatedActorInfo& ActorInfo, EFPTestClassRepPolicy Policy);
+
+	/** Sets cull distance and update period from the class defaults */
+	void InitClassInfo(UClass* Class, bool bSpatialize);
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	mutable TClassMap<EFPTestClassRepPolicy> ClassPolicies;
+
+	/** Carried weapons and who carries them */
+	TMap<TObjectKey<AActor>, TWeakObjectPtr<AActor>> AttachedWeapons;
+};
+
+/** Always relevant for its connection, the player controller, its pawn and view target */
+UCLASS()
+class FPTEST_API UFPTestReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+};
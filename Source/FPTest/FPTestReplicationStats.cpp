@@ -0,0 +1,110 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestReplicationStats.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+
+namespace FPTestReplicationStats
+{
+	struct FClassProperties
+	{
+		int32 NumProperties = 0;
+		int32 NumPushBased = 0;
+	};
+
+	/** Lifetime properties are the same for every object of a class, so they are counted once from the CDO */
+	static FClassProperties CountProperties(const UObject& Object, TMap<const UClass*, FClassProperties>& Cache)
+	{
+		const UClass* Class = Object.GetClass();
+		if (const FClassProperties* Cached = Cache.Find(Class))
+		{
+			return *Cached;
+		}
+
+		TArray<FLifetimeProperty> LifetimeProperties;
+		Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProperties);
+
+		FClassProperties Properties;
+		for (const FLifetimeProperty& LifetimeProperty : LifetimeProperties)
+		{
+			if (LifetimeProperty.Condition == COND_Never)
+			{
+				continue;
+			}
+
+			Properties.NumProperties++;
+			if (LifetimeProperty.bIsPushBased)
+			{
+				Properties.NumPushBased++;
+			}
+		}
+
+		return Cache.Add(Class, Properties);
+	}
+}
+
+FFPTestReplicationStats FFPTestReplicationStats::Gather(UWorld& World)
+{
+	using namespace FPTestReplicationStats;
+
+	FFPTestReplicationStats Stats;
+
+	// An actor gets considered at most once per net tick, less if its update frequency is lower than the tick rate
+	const UNetDriver* NetDriver = World.GetNetDriver();
+	const float NetTickRate = NetDriver ? FMath::Max(NetDriver->GetNetServerMaxTickRate(), 1) : 30.0f;
+
+	TMap<const UClass*, FClassProperties> Cache;
+	for (TActorIterator<AActor> It(&World); It; ++It)
+	{
+		const AActor* Actor = *It;
+		if (!Actor->GetIsReplicated())
+		{
+			continue;
+		}
+
+		FClassProperties ActorProperties = CountProperties(*Actor, Cache);
+		for (const UActorComponent* Component : Actor->GetReplicatedComponents())
+		{
+			const FClassProperties ComponentProperties = CountProperties(*Component, Cache);
+			ActorProperties.NumProperties += ComponentProperties.NumProperties;
+			ActorProperties.NumPushBased += ComponentProperties.NumPushBased;
+		}
+
+		const double UpdatesPerTick = FMath::Min(Actor->NetUpdateFrequency / NetTickRate, 1.0f);
+		const bool bDormant = Actor->NetDormancy > DORM_Awake;
+
+		Stats.NumActors++;
+		Stats.NumDormantActors += bDormant ? 1 : 0;
+		Stats.NumProperties += ActorProperties.NumProperties;
+		Stats.NumPushBasedProperties += ActorProperties.NumPushBased;
+		Stats.ComparedPerTickBefore += UpdatesPerTick * ActorProperties.NumProperties;
+		if (!bDormant)
+		{
+			Stats.ComparedPerTickAfter += UpdatesPerTick * (ActorProperties.NumProperties - ActorProperties.NumPushBased);
+		}
+	}
+
+	return Stats;
+}
+
+void FFPTestReplicationStats::Log() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Replication: %d actors (%d dormant), %d properties (%d push based)"),
+		NumActors, NumDormantActors, NumProperties, NumPushBasedProperties);
+	UE_LOG(LogTemp, Display, TEXT("Replication: compared properties per net tick before %.1f, after %.1f (plus the push based ones marked dirty)"),
+		ComparedPerTickBefore, ComparedPerTickAfter);
+}
+
+static FAutoConsoleCommandWithWorld CmdFPTestNetComparedProperties(
+	TEXT("FPTest.Net.ComparedProperties"),
+	TEXT("Logs an estimate of the replicated properties the server compares per net tick, with and without push model and dormancy."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (World)
+		{
+			FFPTestReplicationStats::Gather(*World).Log();
+		}
+	}));
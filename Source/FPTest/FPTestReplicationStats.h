@@ -0,0 +1,40 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/**
+ * Estimate of how many replicated properties the server compares per net tick
+ * Every actor that is considered for replication in a tick compares all its replicated properties and the ones of its components,
+ * except push based properties which were not marked dirty and actors which are dormant.
+ * Before is the cost as if nothing was push based or dormant, after is the cost with both
+ */
+struct FPTEST_API FFPTestReplicationStats
+{
+	/** Replicated actors in the world */
+	int32 NumActors = 0;
+
+	/** Replicated actors which are dormant */
+	int32 NumDormantActors = 0;
+
+	/** Properties of all replicated actors and their components */
+	int32 NumProperties = 0;
+
+	/** Properties of them which are push based */
+	int32 NumPushBasedProperties = 0;
+
+	/** Properties compared per net tick without push model and dormancy */
+	double ComparedPerTickBefore = 0.0;
+
+	/** Properties compared per net tick, undirtied push based properties and dormant actors skipped */
+	double ComparedPerTickAfter = 0.0;
+
+	/** Gathers the stats of the world */
+	static FFPTestReplicationStats Gather(UWorld& World);
+
+	/** Writes the stats to the log */
+	void Log() const;
+};
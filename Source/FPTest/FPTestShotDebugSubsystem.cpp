@@ -0,0 +1,204 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestShotDebugSubsystem.h"
+#include "Components/LineBatchComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#if FPTEST_SHOT_DEBUG
+
+int32 GFPTestShotDebug = 0;
+static FAutoConsoleVariableRef CVarFPTestShotDebug(
+	TEXT("FPTest.ShotDebug"),
+	GFPTestShotDebug,
+	TEXT("0: Shots are not recorded.\n")
+	TEXT("1: Shot traces and impacts are recorded, see FPTest.ShotDebug.Draw and FPTest.ShotDebug.Dump.\n")
+	TEXT("2: Like 1, but the recent shots are drawn every frame."));
+
+static float GFPTestShotDebugMaxAge = 1.0f;
+static FAutoConsoleVariableRef CVarFPTestShotDebugMaxAge(
+	TEXT("FPTest.ShotDebug.MaxAge"),
+	GFPTestShotDebugMaxAge,
+	TEXT("Seconds a shot stays visible with FPTest.ShotDebug 2."));
+
+namespace FPTestShotDebug
+{
+	static const FLinearColor TraceColor = FLinearColor::Green;
+	static const FLinearColor ImpactColor = FLinearColor::Red;
+	static constexpr float ImpactSize = 10.0f;
+	static constexpr float Thickness = 1.0f;
+}
+
+#endif
+
+void UFPTestShotDebugSubsystem::Record(const UWorld* World, const FVector& Start, const FVector& End, bool bImpact)
+{
+	if (UFPTestShotDebugSubsystem* ShotDebug = World ? World->GetSubsystem<UFPTestShotDebugSubsystem>() : nullptr)
+	{
+		ShotDebug->AddEntry(Start, End, bImpact);
+	}
+}
+
+void UFPTestShotDebugSubsystem::AddEntry(const FVector& Start, const FVector& End, bool bImpact)
+{
+	if (Entries.Num() == 0)
+	{
+		Entries.SetNum(Capacity);
+	}
+
+	FFPTestShotDebugEntry& Entry = Entries[Head];
+	Entry.Start = Start;
+	Entry.End = End;
+	Entry.Time = GetWorld()->GetTimeSeconds();
+	Entry.bImpact = bImpact;
+
+	Head = (Head + 1) % Capacity;
+	NumEntries = FMath::Min(NumEntries + 1, Capacity);
+}
+
+void UFPTestShotDebugSubsystem::Draw(float MaxAge, float Lifetime) const
+{
+#if FPTEST_SHOT_DEBUG
+	using namespace FPTestShotDebug;
+
+	UWorld* const World = GetWorld();
+	ULineBatchComponent* const LineBatcher = World ? (Lifetime > 0.0f ? World->PersistentLineBatcher : World->LineBatcher) : nullptr;
+	if (!LineBatcher || NumEntries == 0)
+	{
+		return;
+	}
+
+	// Everything goes into the line batcher in one call, an impact is a small cross instead of a sphere
+	const double MinTime = World->GetTimeSeconds() - MaxAge;
+	TArray<FBatchedLine> Lines;
+	Lines.Reserve(NumEntries);
+	ForEachEntry([&](const FFPTestShotDebugEntry& Entry)
+	{
+		if (Entry.Time < MinTime)
+		{
+			return;
+		}
+
+		if (Entry.bImpact)
+		{
+			Lines.Emplace(Entry.Start - FVector(ImpactSize, 0.0f, 0.0f), Entry.Start + FVector(ImpactSize, 0.0f, 0.0f), ImpactColor, Lifetime, Thickness, SDPG_World);
+			Lines.Emplace(Entry.Start - FVector(0.0f, ImpactSize, 0.0f), Entry.Start + FVector(0.0f, ImpactSize, 0.0f), ImpactColor, Lifetime, Thickness, SDPG_World);
+			Lines.Emplace(Entry.Start - FVector(0.0f, 0.0f, ImpactSize), Entry.Start + FVector(0.0f, 0.0f, ImpactSize), ImpactColor, Lifetime, Thickness, SDPG_World);
+		}
+		else
+		{
+			Lines.Emplace(Entry.Start, Entry.End, TraceColor, Lifetime, Thickness, SDPG_World);
+		}
+	});
+
+	LineBatcher->DrawLines(Lines);
+#endif
+}
+
+void UFPTestShotDebugSubsystem::Dump() const
+{
+	UE_LOG(LogTemp, Display, TEXT("ShotDebug: %d of %d entries"), NumEntries, Capacity);
+	ForEachEntry([](const FFPTestShotDebugEntry& Entry)
+	{
+		if (Entry.bImpact)
+		{
+			UE_LOG(LogTemp, Display, TEXT("  %.3f impact %s"), Entry.Time, *Entry.Start.ToString());
+		}
+		else
+		{
+			UE_LOG(LogTemp, Display, TEXT("  %.3f trace %s -> %s"), Entry.Time, *Entry.Start.ToString(), *Entry.End.ToString());
+		}
+	});
+}
+
+void UFPTestShotDebugSubsystem::Clear()
+{
+	Head = 0;
+	NumEntries = 0;
+}
+
+void UFPTestShotDebugSubsystem::ForEachEntry(TFunctionRef<void(const FFPTestShotDebugEntry&)> Function) const
+{
+	const int32 Oldest = (Head - NumEntries + Capacity) % Capacity;
+	for (int32 Index = 0; Index < NumEntries; Index++)
+	{
+		Function(Entries[(Oldest + Index) % Capacity]);
+	}
+}
+
+void UFPTestShotDebugSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+#if FPTEST_SHOT_DEBUG
+	Draw(GFPTestShotDebugMaxAge, 0.0f);
+#endif
+}
+
+TStatId UFPTestShotDebugSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestShotDebugSubsystem, STATGROUP_Tickables);
+}
+
+bool UFPTestShotDebugSubsystem::IsTickable() const
+{
+#if FPTEST_SHOT_DEBUG
+	// Only draws every frame if asked for and if there is something to draw on
+	return GFPTestShotDebug >= 2 && NumEntries > 0 && GetWorld() && GetWorld()->GetNetMode() != NM_DedicatedServer;
+#else
+	return false;
+#endif
+}
+
+bool UFPTestShotDebugSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if FPTEST_SHOT_DEBUG
+	return Super::ShouldCreateSubsystem(Outer);
+#else
+	return false;
+#endif
+}
+
+bool UFPTestShotDebugSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+#if FPTEST_SHOT_DEBUG
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFPTestShotDebugDraw(
+	TEXT("FPTest.ShotDebug.Draw"),
+	TEXT("Draws the recorded shots. Arguments: [Seconds=5] how long they stay, [MaxAge=all] only shots of the last seconds."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UFPTestShotDebugSubsystem* ShotDebug = World ? World->GetSubsystem<UFPTestShotDebugSubsystem>() : nullptr)
+		{
+			const float Seconds = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 5.0f;
+			const float MaxAge = Args.Num() > 1 ? FCString::Atof(*Args[1]) : TNumericLimits<float>::Max();
+			ShotDebug->Draw(MaxAge, FMath::Max(Seconds, UE_KINDA_SMALL_NUMBER));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdFPTestShotDebugDump(
+	TEXT("FPTest.ShotDebug.Dump"),
+	TEXT("Writes the recorded shots to the log."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UFPTestShotDebugSubsystem* ShotDebug = World ? World->GetSubsystem<UFPTestShotDebugSubsystem>() : nullptr)
+		{
+			ShotDebug->Dump();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdFPTestShotDebugClear(
+	TEXT("FPTest.ShotDebug.Clear"),
+	TEXT("Forgets the recorded shots."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UFPTestShotDebugSubsystem* ShotDebug = World ? World->GetSubsystem<UFPTestShotDebugSubsystem>() : nullptr)
+		{
+			ShotDebug->Clear();
+		}
+	}));
+
+#endif
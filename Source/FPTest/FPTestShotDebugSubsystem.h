@@ -0,0 +1,88 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestShotDebugSubsystem.generated.h"
+
+/** Shot debugging only exists in development builds */
+#define FPTEST_SHOT_DEBUG !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+#if FPTEST_SHOT_DEBUG
+/** Value of FPTest.ShotDebug, 0 means nothing gets recorded */
+extern FPTEST_API int32 GFPTestShotDebug;
+
+#define FPTEST_SHOT_DEBUG_TRACE(World, Start, End) \
+	do { if (GFPTestShotDebug != 0) { UFPTestShotDebugSubsystem::Record(World, Start, End, false); } } while (0)
+#define FPTEST_SHOT_DEBUG_IMPACT(World, Location) \
+	do { if (GFPTestShotDebug != 0) { UFPTestShotDebugSubsystem::Record(World, Location, Location, true); } } while (0)
+#else
+#define FPTEST_SHOT_DEBUG_TRACE(World, Start, End)
+#define FPTEST_SHOT_DEBUG_IMPACT(World, Location)
+#endif
+
+/** One recorded trace or impact */
+struct FFPTestShotDebugEntry
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	double Time = 0.0;
+	bool bImpact = false;
+};
+
+/**
+ * Records shot traces and impacts into a fixed size ring buffer and draws them batched
+ * Replaces the debug line and sphere every shot used to draw. Nothing happens unless FPTest.ShotDebug is set,
+ * with 1 the shots are only recorded, e.g. to dump them on a server, with 2 they are also drawn every frame.
+ * FPTest.ShotDebug.Draw draws the recorded shots once, FPTest.ShotDebug.Dump writes them to the log
+ */
+UCLASS()
+class FPTEST_API UFPTestShotDebugSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Amount of entries kept, the oldest gets overwritten */
+	static constexpr int32 Capacity = 512;
+
+	/** Records into the subsystem of the world, use the FPTEST_SHOT_DEBUG macros so it compiles out */
+	static void Record(const UWorld* World, const FVector& Start, const FVector& End, bool bImpact);
+
+	/** Adds an entry to the ring buffer */
+	void AddEntry(const FVector& Start, const FVector& End, bool bImpact);
+
+	/** Draws the entries of the last MaxAge seconds as one batch, Lifetime 0 draws them for one frame */
+	void Draw(float MaxAge, float Lifetime) const;
+
+	/** Writes the entries to the log */
+	void Dump() const;
+
+	/** Forgets all entries */
+	void Clear();
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	// End of FTickableGameObject interface
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Calls the function for every entry from the oldest to the newest */
+	void ForEachEntry(TFunctionRef<void(const FFPTestShotDebugEntry&)> Function) const;
+
+	TArray<FFPTestShotDebugEntry> Entries;
+
+	/** Where the next entry gets written */
+	int32 Head = 0;
+
+	/** Amount of valid entries */
+	int32 NumEntries = 0;
+};
@@ -0,0 +1,232 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestShotResolverSubsystem.h"
+#include "FPTestLagCompensationSubsystem.h"
+#include "FPTestStats.h"
+#include "FPTestTelemetry.h"
+#include "FPTestCharacter.h"
+#include "TP_WeaponComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static int32 GFPTestAsyncShotTraces = 1;
+static FAutoConsoleVariableRef CVarFPTestAsyncShotTraces(
+	TEXT("FPTest.ShotResolver.Async"),
+	GFPTestAsyncShotTraces,
+	TEXT("1: Shots of a frame are submitted as one batch of async traces and applied next frame.\n")
+	TEXT("0: Shots of a frame are traced synchronously in one batch at the end of the frame."));
+
+void UFPTestShotResolverSubsystem::QueueShot(UTP_WeaponComponent* Weapon, const FVector& StartLocation, const FVector& EndLocation, float ImpactModifier, int32 Damage, EWeaponShootType ShootType, double ShotTime, uint16 Sequence)
+{
+	FFPTestPendingShot& Shot = QueuedShots.AddDefaulted_GetRef();
+	Shot.Weapon = Weapon;
+	Shot.StartLocation = StartLocation;
+	Shot.EndLocation = EndLocation;
+	Shot.ImpactModifier = ImpactModifier;
+	Shot.Damage = Damage;
+	Shot.ShootType = ShootType;
+	Shot.ShotTime = ShotTime;
+	Shot.Sequence = Sequence;
+}
+
+void UFPTestShotResolverSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	FPTEST_SCOPE(ShotResolver);
+
+	UWorld* const World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	// First apply what was submitted before, so the order of the shots is kept
+	ResolveInFlightShots(*World);
+
+	if (QueuedShots.Num() == 0)
+	{
+		return;
+	}
+
+	if (GFPTestAsyncShotTraces != 0)
+	{
+		SubmitQueuedShots(*World);
+	}
+	else
+	{
+		ResolveQueuedShotsSync(*World);
+	}
+}
+
+void UFPTestShotResolverSubsystem::ResolveInFlightShots(UWorld& World)
+{
+	int32 NumResolved = 0;
+	FTraceDatum TraceData;
+	for (const FFPTestPendingShot& Shot : InFlightShots)
+	{
+		if (World.QueryTraceData(Shot.TraceHandle, TraceData))
+		{
+			const FHitResult* BlockingHit = TraceData.OutHits.FindByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+			ApplyShot(World, Shot, BlockingHit);
+		}
+		else if (World.IsTraceHandleValid(Shot.TraceHandle, false))
+		{
+			// Not done yet, we stop here so no later shot gets applied before this one
+			break;
+		}
+		// If the handle is not valid anymore, the trace data got lost and we just drop the shot
+
+		NumResolved++;
+	}
+
+	InFlightShots.RemoveAt(0, NumResolved, false);
+}
+
+void UFPTestShotResolverSubsystem::SubmitQueuedShots(UWorld& World)
+{
+	const UFPTestLagCompensationSubsystem* LagCompensation = World.GetSubsystem<UFPTestLagCompensationSubsystem>();
+	const bool bLagCompensated = LagCompensation && LagCompensation->IsEnabled();
+	const FCollisionQueryParams CollisionParams = MakeQueryParams(bLagCompensated);
+
+	for (FFPTestPendingShot& Shot : QueuedShots)
+	{
+		Shot.bLagCompensated = bLagCompensated;
+		Shot.TraceHandle = World.AsyncLineTraceByChannel(EAsyncTraceType::Single, Shot.StartLocation, Shot.EndLocation, COLLISION_SHOTTRACE, CollisionParams);
+	}
+
+	FPTEST_COUNT(Traces, QueuedShots.Num());
+
+	// Copy instead of moving, so both arrays keep their allocation for the next frames
+	InFlightShots.Append(QueuedShots);
+	QueuedShots.Reset();
+}
+
+void UFPTestShotResolverSubsystem::ResolveQueuedShotsSync(UWorld& World)
+{
+	const UFPTestLagCompensationSubsystem* LagCompensation = World.GetSubsystem<UFPTestLagCompensationSubsystem>();
+	const bool bLagCompensated = LagCompensation && LagCompensation->IsEnabled();
+	const FCollisionQueryParams CollisionParams = MakeQueryParams(bLagCompensated);
+
+	FHitResult OutHit;
+	for (FFPTestPendingShot& Shot : QueuedShots)
+	{
+		Shot.bLagCompensated = bLagCompensated;
+		const bool bHit = World.LineTraceSingleByChannel(OutHit, Shot.StartLocation, Shot.EndLocation, COLLISION_SHOTTRACE, CollisionParams);
+		ApplyShot(World, Shot, bHit ? &OutHit : nullptr);
+	}
+	FPTEST_COUNT(Traces, QueuedShots.Num());
+
+	QueuedShots.Reset();
+}
+
+FCollisionQueryParams UFPTestShotResolverSubsystem::MakeQueryParams(bool bLagCompensated) const
+{
+	FCollisionQueryParams CollisionParams(SCENE_QUERY_STAT(FPTestShotTrace));
+
+	// The penetration looks up the material of the first hit
+	CollisionParams.bReturnPhysicalMaterial = true;
+	if (bLagCompensated)
+	{
+		CollisionParams.IgnoreMask = FPTEST_MASKFILTER_CHARACTER;
+	}
+	return CollisionParams;
+}
+
+void UFPTestShotResolverSubsystem::ApplyShot(UWorld& World, const FFPTestPendingShot& Shot, const FHitResult* Hit)
+{
+	UTP_WeaponComponent* Weapon = Shot.Weapon.Get();
+	if (!Weapon)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(ApplyShot);
+	FPTEST_COUNT(ShotsResolved, 1);
+
+	const auto RecordHit = [&World, &Shot, Weapon](const FHitResult& ShotHit)
+	{
+		if (!FFPTestTelemetry::IsRecording() || !ShotHit.bBlockingHit)
+		{
+			return;
+		}
+
+		const AActor* HitActor = ShotHit.GetActor();
+		FFPTestTelemetryRecord Record;
+		Record.Type = EFPTestTelemetryType::Hit;
+		Record.Time = World.GetTimeSeconds();
+		Record.ShooterId = Weapon->Character ? Weapon->Character->GetUniqueID() : 0;
+		Record.TargetId = HitActor ? HitActor->GetUniqueID() : 0;
+		Record.Location = FVector3f(ShotHit.Location);
+		Record.SetDirection(Shot.EndLocation - Shot.StartLocation);
+		Record.Damage = HitActor && HitActor->IsA<AFPTestCharacter>() ? static_cast<uint16>(FMath::Clamp(Shot.Damage, 0, MAX_uint16)) : 0;
+		Record.LatencyMs = static_cast<uint16>(FMath::Clamp((Record.Time - Shot.ShotTime) * 1000.0, 0.0, static_cast<double>(MAX_uint16)));
+		Record.Sequence = Shot.Sequence;
+		Record.ShootType = static_cast<uint8>(Shot.ShootType);
+		FFPTestTelemetry::Record(Record);
+	};
+
+	// Only shots of weapons which go through things trace again, everything else stops at the first hit
+	const UFPTestPenetrationTable* PenetrationTable = Weapon->PenetrationTable;
+	if (PenetrationTable && Weapon->MaxPenetrations > 0)
+	{
+		const FCollisionQueryParams QueryParams = MakeQueryParams(Shot.bLagCompensated);
+
+		FFPTestPenetrationShot PenetrationShot;
+		PenetrationShot.StartLocation = Shot.StartLocation;
+		PenetrationShot.EndLocation = Shot.EndLocation;
+		PenetrationShot.ShotTime = Shot.ShotTime;
+		PenetrationShot.Shooter = Weapon->Character;
+		PenetrationShot.Table = PenetrationTable;
+		PenetrationShot.MaxPenetrations = Weapon->MaxPenetrations;
+		PenetrationShot.QueryParams = &QueryParams;
+		PenetrationShot.LagCompensation = Shot.bLagCompensated ? World.GetSubsystem<UFPTestLagCompensationSubsystem>() : nullptr;
+		Penetration.Resolve(World, PenetrationShot, Hit);
+
+		for (const FFPTestPenetrationHit& PenetrationHit : Penetration.GetHits())
+		{
+			RecordHit(PenetrationHit.Hit);
+			Weapon->ApplyShotHit(PenetrationHit.Hit, Shot.ImpactModifier * PenetrationHit.DamageScale, FMath::RoundToInt32(Shot.Damage * PenetrationHit.DamageScale), Shot.ShootType);
+		}
+		return;
+	}
+
+	// The world trace did not see the characters, so test their rewound capsules up to the world hit
+	if (Shot.bLagCompensated)
+	{
+		if (const UFPTestLagCompensationSubsystem* LagCompensation = World.GetSubsystem<UFPTestLagCompensationSubsystem>())
+		{
+			FHitResult RewindHit;
+			const float MaxTime = Hit ? Hit->Time : 1.0f;
+			if (LagCompensation->RewindTrace(Shot.ShotTime, Shot.StartLocation, Shot.EndLocation, MaxTime, Weapon->Character, RewindHit))
+			{
+				RecordHit(RewindHit);
+				Weapon->ApplyShotHit(RewindHit, Shot.ImpactModifier, Shot.Damage, Shot.ShootType);
+				return;
+			}
+		}
+	}
+
+	if (Hit)
+	{
+		RecordHit(*Hit);
+		Weapon->ApplyShotHit(*Hit, Shot.ImpactModifier, Shot.Damage, Shot.ShootType);
+	}
+}
+
+TStatId UFPTestShotResolverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestShotResolverSubsystem, STATGROUP_Tickables);
+}
+
+void UFPTestShotResolverSubsystem::Deinitialize()
+{
+	QueuedShots.Empty();
+	InFlightShots.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UFPTestShotResolverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "FPTestPenetration.h"
+#include "FPTestWeaponTypes.h"
+#include "FPTestShotResolverSubsystem.generated.h"
+
+class UTP_WeaponComponent;
+
+/** A shot fired on the server which still waits for its trace to be resolved */
+struct FFPTestPendingShot
+{
+	/** Weapon which fired the shot, it applies the hit once the trace is done */
+	TWeakObjectPtr<UTP_WeaponComponent> Weapon;
+
+	FVector StartLocation = FVector::ZeroVector;
+	FVector EndLocation = FVector::ZeroVector;
+	float ImpactModifier = 1.0f;
+	int32 Damage = 0;
+
+	/** Fire mode the shot was fired with, the weapon can be in another one once the shot is resolved */
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+
+	/** Server time the client fired at, the shot is traced against the characters rewound to this time */
+	double ShotTime = 0.0;
+
+	/** Sequence of the shot packet, for the telemetry */
+	uint16 Sequence = 0;
+
+	/** If the shot got traced with the characters masked out and has to be tested against the rewound capsules */
+	bool bLagCompensated = false;
+
+	/** Handle of the async trace, only valid once the shot got submitted */
+	FTraceHandle TraceHandle;
+};
+
+/**
+ * Server side shot resolution
+ * Instead of tracing every shot synchronously inside the RPC, all shots of a frame are queued here
+ * and submitted as one batch of async traces. The results are applied in the order the shots came in,
+ * always at the same point of the frame (when the tickable objects are ticked, after all tick groups)
+ */
+UCLASS()
+class FPTEST_API UFPTestShotResolverSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Queue a shot, it gets traced together with all other shots of this frame */
+	void QueueShot(UTP_WeaponComponent* Weapon, const FVector& StartLocation, const FVector& EndLocation, float ImpactModifier, int32 Damage, EWeaponShootType ShootType, double ShotTime, uint16 Sequence);
+
+	/** Amount of shots which are queued or in flight */
+	int32 GetNumPendingShots() const { return QueuedShots.Num() + InFlightShots.Num(); }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Applies the results of all in flight shots whose traces are done, keeps the order of the queue */
+	void ResolveInFlightShots(UWorld& World);
+
+	/** Hands all queued shots to the async trace system */
+	void SubmitQueuedShots(UWorld& World);
+
+	/** Traces and applies all queued shots right away, used when async traces are disabled */
+	void ResolveQueuedShotsSync(UWorld& World);
+
+	/** Query params of the shot traces, masks out the characters when they are lag compensated */
+	FCollisionQueryParams MakeQueryParams(bool bLagCompensated) const;
+
+	/** Applies the result of a single shot to the weapon which fired it */
+	void ApplyShot(UWorld& World, const FFPTestPendingShot& Shot, const FHitResult* Hit);
+
+	/** Shots fired during this frame */
+	TArray<FFPTestPendingShot> QueuedShots;
+
+	/** Shots submitted as async trace, waiting for the results */
+	TArray<FFPTestPendingShot> InFlightShots;
+
+	/** Follows shots of weapons with a penetration table, keeps its hit buffer over all shots */
+	FFPTestPenetrationResolver Penetration;
+};
@@ -0,0 +1,75 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestShotValidation.h"
+#include "FPTestStats.h"
+#include "FPTestWeaponTypes.h"
+#include "HAL/IConsoleManager.h"
+
+static float GFPTestShotMaxOriginError = 250.0f;
+static FAutoConsoleVariableRef CVarFPTestShotMaxOriginError(
+	TEXT("FPTest.ShotValidation.MaxOriginError"),
+	GFPTestShotMaxOriginError,
+	TEXT("How far a shot may start from the muzzle of the weapon on the server, covers the movement of the shooter during the latency."));
+
+static float GFPTestShotMaxAimError = 30.0f;
+static FAutoConsoleVariableRef CVarFPTestShotMaxAimError(
+	TEXT("FPTest.ShotValidation.MaxAimError"),
+	GFPTestShotMaxAimError,
+	TEXT("Degrees a shot may go off the direction the shooter aims at on the server, 180 turns the check off."));
+
+static float GFPTestShotCadenceTolerance = 1.0f;
+static FAutoConsoleVariableRef CVarFPTestShotCadenceTolerance(
+	TEXT("FPTest.ShotValidation.CadenceTolerance"),
+	GFPTestShotCadenceTolerance,
+	TEXT("Seconds of shots that may arrive ahead of their schedule on the server clock, bounds what forged shot times gain."));
+
+static float GFPTestShotTimeSlack = 0.01f;
+static FAutoConsoleVariableRef CVarFPTestShotTimeSlack(
+	TEXT("FPTest.ShotValidation.ShotTimeSlack"),
+	GFPTestShotTimeSlack,
+	TEXT("Seconds the shot times of two shots may be closer than the interval, covers their millisecond rounding and corrections of the client clock."));
+
+static float GFPTestShotMinInterval = 0.05f;
+static FAutoConsoleVariableRef CVarFPTestShotMinInterval(
+	TEXT("FPTest.ShotValidation.MinInterval"),
+	GFPTestShotMinInterval,
+	TEXT("Time between two shots of fire modes without a cooldown, faster than anybody clicks."));
+
+EFPTestShotViolation FFPTestShotValidator::Validate(const FFPTestShotPacket& Shot, const FFPTestShotContext& Context)
+{
+	const float MaxOriginDistance = Context.MuzzleDistance + GFPTestShotMaxOriginError;
+	const float MinAimDot = FMath::Cos(FMath::DegreesToRadians(GFPTestShotMaxAimError));
+	const float Interval = Context.Interval > 0.0f ? Context.Interval : GFPTestShotMinInterval;
+
+	// The interval is checked on the client times, the server clock only bounds how far they can run ahead of it
+	const double ShotTime = Shot.DecompressShotTime(Context.Time);
+	const double DueTime = FMath::Max(NextShotTime, Context.Time);
+	const bool bTooFast = ShotTime - LastShotTime < Interval - GFPTestShotTimeSlack;
+	const bool bOutOfCredit = DueTime - Context.Time > GFPTestShotCadenceTolerance;
+
+	const uint8 Violations =
+		static_cast<uint8>(FVector::DistSquared(Shot.Origin, Context.WeaponLocation) > FMath::Square(MaxOriginDistance)) * static_cast<uint8>(EFPTestShotViolation::Origin) |
+		static_cast<uint8>((Shot.Direction | Context.AimDirection) < MinAimDot) * static_cast<uint8>(EFPTestShotViolation::Aim) |
+		static_cast<uint8>(bTooFast | bOutOfCredit) * static_cast<uint8>(EFPTestShotViolation::Cadence) |
+		static_cast<uint8>(Context.Ammo <= 0) * static_cast<uint8>(EFPTestShotViolation::Ammo);
+
+	// A rejected shot does not count for the cadence, the client gives the ammunition back as well
+	NextShotTime = Violations == 0 ? DueTime + Interval : NextShotTime;
+	LastShotTime = Violations == 0 ? ShotTime : LastShotTime;
+
+	return static_cast<EFPTestShotViolation>(Violations);
+}
+
+void FFPTestShotValidator::CountViolations(EFPTestShotViolation Violations)
+{
+	if (Violations == EFPTestShotViolation::None)
+	{
+		return;
+	}
+
+	FPTEST_COUNT(ShotViolations, 1);
+	FPTEST_COUNT(ShotViolationsOrigin, EnumHasAnyFlags(Violations, EFPTestShotViolation::Origin) ? 1 : 0);
+	FPTEST_COUNT(ShotViolationsAim, EnumHasAnyFlags(Violations, EFPTestShotViolation::Aim) ? 1 : 0);
+	FPTEST_COUNT(ShotViolationsCadence, EnumHasAnyFlags(Violations, EFPTestShotViolation::Cadence) ? 1 : 0);
+	FPTEST_COUNT(ShotViolationsAmmo, EnumHasAnyFlags(Violations, EFPTestShotViolation::Ammo) ? 1 : 0);
+}
@@ -0,0 +1,78 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FFPTestShotPacket;
+
+/** Checks a shot failed on the server, several can fail at once */
+enum class EFPTestShotViolation : uint8
+{
+	None = 0,
+	/** The shot started too far away from the weapon */
+	Origin = 1 << 0,
+	/** The shot went too far off the direction the character aims at */
+	Aim = 1 << 1,
+	/** The shot came faster than the fire mode allows */
+	Cadence = 1 << 2,
+	/** The magazine was empty on the server */
+	Ammo = 1 << 3
+};
+ENUM_CLASS_FLAGS(EFPTestShotViolation);
+
+/** What the server knows about the shooter when a shot comes in */
+struct FFPTestShotContext
+{
+	/** Where the weapon is on the server */
+	FVector WeaponLocation = FVector::ZeroVector;
+
+	/** Direction the character aims at on the server */
+	FVector AimDirection = FVector::ForwardVector;
+
+	/** Distance of the muzzle from the weapon */
+	float MuzzleDistance = 0.0f;
+
+	/** Time between two shots of the fire mode, 0 if the mode has no cooldown */
+	float Interval = 0.0f;
+
+	/** Ammunition on the server before the shot */
+	int32 Ammo = 0;
+
+	/** Time the shot arrived at */
+	double Time = 0.0;
+};
+
+/**
+ * Server side checks of the shots of one weapon
+ * The client only sends origin and direction, the trace length is always given by the weapon on the server,
+ * so what is left to check is where the shot starts, where it goes, how fast the shots come and if there is ammunition.
+ * Every check is a compare without branches or allocations, shots come in by the thousands per second.
+ * The cadence is checked on the shot times the client sent, so shots bunched up by network jitter still pass.
+ * Those times could be forged, so the server also keeps a virtual schedule on its own clock: every accepted shot moves
+ * the earliest time of the next one by the interval, and shots may only run the cadence credit ahead of it.
+ * Limits are set with FPTest.ShotValidation.* and violations are counted in stat FPTest
+ */
+class FPTEST_API FFPTestShotValidator
+{
+public:
+	/** Returns the failed checks, the cadence only advances for shots without any */
+	EFPTestShotViolation Validate(const FFPTestShotPacket& Shot, const FFPTestShotContext& Context);
+
+	/** Forgets the cadence, for a weapon returned to the pool */
+	void Reset()
+	{
+		NextShotTime = 0.0;
+		LastShotTime = -UE_BIG_NUMBER;
+	}
+
+	/** Adds the violations to the stats and counters */
+	static void CountViolations(EFPTestShotViolation Violations);
+
+private:
+	/** Earliest server time the next shot is due at */
+	double NextShotTime = 0.0;
+
+	/** Time the client fired the last accepted shot at */
+	double LastShotTime = -UE_BIG_NUMBER;
+};
@@ -0,0 +1,19 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** How much a character matters to the local players, the buckets of the significance subsystem */
+enum class EFPTestSignificance : uint8
+{
+	/** Close and in view, or controlled here. Everything at full rate */
+	High,
+	/** Animates at a lower rate */
+	Medium,
+	/** Animates at a low rate */
+	Low,
+	/** Far away or out of view, no pose and no effects */
+	Culled,
+	Num
+};
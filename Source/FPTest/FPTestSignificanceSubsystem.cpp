@@ -0,0 +1,223 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestSignificanceSubsystem.h"
+#include "FPTestCharacter.h"
+#include "FPTestStats.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+static float GFPTestSignificanceHighDistance = 2000.0f;
+static FAutoConsoleVariableRef CVarFPTestSignificanceHighDistance(
+	TEXT("FPTest.Significance.HighDistance"),
+	GFPTestSignificanceHighDistance,
+	TEXT("Characters closer than this to a local view can be High."));
+
+static float GFPTestSignificanceMediumDistance = 5000.0f;
+static FAutoConsoleVariableRef CVarFPTestSignificanceMediumDistance(
+	TEXT("FPTest.Significance.MediumDistance"),
+	GFPTestSignificanceMediumDistance,
+	TEXT("Characters closer than this are at least Medium."));
+
+static float GFPTestSignificanceLowDistance = 12000.0f;
+static FAutoConsoleVariableRef CVarFPTestSignificanceLowDistance(
+	TEXT("FPTest.Significance.LowDistance"),
+	GFPTestSignificanceLowDistance,
+	TEXT("Characters closer than this are at least Low, the ones further away are Culled."));
+
+static int32 GFPTestSignificanceMaxHigh = 8;
+static FAutoConsoleVariableRef CVarFPTestSignificanceMaxHigh(
+	TEXT("FPTest.Significance.MaxHigh"),
+	GFPTestSignificanceMaxHigh,
+	TEXT("Remote characters in the High bucket at most, the closest ones get it."));
+
+static float GFPTestSignificanceOutOfViewScale = 3.0f;
+static FAutoConsoleVariableRef CVarFPTestSignificanceOutOfViewScale(
+	TEXT("FPTest.Significance.OutOfViewScale"),
+	GFPTestSignificanceOutOfViewScale,
+	TEXT("How much further away characters outside of the view count."));
+
+static float GFPTestSignificanceViewAngle = 60.0f;
+static FAutoConsoleVariableRef CVarFPTestSignificanceViewAngle(
+	TEXT("FPTest.Significance.ViewAngle"),
+	GFPTestSignificanceViewAngle,
+	TEXT("Degrees from the view direction a character still counts as in view, a bit more than half the field of view."));
+
+namespace FPTestSignificance
+{
+	/** Tick interval of the character mesh per bucket, 0 keeps the interval of the mesh */
+	static constexpr float TickIntervals[static_cast<int32>(EFPTestSignificance::Num)] = { 0.0f, 1.0f / 30.0f, 1.0f / 10.0f, 0.25f };
+}
+
+void UFPTestSignificanceSubsystem::RegisterCharacter(AFPTestCharacter* Character)
+{
+	if (!Character || Characters.ContainsByPredicate([Character](const FTrackedCharacter& Tracked) { return Tracked.Character == Character; }))
+	{
+		return;
+	}
+
+	FTrackedCharacter& Tracked = Characters.AddDefaulted_GetRef();
+	Tracked.Character = Character;
+	if (const USkeletalMeshComponent* Mesh = Character->GetMesh())
+	{
+		Tracked.MeshTickOption = Mesh->VisibilityBasedAnimTickOption;
+		Tracked.MeshTickInterval = Mesh->GetComponentTickInterval();
+		Tracked.bMeshUpdateRateOptimizations = Mesh->bEnableUpdateRateOptimizations;
+	}
+	if (const USkeletalMeshComponent* Mesh1P = Character->GetMesh1P())
+	{
+		Tracked.Mesh1PTickOption = Mesh1P->VisibilityBasedAnimTickOption;
+	}
+
+	// Starts as High and local, so the first update applies whatever it really is
+	Tracked.bLocallyControlled = true;
+}
+
+void UFPTestSignificanceSubsystem::UnregisterCharacter(AFPTestCharacter* Character)
+{
+	Characters.RemoveAllSwap([Character](const FTrackedCharacter& Tracked) { return Tracked.Character == Character; }, false);
+}
+
+void UFPTestSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWorld* const World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	FPTEST_SCOPE(Significance);
+
+	ViewLocations.Reset();
+	ViewDirections.Reset();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalPlayerController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+			ViewDirections.Add(ViewRotation.Vector());
+		}
+	}
+
+	// Nobody looks yet, e.g. while the player controller is still on the way
+	if (ViewLocations.Num() == 0)
+	{
+		return;
+	}
+
+	Characters.RemoveAllSwap([](const FTrackedCharacter& Tracked) { return !Tracked.Character.IsValid(); }, false);
+
+	const float MinViewDot = FMath::Cos(FMath::DegreesToRadians(GFPTestSignificanceViewAngle));
+	Ranking.Reset();
+	for (int32 Index = 0; Index < Characters.Num(); Index++)
+	{
+		FTrackedCharacter& Tracked = Characters[Index];
+		const FVector Location = Tracked.Character->GetActorLocation();
+
+		float Score = TNumericLimits<float>::Max();
+		for (int32 View = 0; View < ViewLocations.Num(); View++)
+		{
+			const FVector ToCharacter = Location - ViewLocations[View];
+			const float Distance = ToCharacter.Size();
+			const bool bInView = Distance <= UE_KINDA_SMALL_NUMBER || (ToCharacter / Distance | ViewDirections[View]) >= MinViewDot;
+			Score = FMath::Min(Score, bInView ? Distance : Distance * GFPTestSignificanceOutOfViewScale);
+		}
+		Tracked.Score = Score;
+		Ranking.Add(Index);
+	}
+
+	Ranking.Sort([this](int32 A, int32 B) { return Characters[A].Score < Characters[B].Score; });
+
+	FMemory::Memzero(NumInBucket);
+	int32 NumHigh = 0;
+	for (const int32 Index : Ranking)
+	{
+		FTrackedCharacter& Tracked = Characters[Index];
+		const bool bLocallyControlled = Tracked.Character->IsLocallyControlled();
+
+		EFPTestSignificance Significance = EFPTestSignificance::Culled;
+		if (bLocallyControlled)
+		{
+			Significance = EFPTestSignificance::High;
+		}
+		else if (Tracked.Score <= GFPTestSignificanceHighDistance && NumHigh < GFPTestSignificanceMaxHigh)
+		{
+			Significance = EFPTestSignificance::High;
+			NumHigh++;
+		}
+		else if (Tracked.Score <= GFPTestSignificanceMediumDistance)
+		{
+			Significance = EFPTestSignificance::Medium;
+		}
+		else if (Tracked.Score <= GFPTestSignificanceLowDistance)
+		{
+			Significance = EFPTestSignificance::Low;
+		}
+
+		if (Significance != Tracked.Significance || bLocallyControlled != Tracked.bLocallyControlled)
+		{
+			ApplySignificance(Tracked, Significance, bLocallyControlled);
+		}
+		NumInBucket[static_cast<int32>(Significance)]++;
+	}
+
+	FPTEST_SET_VALUE(SignificanceHigh, NumInBucket[static_cast<int32>(EFPTestSignificance::High)]);
+	FPTEST_SET_VALUE(SignificanceMedium, NumInBucket[static_cast<int32>(EFPTestSignificance::Medium)]);
+	FPTEST_SET_VALUE(SignificanceLow, NumInBucket[static_cast<int32>(EFPTestSignificance::Low)]);
+	FPTEST_SET_VALUE(SignificanceCulled, NumInBucket[static_cast<int32>(EFPTestSignificance::Culled)]);
+}
+
+void UFPTestSignificanceSubsystem::ApplySignificance(FTrackedCharacter& Tracked, EFPTestSignificance Significance, bool bLocallyControlled) const
+{
+	Tracked.Significance = Significance;
+	Tracked.bLocallyControlled = bLocallyControlled;
+
+	AFPTestCharacter* Character = Tracked.Character.Get();
+	Character->SetSignificance(Significance);
+
+	// Below High the engine update rate optimization skips frames on top of the lower tick rate
+	if (USkeletalMeshComponent* Mesh = Character->GetMesh())
+	{
+		const bool bFullRate = Significance == EFPTestSignificance::High;
+		Mesh->bEnableUpdateRateOptimizations = bFullRate ? Tracked.bMeshUpdateRateOptimizations : true;
+		Mesh->SetComponentTickInterval(bFullRate ? Tracked.MeshTickInterval : FMath::Max(Tracked.MeshTickInterval, FPTestSignificance::TickIntervals[static_cast<int32>(Significance)]));
+		Mesh->VisibilityBasedAnimTickOption = Significance == EFPTestSignificance::Culled ? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered : Tracked.MeshTickOption;
+	}
+
+	// Only the owner sees the first person mesh, for everybody else it never needs a pose
+	if (USkeletalMeshComponent* Mesh1P = Character->GetMesh1P())
+	{
+		Mesh1P->VisibilityBasedAnimTickOption = bLocallyControlled ? Tracked.Mesh1PTickOption : EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	}
+}
+
+TStatId UFPTestSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFPTestSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+bool UFPTestSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Nobody looks on a dedicated server
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UFPTestSignificanceSubsystem::Deinitialize()
+{
+	Characters.Empty();
+	Ranking.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UFPTestSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,77 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestSignificance.h"
+#include "FPTestSignificanceSubsystem.generated.h"
+
+class AFPTestCharacter;
+
+/**
+ * Client side significance of the remote characters and their weapons
+ * Every frame the characters get ranked by their distance to the closest local view, characters behind the view count
+ * as further away. The closest ones within FPTest.Significance.HighDistance are High, up to FPTest.Significance.MaxHigh of them,
+ * the rest falls into the lower buckets by distance.
+ * The bucket sets the animation update rate of the character mesh, and the weapons skip their effects when culled.
+ * Not created on dedicated servers, characters with stripped cosmetics do not register.
+ */
+UCLASS()
+class FPTEST_API UFPTestSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterCharacter(AFPTestCharacter* Character);
+	void UnregisterCharacter(AFPTestCharacter* Character);
+
+	/** Characters in the bucket after the last update */
+	int32 GetNumInBucket(EFPTestSignificance Significance) const { return NumInBucket[static_cast<int32>(Significance)]; }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FTrackedCharacter
+	{
+		TWeakObjectPtr<AFPTestCharacter> Character;
+
+		/** Distance to the closest view, scaled up when out of view */
+		float Score = 0.0f;
+
+		EFPTestSignificance Significance = EFPTestSignificance::High;
+		bool bLocallyControlled = false;
+
+		/** Settings of the meshes before we changed them, restored when the character becomes High or local */
+		EVisibilityBasedAnimTickOption MeshTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+		EVisibilityBasedAnimTickOption Mesh1PTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+		float MeshTickInterval = 0.0f;
+		bool bMeshUpdateRateOptimizations = false;
+	};
+
+	/** Sets the update rate of the meshes for the bucket */
+	void ApplySignificance(FTrackedCharacter& Tracked, EFPTestSignificance Significance, bool bLocallyControlled) const;
+
+	TArray<FTrackedCharacter> Characters;
+
+	/** Indices into Characters from the most to the least significant, kept for the allocation */
+	TArray<int32> Ranking;
+
+	/** Camera of every local player */
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	TArray<FVector, TInlineAllocator<4>> ViewDirections;
+
+	int32 NumInBucket[static_cast<int32>(EFPTestSignificance::Num)] = {};
+};
@@ -0,0 +1,180 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestSpawnPointIndex.h"
+
+void FFPTestSpawnPointIndex::Reset(TConstArrayView<FVector> SpawnLocations, float InScoreRange)
+{
+	ScoreRange = FMath::Max(InScoreRange, 1.0f);
+	// With half the range as cell size, the range around a spawn point is at most 5x5 cells
+	CellSize = ScoreRange * 0.5f;
+
+	Locations.Reset(SpawnLocations.Num());
+	Locations.Append(SpawnLocations.GetData(), SpawnLocations.Num());
+	Scores.Init(ScoreRange, Locations.Num());
+	Heap.SetNumUninitialized(Locations.Num());
+	HeapIndices.SetNumUninitialized(Locations.Num());
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		Heap[Index] = Index;
+		HeapIndices[Index] = Index;
+	}
+	NextToScore = 0;
+
+	// The characters are in cells of the old size
+	Characters.Reset();
+	Cells.Reset();
+}
+
+void FFPTestSpawnPointIndex::BeginCharacterUpdate()
+{
+	CurrentStamp++;
+}
+
+void FFPTestSpawnPointIndex::UpdateCharacter(uint32 CharacterId, const FVector& Location)
+{
+	const FIntPoint Cell = GetCell(Location);
+
+	FCharacter* Character = Characters.Find(CharacterId);
+	if (!Character)
+	{
+		Character = &Characters.Add(CharacterId);
+		Cells.FindOrAdd(Cell).Add(CharacterId);
+	}
+	else if (Character->Cell != Cell)
+	{
+		RemoveFromCell(CharacterId, Character->Cell);
+		Cells.FindOrAdd(Cell).Add(CharacterId);
+	}
+
+	Character->Location = Location;
+	Character->Cell = Cell;
+	Character->Stamp = CurrentStamp;
+}
+
+void FFPTestSpawnPointIndex::EndCharacterUpdate()
+{
+	for (auto It = Characters.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Stamp != CurrentStamp)
+		{
+			RemoveFromCell(It->Key, It->Value.Cell);
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FFPTestSpawnPointIndex::ScoreSpawnPoints(int32 Count)
+{
+	Count = FMath::Min(Count, Locations.Num());
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		SetScore(NextToScore, ComputeScore(Locations[NextToScore]));
+		NextToScore = (NextToScore + 1) % Locations.Num();
+	}
+}
+
+void FFPTestSpawnPointIndex::MarkUsed(int32 SpawnPoint)
+{
+	if (Scores.IsValidIndex(SpawnPoint))
+	{
+		SetScore(SpawnPoint, 0.0f);
+	}
+}
+
+FIntPoint FFPTestSpawnPointIndex::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+void FFPTestSpawnPointIndex::RemoveFromCell(uint32 CharacterId, const FIntPoint& Cell)
+{
+	if (TArray<uint32>* CellCharacters = Cells.Find(Cell))
+	{
+		CellCharacters->RemoveSingleSwap(CharacterId, false);
+	}
+}
+
+float FFPTestSpawnPointIndex::ComputeScore(const FVector& Location) const
+{
+	float MinDistanceSquared = FMath::Square(ScoreRange);
+
+	const FIntPoint MinCell = GetCell(Location - FVector(ScoreRange, ScoreRange, 0.0f));
+	const FIntPoint MaxCell = GetCell(Location + FVector(ScoreRange, ScoreRange, 0.0f));
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+		{
+			const TArray<uint32>* CellCharacters = Cells.Find(FIntPoint(CellX, CellY));
+			if (!CellCharacters)
+			{
+				continue;
+			}
+
+			for (const uint32 CharacterId : *CellCharacters)
+			{
+				MinDistanceSquared = FMath::Min(MinDistanceSquared, static_cast<float>(FVector::DistSquared(Location, Characters.FindChecked(CharacterId).Location)));
+			}
+		}
+	}
+
+	return FMath::Sqrt(MinDistanceSquared);
+}
+
+void FFPTestSpawnPointIndex::SetScore(int32 SpawnPoint, float Score)
+{
+	const float OldScore = Scores[SpawnPoint];
+	Scores[SpawnPoint] = Score;
+	if (Score > OldScore)
+	{
+		SiftUp(HeapIndices[SpawnPoint]);
+	}
+	else if (Score < OldScore)
+	{
+		SiftDown(HeapIndices[SpawnPoint]);
+	}
+}
+
+void FFPTestSpawnPointIndex::SiftUp(int32 HeapIndex)
+{
+	while (HeapIndex > 0)
+	{
+		const int32 Parent = (HeapIndex - 1) / 2;
+		if (Scores[Heap[Parent]] >= Scores[Heap[HeapIndex]])
+		{
+			return;
+		}
+		SwapHeap(Parent, HeapIndex);
+		HeapIndex = Parent;
+	}
+}
+
+void FFPTestSpawnPointIndex::SiftDown(int32 HeapIndex)
+{
+	for (;;)
+	{
+		const int32 Left = HeapIndex * 2 + 1;
+		const int32 Right = Left + 1;
+		int32 Largest = HeapIndex;
+		if (Left < Heap.Num() && Scores[Heap[Left]] > Scores[Heap[Largest]])
+		{
+			Largest = Left;
+		}
+		if (Right < Heap.Num() && Scores[Heap[Right]] > Scores[Heap[Largest]])
+		{
+			Largest = Right;
+		}
+		if (Largest == HeapIndex)
+		{
+			return;
+		}
+		SwapHeap(Largest, HeapIndex);
+		HeapIndex = Largest;
+	}
+}
+
+void FFPTestSpawnPointIndex::SwapHeap(int32 A, int32 B)
+{
+	Swap(Heap[A], Heap[B]);
+	HeapIndices[Heap[A]] = A;
+	HeapIndices[Heap[B]] = B;
+}
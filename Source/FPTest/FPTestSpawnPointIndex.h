@@ -0,0 +1,83 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Spawn points ordered by how far away the nearest character is
+ * Characters are kept in a uniform 2D grid which is only touched when a character changes its cell.
+ * A few spawn points get scored again every tick against the cells around them and are kept in an indexed max heap,
+ * so the best spawn point is always the top of the heap and a new score costs O(log n).
+ * Not a UObject, the game mode maps the indices to its player starts.
+ */
+class FPTEST_API FFPTestSpawnPointIndex
+{
+public:
+	/** Starts over with the spawn points, all of them get the best score until they are scored */
+	void Reset(TConstArrayView<FVector> SpawnLocations, float InScoreRange);
+
+	/** Amount of spawn points */
+	int32 Num() const { return Locations.Num(); }
+
+	/** Call before updating the characters of a tick, characters not updated until EndCharacterUpdate are removed */
+	void BeginCharacterUpdate();
+
+	/** Adds the character or moves it */
+	void UpdateCharacter(uint32 CharacterId, const FVector& Location);
+
+	/** Removes the characters which were not updated since BeginCharacterUpdate */
+	void EndCharacterUpdate();
+
+	/** Scores the next spawn points, round robin */
+	void ScoreSpawnPoints(int32 Count);
+
+	/** Spawn point with the most distance to any character, INDEX_NONE if there is none */
+	int32 GetBest() const { return Heap.Num() > 0 ? Heap[0] : INDEX_NONE; }
+
+	/** Distance to the nearest character, capped at the score range */
+	float GetScore(int32 SpawnPoint) const { return Scores[SpawnPoint]; }
+
+	/** Somebody spawned there, it is the worst spawn point until it gets scored again */
+	void MarkUsed(int32 SpawnPoint);
+
+private:
+	struct FCharacter
+	{
+		FVector Location = FVector::ZeroVector;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		uint32 Stamp = 0;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+	void RemoveFromCell(uint32 CharacterId, const FIntPoint& Cell);
+
+	/** Distance from the location to the nearest character, capped at the score range */
+	float ComputeScore(const FVector& Location) const;
+
+	/** Sets the score and restores the heap order */
+	void SetScore(int32 SpawnPoint, float Score);
+	void SiftUp(int32 HeapIndex);
+	void SiftDown(int32 HeapIndex);
+	void SwapHeap(int32 A, int32 B);
+
+	TArray<FVector> Locations;
+	TArray<float> Scores;
+
+	/** Spawn points in heap order, the best one first */
+	TArray<int32> Heap;
+
+	/** Where each spawn point is in the heap */
+	TArray<int32> HeapIndices;
+
+	/** Next spawn point to score */
+	int32 NextToScore = 0;
+
+	TMap<uint32, FCharacter> Characters;
+	TMap<FIntPoint, TArray<uint32>> Cells;
+	uint32 CurrentStamp = 0;
+
+	/** Characters further away than this do not matter, it also gives the cell size */
+	float ScoreRange = 5000.0f;
+	float CellSize = 2500.0f;
+};
@@ -0,0 +1,150 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestStats.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_STAT(STAT_FPTest_FireInternal);
+DEFINE_STAT(STAT_FPTest_ServerFireShot);
+DEFINE_STAT(STAT_FPTest_FireVisual);
+DEFINE_STAT(STAT_FPTest_ShotResolver);
+DEFINE_STAT(STAT_FPTest_ApplyShot);
+DEFINE_STAT(STAT_FPTest_LagCompensationRecord);
+DEFINE_STAT(STAT_FPTest_LagCompensationRewind);
+DEFINE_STAT(STAT_FPTest_PickUpOverlap);
+DEFINE_STAT(STAT_FPTest_PickUpUpdate);
+DEFINE_STAT(STAT_FPTest_SpawnWeapon);
+DEFINE_STAT(STAT_FPTest_Cooldowns);
+DEFINE_STAT(STAT_FPTest_ResolveDamage);
+DEFINE_STAT(STAT_FPTest_SpawnPointIndex);
+DEFINE_STAT(STAT_FPTest_ChooseSpawnPoint);
+DEFINE_STAT(STAT_FPTest_ReplayRecord);
+DEFINE_STAT(STAT_FPTest_ProjectileStep);
+DEFINE_STAT(STAT_FPTest_ProjectileSweeps);
+DEFINE_STAT(STAT_FPTest_ApplyImpulses);
+DEFINE_STAT(STAT_FPTest_Significance);
+
+DEFINE_STAT(STAT_FPTest_ShotsFired);
+DEFINE_STAT(STAT_FPTest_ShotsResolved);
+DEFINE_STAT(STAT_FPTest_Traces);
+DEFINE_STAT(STAT_FPTest_CharacterHits);
+DEFINE_STAT(STAT_FPTest_RPCsSent);
+DEFINE_STAT(STAT_FPTest_RPCsReceived);
+DEFINE_STAT(STAT_FPTest_VoicesStarted);
+DEFINE_STAT(STAT_FPTest_VoicesCulled);
+DEFINE_STAT(STAT_FPTest_DamageEvents);
+DEFINE_STAT(STAT_FPTest_DamagedCharacters);
+DEFINE_STAT(STAT_FPTest_ShotsConfirmed);
+DEFINE_STAT(STAT_FPTest_ShotsRejected);
+DEFINE_STAT(STAT_FPTest_ShotViolations);
+DEFINE_STAT(STAT_FPTest_ShotViolationsOrigin);
+DEFINE_STAT(STAT_FPTest_ShotViolationsAim);
+DEFINE_STAT(STAT_FPTest_ShotViolationsCadence);
+DEFINE_STAT(STAT_FPTest_ShotViolationsAmmo);
+DEFINE_STAT(STAT_FPTest_PickUps);
+DEFINE_STAT(STAT_FPTest_TelemetryRecords);
+DEFINE_STAT(STAT_FPTest_TelemetryDropped);
+DEFINE_STAT(STAT_FPTest_ImpulsesMerged);
+DEFINE_STAT(STAT_FPTest_BodiesTouched);
+
+DEFINE_STAT(STAT_FPTest_ActiveWeapons);
+DEFINE_STAT(STAT_FPTest_ActiveProjectiles);
+DEFINE_STAT(STAT_FPTest_SignificanceHigh);
+DEFINE_STAT(STAT_FPTest_SignificanceMedium);
+DEFINE_STAT(STAT_FPTest_SignificanceLow);
+DEFINE_STAT(STAT_FPTest_SignificanceCulled);
+
+CSV_DEFINE_CATEGORY_MODULE(FPTEST_API, FPTest, true);
+
+#if FPTEST_STATS_ENABLED
+
+namespace FPTestTimings
+{
+	struct FTimingData
+	{
+		uint64 Calls = 0;
+		uint64 TotalCycles = 0;
+		uint64 MaxCycles = 0;
+	};
+
+	static FTimingData Timings[static_cast<int32>(EFPTestTiming::Num)];
+	static uint64 StartFrame = 0;
+
+	static const TCHAR* GetName(EFPTestTiming Timing)
+	{
+		switch (Timing)
+		{
+		case EFPTestTiming::FireInternal:			return TEXT("FireInternal");
+		case EFPTestTiming::ServerFireShot:			return TEXT("ServerFireShot");
+		case EFPTestTiming::FireVisual:				return TEXT("FireVisual");
+		case EFPTestTiming::ShotResolver:			return TEXT("ShotResolver");
+		case EFPTestTiming::ApplyShot:				return TEXT("ApplyShot");
+		case EFPTestTiming::LagCompensationRecord:	return TEXT("LagCompensationRecord");
+		case EFPTestTiming::LagCompensationRewind:	return TEXT("LagCompensationRewind");
+		case EFPTestTiming::PickUpOverlap:			return TEXT("PickUpOverlap");
+		case EFPTestTiming::PickUpUpdate:			return TEXT("PickUpUpdate");
+		case EFPTestTiming::SpawnWeapon:			return TEXT("SpawnWeapon");
+		case EFPTestTiming::Cooldowns:				return TEXT("Cooldowns");
+		case EFPTestTiming::ResolveDamage:			return TEXT("ResolveDamage");
+		case EFPTestTiming::SpawnPointIndex:		return TEXT("SpawnPointIndex");
+		case EFPTestTiming::ChooseSpawnPoint:		return TEXT("ChooseSpawnPoint");
+		case EFPTestTiming::ReplayRecord:			return TEXT("ReplayRecord");
+		case EFPTestTiming::ProjectileStep:			return TEXT("ProjectileStep");
+		case EFPTestTiming::ProjectileSweeps:		return TEXT("ProjectileSweeps");
+		case EFPTestTiming::ApplyImpulses:			return TEXT("ApplyImpulses");
+		case EFPTestTiming::Significance:			return TEXT("Significance");
+		default:									return TEXT("Unknown");
+		}
+	}
+}
+
+void FFPTestTimings::Add(EFPTestTiming Timing, uint64 Cycles)
+{
+	FPTestTimings::FTimingData& Data = FPTestTimings::Timings[static_cast<int32>(Timing)];
+	Data.Calls++;
+	Data.TotalCycles += Cycles;
+	Data.MaxCycles = FMath::Max(Data.MaxCycles, Cycles);
+}
+
+void FFPTestTimings::Dump()
+{
+	using namespace FPTestTimings;
+
+	const uint64 NumFrames = FMath::Max<uint64>(GFrameCounter - StartFrame, 1);
+	UE_LOG(LogTemp, Display, TEXT("FPTest timings over %llu frames"), NumFrames);
+	UE_LOG(LogTemp, Display, TEXT("%-24s %10s %12s %10s %10s %12s"), TEXT("Scope"), TEXT("Calls"), TEXT("Total ms"), TEXT("Avg us"), TEXT("Max us"), TEXT("ms/frame"));
+
+	for (int32 Index = 0; Index < static_cast<int32>(EFPTestTiming::Num); Index++)
+	{
+		const FTimingData& Data = Timings[Index];
+		const double TotalMs = FPlatformTime::ToMilliseconds64(Data.TotalCycles);
+		const double AvgUs = Data.Calls > 0 ? TotalMs * 1000.0 / Data.Calls : 0.0;
+		const double MaxUs = FPlatformTime::ToMilliseconds64(Data.MaxCycles) * 1000.0;
+		UE_LOG(LogTemp, Display, TEXT("%-24s %10llu %12.3f %10.2f %10.2f %12.4f"),
+			GetName(static_cast<EFPTestTiming>(Index)), Data.Calls, TotalMs, AvgUs, MaxUs, TotalMs / NumFrames);
+	}
+}
+
+void FFPTestTimings::Reset()
+{
+	using namespace FPTestTimings;
+
+	for (FTimingData& Data : Timings)
+	{
+		Data = FTimingData();
+	}
+	StartFrame = GFrameCounter;
+}
+
+static FAutoConsoleCommand CmdFPTestDumpTimings(
+	TEXT("FPTest.DumpTimings"),
+	TEXT("Logs the timings of the weapon pipeline since the last reset. Pass reset to start over afterwards."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FFPTestTimings::Dump();
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			FFPTestTimings::Reset();
+		}
+	}));
+
+#endif
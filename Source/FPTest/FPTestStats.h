@@ -0,0 +1,166 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "FPTestCounters.h"
+
+/**
+ * Stats, csv categories and insights scopes of the weapon pipeline
+ * Use FPTEST_SCOPE(Name) for timings and FPTEST_COUNT(Name, Amount) for counters, e.g.
+ *   FPTEST_SCOPE(FireInternal);
+ *   FPTEST_COUNT(ShotsFired, 1);
+ * Every name needs a STAT_FPTest_<Name> below, timings also an entry in EFPTestTiming and counters in EFPTestCounter.
+ * Everything compiles out in shipping, except the running totals of the counters in FFPTestCounters.
+ *
+ * In game: stat FPTest, csvprofile start, or -trace=cpu for insights
+ * On a headless server: FPTest.DumpTimings
+ */
+
+#define FPTEST_STATS_ENABLED !UE_BUILD_SHIPPING
+
+DECLARE_STATS_GROUP(TEXT("FPTest"), STATGROUP_FPTest, STATCAT_Advanced);
+
+// Timings
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire Internal"), STAT_FPTest_FireInternal, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Server Fire Shot"), STAT_FPTest_ServerFireShot, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire Visual"), STAT_FPTest_FireVisual, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Shot Resolver"), STAT_FPTest_ShotResolver, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Shot"), STAT_FPTest_ApplyShot, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lag Compensation Record"), STAT_FPTest_LagCompensationRecord, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lag Compensation Rewind"), STAT_FPTest_LagCompensationRewind, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pick Up Overlap"), STAT_FPTest_PickUpOverlap, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pick Up Update"), STAT_FPTest_PickUpUpdate, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn Weapon"), STAT_FPTest_SpawnWeapon, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Cooldowns"), STAT_FPTest_Cooldowns, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Resolve Damage"), STAT_FPTest_ResolveDamage, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn Point Index"), STAT_FPTest_SpawnPointIndex, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Choose Spawn Point"), STAT_FPTest_ChooseSpawnPoint, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Replay Record"), STAT_FPTest_ReplayRecord, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Step"), STAT_FPTest_ProjectileStep, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Sweeps"), STAT_FPTest_ProjectileSweeps, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Impulses"), STAT_FPTest_ApplyImpulses, STATGROUP_FPTest, FPTEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Significance"), STAT_FPTest_Significance, STATGROUP_FPTest, FPTEST_API);
+
+// Per frame counters
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Fired"), STAT_FPTest_ShotsFired, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Resolved"), STAT_FPTest_ShotsResolved, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_FPTest_Traces, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Character Hits"), STAT_FPTest_CharacterHits, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("RPCs Sent"), STAT_FPTest_RPCsSent, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("RPCs Received"), STAT_FPTest_RPCsReceived, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Voices Started"), STAT_FPTest_VoicesStarted, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Voices Culled"), STAT_FPTest_VoicesCulled, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage Events"), STAT_FPTest_DamageEvents, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damaged Characters"), STAT_FPTest_DamagedCharacters, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Confirmed"), STAT_FPTest_ShotsConfirmed, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Rejected"), STAT_FPTest_ShotsRejected, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shot Violations"), STAT_FPTest_ShotViolations, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shot Violations Origin"), STAT_FPTest_ShotViolationsOrigin, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shot Violations Aim"), STAT_FPTest_ShotViolationsAim, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shot Violations Cadence"), STAT_FPTest_ShotViolationsCadence, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shot Violations Ammo"), STAT_FPTest_ShotViolationsAmmo, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pick Ups"), STAT_FPTest_PickUps, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Telemetry Records"), STAT_FPTest_TelemetryRecords, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Telemetry Dropped"), STAT_FPTest_TelemetryDropped, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impulses Merged"), STAT_FPTest_ImpulsesMerged, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bodies Touched"), STAT_FPTest_BodiesTouched, STATGROUP_FPTest, FPTEST_API);
+
+// Running values
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Weapons"), STAT_FPTest_ActiveWeapons, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Projectiles"), STAT_FPTest_ActiveProjectiles, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance High"), STAT_FPTest_SignificanceHigh, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance Medium"), STAT_FPTest_SignificanceMedium, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance Low"), STAT_FPTest_SignificanceLow, STATGROUP_FPTest, FPTEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance Culled"), STAT_FPTest_SignificanceCulled, STATGROUP_FPTest, FPTEST_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(FPTEST_API, FPTest);
+
+/** Everything timed by FPTEST_SCOPE, also used as index into the timings */
+enum class EFPTestTiming : uint8
+{
+	FireInternal,
+	ServerFireShot,
+	FireVisual,
+	ShotResolver,
+	ApplyShot,
+	LagCompensationRecord,
+	LagCompensationRewind,
+	PickUpOverlap,
+	PickUpUpdate,
+	SpawnWeapon,
+	Cooldowns,
+	ResolveDamage,
+	SpawnPointIndex,
+	ChooseSpawnPoint,
+	ReplayRecord,
+	ProjectileStep,
+	ProjectileSweeps,
+	ApplyImpulses,
+	Significance,
+	Num
+};
+
+#if FPTEST_STATS_ENABLED
+
+/**
+ * Own accumulation of the FPTEST_SCOPE timings
+ * The stats system is often not running on a server, these are always collected so they can be dumped from the console
+ * Only used on the game thread
+ */
+struct FPTEST_API FFPTestTimings
+{
+	/** Adds one call of the scope */
+	static void Add(EFPTestTiming Timing, uint64 Cycles);
+
+	/** Logs calls, time per call and time per frame of every scope since the last reset */
+	static void Dump();
+
+	/** Starts over */
+	static void Reset();
+
+	/** Measures its lifetime */
+	struct FScope
+	{
+		explicit FScope(EFPTestTiming InTiming)
+			: Timing(InTiming)
+			, StartCycles(FPlatformTime::Cycles64())
+		{
+		}
+
+		~FScope()
+		{
+			Add(Timing, FPlatformTime::Cycles64() - StartCycles);
+		}
+
+	private:
+		EFPTestTiming Timing;
+		uint64 StartCycles;
+	};
+};
+
+#define FPTEST_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_FPTest_##Name); \
+	CSV_SCOPED_TIMING_STAT(FPTest, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPTest_##Name); \
+	FFPTestTimings::FScope FPTestTimingScope_##Name(EFPTestTiming::Name)
+
+#define FPTEST_COUNT(Name, Amount) \
+	FFPTestCounters::Add(EFPTestCounter::Name, Amount); \
+	INC_DWORD_STAT_BY(STAT_FPTest_##Name, Amount); \
+	CSV_CUSTOM_STAT(FPTest, Name, static_cast<int32>(Amount), ECsvCustomStatOp::Accumulate)
+
+#define FPTEST_SET_VALUE(Name, Value) \
+	SET_DWORD_STAT(STAT_FPTest_##Name, Value); \
+	CSV_CUSTOM_STAT(FPTest, Name, static_cast<int32>(Value), ECsvCustomStatOp::Set)
+
+#else
+
+#define FPTEST_SCOPE(Name)
+#define FPTEST_COUNT(Name, Amount) FFPTestCounters::Add(EFPTestCounter::Name, Amount)
+#define FPTEST_SET_VALUE(Name, Value)
+
+#endif
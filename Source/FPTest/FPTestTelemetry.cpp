@@ -0,0 +1,480 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestTelemetry.h"
+#include "FPTestStats.h"
+#include "Containers/LockFreeList.h"
+#include "Containers/Queue.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DelayedAutoRegister.h"
+#include "Misc/Paths.h"
+
+static int32 GFPTestTelemetryMaxFileMB = 64;
+static FAutoConsoleVariableRef CVarFPTestTelemetryMaxFileMB(
+	TEXT("FPTest.Telemetry.MaxFileMB"),
+	GFPTestTelemetryMaxFileMB,
+	TEXT("Size at which the telemetry continues in a new file."));
+
+static int32 GFPTestTelemetryBlocks = 32;
+static FAutoConsoleVariableRef CVarFPTestTelemetryBlocks(
+	TEXT("FPTest.Telemetry.Blocks"),
+	GFPTestTelemetryBlocks,
+	TEXT("Blocks of 1024 records shared by the recording threads and the writer, records get dropped if all are waiting for the disk. Used by the next FPTest.Telemetry.Start."));
+
+static float GFPTestTelemetryFlushSeconds = 1.0f;
+static FAutoConsoleVariableRef CVarFPTestTelemetryFlushSeconds(
+	TEXT("FPTest.Telemetry.FlushSeconds"),
+	GFPTestTelemetryFlushSeconds,
+	TEXT("How often the game thread hands its partly filled block to the writer."));
+
+std::atomic<bool> FFPTestTelemetry::bRecording(false);
+
+void FFPTestTelemetryRecord::SetDirection(const FVector& Direction)
+{
+	const FRotator Rotation = Direction.Rotation();
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+}
+
+FVector FFPTestTelemetryRecord::GetDirection() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f).Vector();
+}
+
+namespace FPTestTelemetry
+{
+	static constexpr int32 RecordsPerBlock = 1024;
+
+	struct FBlock
+	{
+		int32 NumRecords = 0;
+		FFPTestTelemetryRecord Records[RecordsPerBlock];
+	};
+
+	/** Owns the blocks and the file, all disk access happens on its thread */
+	class FWriter : public FRunnable
+	{
+	public:
+		FWriter(const FString& InBasePath, int32 NumBlocks)
+			: BasePath(InBasePath)
+		{
+			Blocks.Reserve(NumBlocks);
+			for (int32 Index = 0; Index < NumBlocks; Index++)
+			{
+				FreeBlocks.Push(Blocks.Add_GetRef(MakeUnique<FBlock>()).Get());
+			}
+			WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+		}
+
+		virtual ~FWriter()
+		{
+			delete Thread;
+			FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		}
+
+		bool StartThread()
+		{
+			Thread = FRunnableThread::Create(this, TEXT("FPTestTelemetryWriter"), 0, TPri_BelowNormal);
+			return Thread != nullptr;
+		}
+
+		/** Writes everything submitted so far and ends the thread */
+		void StopAndWait()
+		{
+			bStopping = true;
+			WorkEvent->Trigger();
+			Thread->WaitForCompletion();
+		}
+
+		/** Empty block to fill, nullptr if all are in flight */
+		FBlock* AcquireBlock()
+		{
+			return FreeBlocks.Pop();
+		}
+
+		/** Hands a filled block to the writer thread, it comes back through AcquireBlock once written */
+		void Submit(FBlock* Block)
+		{
+			FullBlocks.Enqueue(Block);
+			WorkEvent->Trigger();
+		}
+
+		virtual uint32 Run() override
+		{
+			for (;;)
+			{
+				// Checked before draining, so a block submitted right before stopping is still written
+				const bool bLastRound = bStopping;
+
+				FBlock* Block = nullptr;
+				bool bWroteAny = false;
+				while (FullBlocks.Dequeue(Block))
+				{
+					WriteBlock(*Block);
+					Block->NumRecords = 0;
+					FreeBlocks.Push(Block);
+					bWroteAny = true;
+				}
+
+				if (bWroteAny && File)
+				{
+					File->Flush();
+				}
+
+				if (bLastRound)
+				{
+					break;
+				}
+				WorkEvent->Wait(100);
+			}
+
+			File.Reset();
+			return 0;
+		}
+
+	private:
+		void WriteBlock(const FBlock& Block)
+		{
+			const int64 NumBytes = Block.NumRecords * sizeof(FFPTestTelemetryRecord);
+			if (NumBytes == 0)
+			{
+				return;
+			}
+
+			const int64 MaxFileBytes = FMath::Max<int64>(GFPTestTelemetryMaxFileMB, 1) * 1024 * 1024;
+			if (!File || FileBytes + NumBytes > MaxFileBytes)
+			{
+				OpenNextFile();
+			}
+
+			if (File)
+			{
+				File->Serialize(const_cast<FFPTestTelemetryRecord*>(Block.Records), NumBytes);
+				FileBytes += NumBytes;
+			}
+		}
+
+		void OpenNextFile()
+		{
+			File.Reset();
+			FileBytes = 0;
+
+			const FString Path = FString::Printf(TEXT("%s-%03d.fptl"), *BasePath, FileIndex++);
+			File.Reset(IFileManager::Get().CreateFileWriter(*Path));
+			if (!File)
+			{
+				UE_LOG(LogTemp, Error, TEXT("Telemetry: could not open %s, records are dropped"), *Path);
+				return;
+			}
+
+			FFPTestTelemetryFileHeader Header;
+			Header.Magic = FFPTestTelemetry::FileMagic;
+			Header.Version = FFPTestTelemetry::FileVersion;
+			Header.RecordSize = sizeof(FFPTestTelemetryRecord);
+			File->Serialize(&Header, sizeof(Header));
+			FileBytes += sizeof(Header);
+
+			UE_LOG(LogTemp, Display, TEXT("Telemetry: writing %s"), *Path);
+		}
+
+		TArray<TUniquePtr<FBlock>> Blocks;
+		TLockFreePointerListUnordered<FBlock, PLATFORM_CACHE_LINE_SIZE> FreeBlocks;
+		TQueue<FBlock*, EQueueMode::Mpsc> FullBlocks;
+
+		FEvent* WorkEvent = nullptr;
+		FRunnableThread* Thread = nullptr;
+		std::atomic<bool> bStopping = false;
+
+		FString BasePath;
+		TUniquePtr<FArchive> File;
+		int32 FileIndex = 0;
+		int64 FileBytes = 0;
+	};
+
+	/** Only changed on the game thread, read by every recording thread through FWriterScope */
+	static std::atomic<FWriter*> Writer = nullptr;
+	static std::atomic<uint32> Session = 0;
+
+	/** Threads inside a FWriterScope, Stop waits for them before deleting the writer */
+	static std::atomic<int32> NumWriterUsers = 0;
+
+	/** Keeps the current writer and its blocks alive while the calling thread uses them */
+	struct FWriterScope
+	{
+		FWriterScope()
+		{
+			// Counted before loading, so Stop either sees us or we see the writer it cleared
+			NumWriterUsers.fetch_add(1);
+			Current = Writer.load();
+		}
+
+		~FWriterScope()
+		{
+			NumWriterUsers.fetch_sub(1, std::memory_order_release);
+		}
+
+		FWriter* Current = nullptr;
+	};
+	static FDelegateHandle EndFrameHandle;
+	static double LastFlushTime = 0.0;
+
+	/** Block the thread fills, it belongs to the writer of the session it got acquired in */
+	struct FThreadBlock
+	{
+		FBlock* Block = nullptr;
+		uint32 Session = 0;
+	};
+	static thread_local FThreadBlock ThreadBlock;
+
+	static void OnEndFrame()
+	{
+		// Otherwise a quiet game thread would keep its records until the block is full
+		const double Now = FPlatformTime::Seconds();
+		if (Now - LastFlushTime >= GFPTestTelemetryFlushSeconds)
+		{
+			LastFlushTime = Now;
+			FFPTestTelemetry::FlushThisThread();
+		}
+	}
+
+	static const TCHAR* GetTypeName(EFPTestTelemetryType Type)
+	{
+		switch (Type)
+		{
+		case EFPTestTelemetryType::Shot:	return TEXT("Shot");
+		case EFPTestTelemetryType::Hit:		return TEXT("Hit");
+		case EFPTestTelemetryType::Damage:	return TEXT("Damage");
+		case EFPTestTelemetryType::Kill:	return TEXT("Kill");
+		default:							return TEXT("Unknown");
+		}
+	}
+}
+
+bool FFPTestTelemetry::Start(const FString& Directory)
+{
+	using namespace FPTestTelemetry;
+	check(IsInGameThread());
+
+	if (Writer.load())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Telemetry: already recording"));
+		return true;
+	}
+
+	const FString OutputDirectory = Directory.IsEmpty() ? FPaths::ProjectSavedDir() / TEXT("Telemetry") : Directory;
+	IFileManager::Get().MakeDirectory(*OutputDirectory, true);
+
+	FWriter* NewWriter = new FWriter(OutputDirectory / FString::Printf(TEXT("Telemetry-%s"), *FDateTime::Now().ToString()), FMath::Max(GFPTestTelemetryBlocks, 2));
+	if (!NewWriter->StartThread())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Telemetry: could not start the writer thread"));
+		delete NewWriter;
+		return false;
+	}
+
+	// The session first, a thread seeing the new writer must not keep a block of the old one
+	Session.fetch_add(1);
+	Writer.store(NewWriter);
+	LastFlushTime = FPlatformTime::Seconds();
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&OnEndFrame);
+	bRecording = true;
+	return true;
+}
+
+void FFPTestTelemetry::Stop()
+{
+	using namespace FPTestTelemetry;
+	check(IsInGameThread());
+
+	if (!Writer.load())
+	{
+		return;
+	}
+
+	FlushThisThread();
+	bRecording = false;
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	// New scopes see no writer from here on, the ones still open may be filling or submitting one of its blocks
+	FWriter* const OldWriter = Writer.exchange(nullptr);
+	while (NumWriterUsers.load(std::memory_order_acquire) > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+
+	// The only time we wait for the disk, the rest of the records gets written
+	OldWriter->StopAndWait();
+	delete OldWriter;
+
+	UE_LOG(LogTemp, Display, TEXT("Telemetry: stopped"));
+}
+
+void FFPTestTelemetry::Record(const FFPTestTelemetryRecord& Record)
+{
+	using namespace FPTestTelemetry;
+
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	const FWriterScope Scope;
+	FWriter* const CurrentWriter = Scope.Current;
+	if (!CurrentWriter)
+	{
+		return;
+	}
+
+	// A block from an earlier session got freed with its writer
+	FThreadBlock& Local = ThreadBlock;
+	const uint32 CurrentSession = Session.load();
+	if (Local.Session != CurrentSession)
+	{
+		Local.Block = nullptr;
+		Local.Session = CurrentSession;
+	}
+
+	if (!Local.Block)
+	{
+		Local.Block = CurrentWriter->AcquireBlock();
+		if (!Local.Block)
+		{
+			FPTEST_COUNT(TelemetryDropped, 1);
+			return;
+		}
+	}
+
+	Local.Block->Records[Local.Block->NumRecords++] = Record;
+	FPTEST_COUNT(TelemetryRecords, 1);
+
+	if (Local.Block->NumRecords == RecordsPerBlock)
+	{
+		CurrentWriter->Submit(Local.Block);
+		Local.Block = nullptr;
+	}
+}
+
+void FFPTestTelemetry::FlushThisThread()
+{
+	using namespace FPTestTelemetry;
+
+	const FWriterScope Scope;
+	FThreadBlock& Local = ThreadBlock;
+	if (!Scope.Current || Local.Session != Session.load() || !Local.Block || Local.Block->NumRecords == 0)
+	{
+		return;
+	}
+
+	Scope.Current->Submit(Local.Block);
+	Local.Block = nullptr;
+}
+
+int64 FFPTestTelemetry::ConvertToCsv(const FString& Input, const FString& Output)
+{
+	using namespace FPTestTelemetry;
+	IFileManager& FileManager = IFileManager::Get();
+
+	TArray<FString> Files;
+	if (FileManager.DirectoryExists(*Input))
+	{
+		FileManager.FindFiles(Files, *(Input / TEXT("*.fptl")), true, false);
+		Files.Sort();
+		for (FString& File : Files)
+		{
+			File = Input / File;
+		}
+	}
+	else
+	{
+		Files.Add(Input);
+	}
+
+	TUniquePtr<FArchive> Csv(FileManager.CreateFileWriter(*Output));
+	if (!Csv)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Telemetry: could not open %s"), *Output);
+		return -1;
+	}
+
+	const auto WriteText = [&Csv](const FString& Text)
+	{
+		const FTCHARToUTF8 Utf8(*Text);
+		Csv->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+	};
+
+	WriteText(TEXT("Type,Time,Shooter,Target,ShootType,Sequence,X,Y,Z,DirX,DirY,DirZ,Damage,LatencyMs\n"));
+
+	int64 NumConverted = 0;
+	TArray<FFPTestTelemetryRecord> Records;
+	Records.SetNumUninitialized(RecordsPerBlock);
+	FString Lines;
+
+	for (const FString& File : Files)
+	{
+		TUniquePtr<FArchive> Reader(FileManager.CreateFileReader(*File));
+		if (!Reader)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Telemetry: could not open %s"), *File);
+			continue;
+		}
+
+		FFPTestTelemetryFileHeader Header;
+		Reader->Serialize(&Header, sizeof(Header));
+		if (Reader->IsError() || Header.Magic != FileMagic || Header.Version != FileVersion || Header.RecordSize != sizeof(FFPTestTelemetryRecord))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Telemetry: %s is no telemetry file of version %u"), *File, FileVersion);
+			continue;
+		}
+
+		// A record cut off at the end, e.g. after a crash, is left out
+		int64 NumLeft = (Reader->TotalSize() - Reader->Tell()) / sizeof(FFPTestTelemetryRecord);
+		while (NumLeft > 0)
+		{
+			const int32 NumRecords = static_cast<int32>(FMath::Min<int64>(NumLeft, RecordsPerBlock));
+			Reader->Serialize(Records.GetData(), NumRecords * sizeof(FFPTestTelemetryRecord));
+			NumLeft -= NumRecords;
+
+			Lines.Reset();
+			for (int32 Index = 0; Index < NumRecords; Index++)
+			{
+				const FFPTestTelemetryRecord& Record = Records[Index];
+				const FVector Direction = Record.GetDirection();
+				Lines += FString::Printf(TEXT("%s,%.3f,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.4f,%.4f,%.4f,%u,%u\n"),
+					GetTypeName(Record.Type), Record.Time, Record.ShooterId, Record.TargetId, Record.ShootType, Record.Sequence,
+					Record.Location.X, Record.Location.Y, Record.Location.Z, Direction.X, Direction.Y, Direction.Z, Record.Damage, Record.LatencyMs);
+			}
+			WriteText(Lines);
+			NumConverted += NumRecords;
+		}
+	}
+
+	return NumConverted;
+}
+
+static FAutoConsoleCommand CmdFPTestTelemetryStart(
+	TEXT("FPTest.Telemetry.Start"),
+	TEXT("Starts writing shot, hit and damage records. Argument: [Directory], Saved/Telemetry if not given."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FFPTestTelemetry::Start(Args.Num() > 0 ? Args[0] : FString());
+	}));
+
+static FAutoConsoleCommand CmdFPTestTelemetryStop(
+	TEXT("FPTest.Telemetry.Stop"),
+	TEXT("Stops writing telemetry and closes the file."),
+	FConsoleCommandDelegate::CreateStatic(&FFPTestTelemetry::Stop));
+
+static FDelayedAutoRegisterHelper RegisterFPTestTelemetry(EDelayedRegisterRunPhase::EndOfEngineInit, []()
+{
+	FCoreDelegates::OnEnginePreExit.AddStatic(&FFPTestTelemetry::Stop);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("FPTestTelemetry")))
+	{
+		FFPTestTelemetry::Start();
+	}
+});
@@ -0,0 +1,100 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/** What a telemetry record describes */
+enum class EFPTestTelemetryType : uint8
+{
+	/** The server accepted a shot, Location and direction are the shot, latency is from firing to receiving */
+	Shot,
+	/** A resolved shot hit something, Location is the impact, latency is from firing to resolving */
+	Hit,
+	/** Damage got applied to a character, once per character and frame */
+	Damage,
+	/** Like Damage, but the character died */
+	Kill
+};
+
+/**
+ * One fixed size record of the telemetry files
+ * Written as is, so the layout must only change together with FFPTestTelemetry::FileVersion.
+ * Actors are identified by their unique id, the same as in the damage log
+ */
+struct FFPTestTelemetryRecord
+{
+	/** Server time */
+	double Time = 0.0;
+
+	uint32 ShooterId = 0;
+
+	/** What got hit or damaged, 0 for shots */
+	uint32 TargetId = 0;
+
+	FVector3f Location = FVector3f::ZeroVector;
+
+	/** Direction of the shot as compressed pitch and yaw */
+	uint16 Pitch = 0;
+	uint16 Yaw = 0;
+
+	uint16 Damage = 0;
+	uint16 LatencyMs = 0;
+
+	/** Sequence of the shot, 0 for damage */
+	uint16 Sequence = 0;
+
+	EFPTestTelemetryType Type = EFPTestTelemetryType::Shot;
+	uint8 ShootType = 0;
+
+	void SetDirection(const FVector& Direction);
+	FVector GetDirection() const;
+};
+static_assert(sizeof(FFPTestTelemetryRecord) == 40, "Telemetry records are written as is, change the file version when changing them");
+
+/** Start of every telemetry file */
+struct FFPTestTelemetryFileHeader
+{
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	uint16 RecordSize = 0;
+};
+
+/**
+ * Stream of shot, hit and damage records into binary files
+ * Every recording thread fills its own block of records without any locks. Full blocks go through a lock free queue
+ * to a writer thread, which appends them to the file and hands the block back. The game thread never waits for the disk,
+ * if all blocks are in flight records get dropped and counted. Files rotate at FPTest.Telemetry.MaxFileMB.
+ *
+ * FPTest.Telemetry.Start [Directory], FPTest.Telemetry.Stop, or -FPTestTelemetry to record from the start.
+ * Convert the files with the FPTestTelemetry commandlet.
+ * Start and Stop only on the game thread. Records of other threads that are not flushed when it stops get dropped.
+ */
+class FPTEST_API FFPTestTelemetry
+{
+public:
+	static constexpr uint32 FileMagic = 0x4C545046; // FPTL
+	static constexpr uint16 FileVersion = 1;
+
+	/** Starts writing into a new file in the directory, the saved directory if empty */
+	static bool Start(const FString& Directory = FString());
+
+	/** Writes what is left and closes the file */
+	static void Stop();
+
+	/** Check this before building a record */
+	static bool IsRecording() { return bRecording.load(std::memory_order_relaxed); }
+
+	/** Appends the record to the block of the calling thread */
+	static void Record(const FFPTestTelemetryRecord& Record);
+
+	/** Hands a partly filled block of the calling thread to the writer */
+	static void FlushThisThread();
+
+	/** Converts telemetry files to one csv, Input is a file or a directory with .fptl files. Returns the records converted or -1 */
+	static int64 ConvertToCsv(const FString& Input, const FString& Output);
+
+private:
+	static std::atomic<bool> bRecording;
+};
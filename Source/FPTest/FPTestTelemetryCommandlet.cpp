@@ -0,0 +1,39 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestTelemetryCommandlet.h"
+#include "FPTestTelemetry.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+UFPTestTelemetryCommandlet::UFPTestTelemetryCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UFPTestTelemetryCommandlet::Main(const FString& Params)
+{
+	FString Input;
+	if (!FParse::Value(*Params, TEXT("In="), Input))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Telemetry: usage -run=FPTestTelemetry -In=<file or directory> [-Out=<csv>]"));
+		return 1;
+	}
+
+	FString Output;
+	if (!FParse::Value(*Params, TEXT("Out="), Output))
+	{
+		Output = IFileManager::Get().DirectoryExists(*Input) ? Input / TEXT("Telemetry.csv") : FPaths::ChangeExtension(Input, TEXT("csv"));
+	}
+
+	const int64 NumRecords = FFPTestTelemetry::ConvertToCsv(Input, Output);
+	if (NumRecords < 0)
+	{
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Telemetry: %lld records written to %s"), NumRecords, *Output);
+	return 0;
+}
@@ -0,0 +1,23 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FPTestTelemetryCommandlet.generated.h"
+
+/**
+ * Converts telemetry files to csv, without starting a game
+ * UnrealEditor-Cmd FPTest.uproject -run=FPTestTelemetry -In=<file or directory> [-Out=<csv>]
+ * All .fptl files of a directory end up in one csv, in the order of their names
+ */
+UCLASS()
+class FPTEST_API UFPTestTelemetryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UFPTestTelemetryCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,263 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestWeaponAudioSubsystem.h"
+#include "FPTestStats.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Sound/SoundBase.h"
+
+static int32 GFPTestWeaponVoicesPerWeapon = 4;
+static FAutoConsoleVariableRef CVarFPTestWeaponVoicesPerWeapon(
+	TEXT("FPTest.WeaponAudio.VoicesPerWeapon"),
+	GFPTestWeaponVoicesPerWeapon,
+	TEXT("Audio components per weapon, a new sound takes over the oldest one if all are playing."));
+
+static int32 GFPTestWeaponMaxVoicesPerSound = 8;
+static FAutoConsoleVariableRef CVarFPTestWeaponMaxVoicesPerSound(
+	TEXT("FPTest.WeaponAudio.MaxVoicesPerSound"),
+	GFPTestWeaponMaxVoicesPerSound,
+	TEXT("How often the same weapon sound can play at once over all weapons, 0 for no limit."));
+
+static float GFPTestWeaponMaxDistance = 5000.0f;
+static FAutoConsoleVariableRef CVarFPTestWeaponMaxDistance(
+	TEXT("FPTest.WeaponAudio.MaxDistance"),
+	GFPTestWeaponMaxDistance,
+	TEXT("Weapon sounds further away from every listener are not played. The attenuation of the sound is used if it is shorter."));
+
+namespace FPTestWeaponAudio
+{
+	// Looping sounds report a huge duration, they would block the budget forever
+	static constexpr float MaxVoiceDuration = 10.0f;
+}
+
+bool UFPTestWeaponAudioSubsystem::PlayWeaponSound(const UObject* Weapon, USoundBase* Sound, const FVector& Location)
+{
+	UWorld* const World = GetWorld();
+	AActor* const WeaponActor = Weapon ? Weapon->GetTypedOuter<AActor>() : nullptr;
+	if (!World || !Sound || !WeaponActor)
+	{
+		return false;
+	}
+
+	if (!IsAudible(*Sound, Location))
+	{
+		NumCulledByDistance++;
+		FPTEST_COUNT(VoicesCulled, 1);
+		return false;
+	}
+
+	const double Now = World->GetAudioTimeSeconds();
+	if (GFPTestWeaponMaxVoicesPerSound > 0 && CountActiveVoices(*Sound, Now) >= GFPTestWeaponMaxVoicesPerSound)
+	{
+		NumCulledByBudget++;
+		FPTEST_COUNT(VoicesCulled, 1);
+		return false;
+	}
+
+	FFPTestWeaponVoice& Voice = AcquireVoice(*WeaponActor, Pools.FindOrAdd(TObjectKey<UObject>(Weapon)), Now);
+
+	UAudioComponent* AudioComponent = Voice.AudioComponent.Get();
+	AudioComponent->SetWorldLocation(Location);
+	if (AudioComponent->Sound != Sound)
+	{
+		AudioComponent->SetSound(Sound);
+	}
+	AudioComponent->Play();
+
+	Voice.Sound = Sound;
+	Voice.EndTime = Now + FMath::Min(Sound->GetDuration(), FPTestWeaponAudio::MaxVoiceDuration);
+	ActiveVoices.FindOrAdd(TObjectKey<USoundBase>(Sound)).Add(Voice.EndTime);
+
+	NumStarted++;
+	FPTEST_COUNT(VoicesStarted, 1);
+	return true;
+}
+
+void UFPTestWeaponAudioSubsystem::StopWeaponSound(const UObject* Weapon, USoundBase* Sound)
+{
+	UWorld* const World = GetWorld();
+	FFPTestWeaponVoicePool* Pool = Pools.Find(TObjectKey<UObject>(Weapon));
+	if (!World || !Sound || !Pool)
+	{
+		return;
+	}
+
+	const double Now = World->GetAudioTimeSeconds();
+	const TObjectKey<USoundBase> SoundKey(Sound);
+
+	FFPTestWeaponVoice* Newest = nullptr;
+	for (FFPTestWeaponVoice& Voice : Pool->Voices)
+	{
+		if (Voice.Sound == SoundKey && Voice.EndTime > Now && Voice.AudioComponent.IsValid() && (!Newest || Voice.EndTime > Newest->EndTime))
+		{
+			Newest = &Voice;
+		}
+	}
+
+	if (!Newest)
+	{
+		return;
+	}
+
+	// Gives its place in the budget back right away
+	if (TArray<double>* EndTimes = ActiveVoices.Find(SoundKey))
+	{
+		EndTimes->RemoveSingleSwap(Newest->EndTime, false);
+	}
+	Newest->AudioComponent->Stop();
+	Newest->EndTime = Now;
+}
+
+void UFPTestWeaponAudioSubsystem::ReleaseWeapon(const UObject* Weapon)
+{
+	FFPTestWeaponVoicePool Pool;
+	if (!Pools.RemoveAndCopyValue(TObjectKey<UObject>(Weapon), Pool))
+	{
+		return;
+	}
+
+	for (const FFPTestWeaponVoice& Voice : Pool.Voices)
+	{
+		if (UAudioComponent* AudioComponent = Voice.AudioComponent.Get())
+		{
+			AudioComponent->Stop();
+			AudioComponent->DestroyComponent();
+		}
+	}
+}
+
+void UFPTestWeaponAudioSubsystem::Play(const UObject* Weapon, USoundBase* Sound, const FVector& Location)
+{
+	UWorld* const World = Weapon ? Weapon->GetWorld() : nullptr;
+	if (UFPTestWeaponAudioSubsystem* WeaponAudio = World ? World->GetSubsystem<UFPTestWeaponAudioSubsystem>() : nullptr)
+	{
+		WeaponAudio->PlayWeaponSound(Weapon, Sound, Location);
+	}
+}
+
+void UFPTestWeaponAudioSubsystem::Stop(const UObject* Weapon, USoundBase* Sound)
+{
+	UWorld* const World = Weapon ? Weapon->GetWorld() : nullptr;
+	if (UFPTestWeaponAudioSubsystem* WeaponAudio = World ? World->GetSubsystem<UFPTestWeaponAudioSubsystem>() : nullptr)
+	{
+		WeaponAudio->StopWeaponSound(Weapon, Sound);
+	}
+}
+
+void UFPTestWeaponAudioSubsystem::LogStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("WeaponAudio: %d started, %d culled by distance, %d culled by budget, %d stolen, %d weapons"),
+		NumStarted, NumCulledByDistance, NumCulledByBudget, NumStolen, Pools.Num());
+}
+
+bool UFPTestWeaponAudioSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Nobody listens on a dedicated server
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UFPTestWeaponAudioSubsystem::Deinitialize()
+{
+	Pools.Reset();
+	ActiveVoices.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UFPTestWeaponAudioSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UFPTestWeaponAudioSubsystem::IsAudible(const USoundBase& Sound, const FVector& Location) const
+{
+	const float MaxDistance = FMath::Min(GFPTestWeaponMaxDistance, Sound.GetMaxDistance());
+	const float MaxDistanceSquared = FMath::Square(MaxDistance);
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController || !PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector ListenerLocation, ListenerFront, ListenerRight;
+		PlayerController->GetAudioListenerPosition(ListenerLocation, ListenerFront, ListenerRight);
+		if (FVector::DistSquared(ListenerLocation, Location) <= MaxDistanceSquared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int32 UFPTestWeaponAudioSubsystem::CountActiveVoices(const USoundBase& Sound, double Now)
+{
+	TArray<double>* EndTimes = ActiveVoices.Find(TObjectKey<USoundBase>(&Sound));
+	if (!EndTimes)
+	{
+		return 0;
+	}
+
+	EndTimes->RemoveAllSwap([Now](double EndTime) { return EndTime <= Now; }, false);
+	return EndTimes->Num();
+}
+
+FFPTestWeaponVoice& UFPTestWeaponAudioSubsystem::AcquireVoice(AActor& WeaponActor, FFPTestWeaponVoicePool& Pool, double Now)
+{
+	// The components go away with the weapon actor, e.g. when the level unloads
+	Pool.Voices.RemoveAllSwap([](const FFPTestWeaponVoice& Voice) { return !Voice.AudioComponent.IsValid(); }, false);
+
+	// A voice which finished can be reused right away
+	FFPTestWeaponVoice* Best = nullptr;
+	for (FFPTestWeaponVoice& Voice : Pool.Voices)
+	{
+		if (Voice.EndTime <= Now)
+		{
+			return Voice;
+		}
+
+		if (!Best || Voice.EndTime < Best->EndTime)
+		{
+			Best = &Voice;
+		}
+	}
+
+	if (Best && Pool.Voices.Num() >= FMath::Max(GFPTestWeaponVoicesPerWeapon, 1))
+	{
+		// All voices are busy, the one closest to finishing gets cut off
+		NumStolen++;
+		if (TArray<double>* EndTimes = ActiveVoices.Find(Best->Sound))
+		{
+			EndTimes->RemoveSingleSwap(Best->EndTime, false);
+		}
+		Best->AudioComponent->Stop();
+		return *Best;
+	}
+
+	// Components are never auto destroyed, they live as long as the weapon
+	UAudioComponent* AudioComponent = NewObject<UAudioComponent>(&WeaponActor);
+	AudioComponent->bAutoActivate = false;
+	AudioComponent->bAutoDestroy = false;
+	AudioComponent->bIsUISound = false;
+	AudioComponent->RegisterComponent();
+
+	FFPTestWeaponVoice& Voice = Pool.Voices.AddDefaulted_GetRef();
+	Voice.AudioComponent = AudioComponent;
+	return Voice;
+}
+
+static FAutoConsoleCommandWithWorld CmdFPTestWeaponAudioStats(
+	TEXT("FPTest.WeaponAudio.Stats"),
+	TEXT("Logs how many weapon sounds got started, culled and stolen."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UFPTestWeaponAudioSubsystem* WeaponAudio = World ? World->GetSubsystem<UFPTestWeaponAudioSubsystem>() : nullptr)
+		{
+			WeaponAudio->LogStats();
+		}
+	}));
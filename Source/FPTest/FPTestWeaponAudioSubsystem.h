@@ -0,0 +1,93 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestWeaponAudioSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+/** One pooled voice of a weapon */
+struct FFPTestWeaponVoice
+{
+	/** Owned by the weapon actor, so it goes away with the weapon */
+	TWeakObjectPtr<UAudioComponent> AudioComponent;
+
+	/** Sound the voice played last */
+	TObjectKey<USoundBase> Sound;
+
+	/** Time at which the sound is over */
+	double EndTime = 0.0;
+};
+
+/** Voices of one weapon */
+struct FFPTestWeaponVoicePool
+{
+	TArray<FFPTestWeaponVoice, TInlineAllocator<4>> Voices;
+};
+
+/**
+ * Plays the weapon sounds with a few reused audio components per weapon instead of a new component per sound
+ * Sounds out of hearing range of every local listener are culled, and every sound only plays a limited amount of times at once.
+ * Does not exist on dedicated servers, so they do no audio work at all
+ */
+UCLASS()
+class FPTEST_API UFPTestWeaponAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Plays the sound of the weapon at the location, returns false if it got culled */
+	bool PlayWeaponSound(const UObject* Weapon, USoundBase* Sound, const FVector& Location);
+
+	/** Stops the newest voice of the weapon which still plays the sound */
+	void StopWeaponSound(const UObject* Weapon, USoundBase* Sound);
+
+	/** Stops and forgets the voices of the weapon */
+	void ReleaseWeapon(const UObject* Weapon);
+
+	/** Plays the sound through the subsystem of the weapon's world, does nothing if there is none */
+	static void Play(const UObject* Weapon, USoundBase* Sound, const FVector& Location);
+
+	/** Stops the sound through the subsystem of the weapon's world, does nothing if there is none */
+	static void Stop(const UObject* Weapon, USoundBase* Sound);
+
+	int32 GetNumStarted() const { return NumStarted; }
+	int32 GetNumCulledByDistance() const { return NumCulledByDistance; }
+	int32 GetNumCulledByBudget() const { return NumCulledByBudget; }
+	int32 GetNumStolen() const { return NumStolen; }
+
+	/** Writes the stats to the log */
+	void LogStats() const;
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** True if a local listener is close enough to hear the sound */
+	bool IsAudible(const USoundBase& Sound, const FVector& Location) const;
+
+	/** Counts the voices of the sound which are still playing */
+	int32 CountActiveVoices(const USoundBase& Sound, double Now);
+
+	/** Voice of the weapon to play the next sound with, a free one or the one closest to finishing */
+	FFPTestWeaponVoice& AcquireVoice(AActor& WeaponActor, FFPTestWeaponVoicePool& Pool, double Now);
+
+	/** Voices per weapon */
+	TMap<TObjectKey<UObject>, FFPTestWeaponVoicePool> Pools;
+
+	/** End times of the playing voices per sound, for the voice budget */
+	TMap<TObjectKey<USoundBase>, TArray<double>> ActiveVoices;
+
+	int32 NumStarted = 0;
+	int32 NumCulledByDistance = 0;
+	int32 NumCulledByBudget = 0;
+	int32 NumStolen = 0;
+};
@@ -0,0 +1,70 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestWeaponDefinition.h"
+
+const FFPTestFireModeTable& UFPTestWeaponDefinition::GetFireModeTable() const
+{
+	// Definitions created at runtime never get loaded, so they are built on first use
+	if (!bFireModeTableBuilt)
+	{
+		BuildFireModeTable();
+	}
+	return FireModeTable;
+}
+
+TArray<FFPTestFireModeDefinition> UFPTestWeaponDefinition::GetDefaultFireModes()
+{
+	TArray<FFPTestFireModeDefinition> Defaults;
+
+	FFPTestFireModeDefinition& Single = Defaults.AddDefaulted_GetRef();
+	Single.ShootType = EWeaponShootType::Single;
+	Single.ImpactModifier = 1.0f;
+	Single.Damage = 2;
+
+	FFPTestFireModeDefinition& Automatic = Defaults.AddDefaulted_GetRef();
+	Automatic.ShootType = EWeaponShootType::Automatic;
+	Automatic.ImpactModifier = 0.5f;
+	Automatic.Damage = 1;
+	Automatic.Cooldown = 0.2f;
+	Automatic.MaxShotsPerFrame = 4;
+
+	FFPTestFireModeDefinition& Charged = Defaults.AddDefaulted_GetRef();
+	Charged.ShootType = EWeaponShootType::Charged;
+	Charged.ImpactModifier = 5.0f;
+	Charged.Damage = 4;
+
+	return Defaults;
+}
+
+const FFPTestFireModeTable& UFPTestWeaponDefinition::GetDefaultFireModeTable()
+{
+	static const FFPTestFireModeTable DefaultTable = []()
+	{
+		FFPTestFireModeTable Table;
+		Table.Build(GetDefaultFireModes());
+		return Table;
+	}();
+	return DefaultTable;
+}
+
+void UFPTestWeaponDefinition::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildFireModeTable();
+}
+
+#if WITH_EDITOR
+void UFPTestWeaponDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BuildFireModeTable();
+}
+#endif
+
+void UFPTestWeaponDefinition::BuildFireModeTable() const
+{
+	FireModeTable.Build(FireModes);
+	bFireModeTableBuilt = true;
+}
@@ -0,0 +1,110 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "FPTestFireModes.h"
+#include "FPTestWeaponTypes.h"
+#include "FPTestWeaponDefinition.generated.h"
+
+class UInputAction;
+class UFPTestPenetrationTable;
+
+/** One fire mode of a weapon as it is edited */
+USTRUCT(BlueprintType)
+struct FPTEST_API FFPTestFireModeDefinition
+{
+	GENERATED_BODY()
+
+	/** Shoot type, picks the fire path */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode")
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+
+	/** Modifier for the impulse applied to physics objects */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode")
+	float ImpactModifier = 1.0f;
+
+	/** Damage dealt to characters */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (ClampMin = "0"))
+	int32 Damage = 1;
+
+	/** Seconds between two shots, 0 for no cooldown */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (ClampMin = "0"))
+	float Cooldown = 0.0f;
+
+	/** Limit of shots in one simulation tick if the cooldown is shorter than a tick */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (ClampMin = "1"))
+	int32 MaxShotsPerFrame = 1;
+
+	/** Speed of the bullets in cm/s, they fly as projectiles with gravity and drag. 0 for an instant trace */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (ClampMin = "0", Units = "CentimetersPerSecond"))
+	float ProjectileSpeed = 0.0f;
+
+	/** Multiplier of the world gravity for the projectiles */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (EditCondition = "ProjectileSpeed > 0"))
+	float ProjectileGravityScale = 1.0f;
+
+	/** Part of the speed the projectiles lose per second */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode", meta = (ClampMin = "0", EditCondition = "ProjectileSpeed > 0"))
+	float ProjectileDrag = 0.0f;
+
+	/** Input action firing this mode, if not set the weapon uses its own action for the shoot type */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Fire Mode")
+	TObjectPtr<UInputAction> InputAction;
+};
+
+/**
+ * Stats and fire modes of a weapon
+ * The fire modes get flattened into a FFPTestFireModeTable on load, which all weapons using the definition share
+ */
+UCLASS(BlueprintType)
+class FPTEST_API UFPTestWeaponDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** How many ammunition the weapon can hold at Max */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay, meta = (ClampMin = "1"))
+	int32 MaxMagazine = 30;
+
+	/** End Distance of the Raycast for the Hit */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
+	float HitCastMaxDistance = 1000.0f;
+
+	/** Impulse to apply when hitting something */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
+	float HitImpulse = 100000.0f;
+
+	/** Which surfaces the shots go through, if not set they stop at the first hit */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
+	TObjectPtr<UFPTestPenetrationTable> PenetrationTable;
+
+	/** Surfaces and characters a shot goes through at most */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay, meta = (ClampMin = "0"))
+	int32 MaxPenetrations = 3;
+
+	/** Fire modes in the order ToggleType goes through them, the first one is selected when picked up */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
+	TArray<FFPTestFireModeDefinition> FireModes = GetDefaultFireModes();
+
+	/** Flattened fire modes */
+	const FFPTestFireModeTable& GetFireModeTable() const;
+
+	/** Fire modes of a weapon without definition, the values the weapon always had */
+	static TArray<FFPTestFireModeDefinition> GetDefaultFireModes();
+
+	/** Table of the default fire modes */
+	static const FFPTestFireModeTable& GetDefaultFireModeTable();
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	void BuildFireModeTable() const;
+
+	mutable FFPTestFireModeTable FireModeTable;
+	mutable bool bFireModeTableBuilt = false;
+};
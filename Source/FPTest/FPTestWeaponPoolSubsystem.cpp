@@ -0,0 +1,189 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestWeaponPoolSubsystem.h"
+#include "FPTestStats.h"
+#include "TP_PickUpComponent.h"
+#include "TP_WeaponComponent.h"
+#include "TP_WeaponSpawnerComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+AActor* UFPTestWeaponPoolSubsystem::AcquireWeapon(TSubclassOf<AActor> WeaponClass, const FTransform& Transform)
+{
+	if (!WeaponClass)
+	{
+		return nullptr;
+	}
+
+	AActor* Weapon = nullptr;
+	if (FFPTestWeaponPoolBucket* Bucket = Pools.Find(WeaponClass))
+	{
+		// Pooled weapons might have been destroyed from outside, e.g. by a level unload
+		while (Bucket->Actors.Num() > 0 && !Weapon)
+		{
+			AActor* Candidate = Bucket->Actors.Pop(false);
+			if (IsValid(Candidate))
+			{
+				Weapon = Candidate;
+			}
+		}
+	}
+
+	if (Weapon)
+	{
+		NumHits++;
+		Weapon->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	}
+	else
+	{
+		NumMisses++;
+		Weapon = SpawnWeapon(WeaponClass, Transform);
+		if (!Weapon)
+		{
+			return nullptr;
+		}
+	}
+
+	SetWeaponActive(Weapon, true);
+
+	// The pickup unregistered itself when it got picked up last time
+	if (UTP_PickUpComponent* PickupComponent = Weapon->FindComponentByClass<UTP_PickUpComponent>())
+	{
+		PickupComponent->ResetPickUp();
+	}
+
+	NumLive++;
+	FPTEST_SET_VALUE(ActiveWeapons, NumLive);
+	return Weapon;
+}
+
+void UFPTestWeaponPoolSubsystem::ReleaseWeapon(AActor* Weapon)
+{
+	if (!IsValid(Weapon))
+	{
+		return;
+	}
+
+	if (UTP_WeaponComponent* WeaponComponent = Weapon->FindComponentByClass<UTP_WeaponComponent>())
+	{
+		WeaponComponent->ResetForPool();
+	}
+
+	Weapon->SetOwner(nullptr);
+	SetWeaponActive(Weapon, false);
+
+	// Let the clients know it is gone once, then there is nothing to replicate while it waits in the pool
+	Weapon->SetNetDormancy(DORM_DormantAll);
+	Weapon->FlushNetDormancy();
+
+	Pools.FindOrAdd(Weapon->GetClass()).Actors.Add(Weapon);
+	NumLive = FMath::Max(NumLive - 1, 0);
+	FPTEST_SET_VALUE(ActiveWeapons, NumLive);
+}
+
+void UFPTestWeaponPoolSubsystem::Prewarm(TSubclassOf<AActor> WeaponClass, int32 Count)
+{
+	if (!WeaponClass)
+	{
+		return;
+	}
+
+	FFPTestWeaponPoolBucket& Bucket = Pools.FindOrAdd(WeaponClass);
+	while (Bucket.Actors.Num() < Count)
+	{
+		AActor* Weapon = SpawnWeapon(WeaponClass, FTransform::Identity);
+		if (!Weapon)
+		{
+			return;
+		}
+
+		// Like a released weapon, it replicates once and then waits dormant
+		SetWeaponActive(Weapon, false);
+		Weapon->SetNetDormancy(DORM_DormantAll);
+		Weapon->FlushNetDormancy();
+		Bucket.Actors.Add(Weapon);
+	}
+}
+
+int32 UFPTestWeaponPoolSubsystem::GetNumPooled() const
+{
+	int32 NumPooled = 0;
+	for (const TPair<TObjectPtr<UClass>, FFPTestWeaponPoolBucket>& Pool : Pools)
+	{
+		NumPooled += Pool.Value.Actors.Num();
+	}
+	return NumPooled;
+}
+
+void UFPTestWeaponPoolSubsystem::LogStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("WeaponPool: %d hits, %d misses, %d live, %d pooled in %d classes"),
+		NumHits, NumMisses, NumLive, GetNumPooled(), Pools.Num());
+}
+
+void UFPTestWeaponPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Clients get their weapons replicated, only the server spawns them
+	if (InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// Fill the pool for every spawner before the spawners spawn their first weapon
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+	{
+		TInlineComponentArray<UTP_WeaponSpawnerComponent*> Spawners(*It);
+		for (const UTP_WeaponSpawnerComponent* Spawner : Spawners)
+		{
+			FFPTestWeaponPoolBucket* Bucket = Pools.Find(Spawner->WeaponClass);
+			Prewarm(Spawner->WeaponClass, (Bucket ? Bucket->Actors.Num() : 0) + Spawner->PoolPrewarmCount);
+		}
+	}
+}
+
+bool UFPTestWeaponPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AActor* UFPTestWeaponPoolSubsystem::SpawnWeapon(TSubclassOf<AActor> WeaponClass, const FTransform& Transform) const
+{
+	UWorld* const World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	//Set Spawn Collision Handling Override
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<AActor>(WeaponClass, Transform, ActorSpawnParams);
+}
+
+void UFPTestWeaponPoolSubsystem::SetWeaponActive(AActor* Weapon, bool bActive)
+{
+	Weapon->SetActorHiddenInGame(!bActive);
+	Weapon->SetActorEnableCollision(bActive);
+	Weapon->SetActorTickEnabled(bActive && Weapon->PrimaryActorTick.bStartWithTickEnabled);
+
+	TInlineComponentArray<UActorComponent*> Components(Weapon);
+	for (UActorComponent* Component : Components)
+	{
+		Component->SetComponentTickEnabled(bActive && Component->PrimaryComponentTick.bStartWithTickEnabled);
+	}
+}
+
+static FAutoConsoleCommandWithWorld CmdFPTestWeaponPoolStats(
+	TEXT("FPTest.WeaponPool.Stats"),
+	TEXT("Logs the hits, misses and live count of the weapon pool."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UFPTestWeaponPoolSubsystem* WeaponPool = World ? World->GetSubsystem<UFPTestWeaponPoolSubsystem>() : nullptr)
+		{
+			WeaponPool->LogStats();
+		}
+	}));
@@ -0,0 +1,79 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FPTestWeaponPoolSubsystem.generated.h"
+
+/** Deactivated weapons of one class */
+USTRUCT()
+struct FFPTestWeaponPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> Actors;
+};
+
+/**
+ * Pool for weapon actors
+ * Spawners take their weapons from here and weapons which are not needed anymore are returned instead of destroyed,
+ * so respawning weapons does not spawn actors and does not create garbage
+ */
+UCLASS()
+class FPTEST_API UFPTestWeaponPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Hands out a pooled weapon of the class, only spawns one if the pool is empty */
+	AActor* AcquireWeapon(TSubclassOf<AActor> WeaponClass, const FTransform& Transform);
+
+	/** Deactivates the weapon and keeps it for later use */
+	void ReleaseWeapon(AActor* Weapon);
+
+	/** Makes sure there are at least Count deactivated weapons of the class */
+	void Prewarm(TSubclassOf<AActor> WeaponClass, int32 Count);
+
+	/** Amount of weapons which got handed out from the pool */
+	UFUNCTION(BlueprintCallable, Category = "Weapon Pool")
+	int32 GetNumHits() const { return NumHits; }
+
+	/** Amount of weapons which had to be spawned because the pool was empty */
+	UFUNCTION(BlueprintCallable, Category = "Weapon Pool")
+	int32 GetNumMisses() const { return NumMisses; }
+
+	/** Amount of weapons which are handed out right now */
+	UFUNCTION(BlueprintCallable, Category = "Weapon Pool")
+	int32 GetNumLive() const { return NumLive; }
+
+	/** Amount of deactivated weapons waiting in the pool */
+	UFUNCTION(BlueprintCallable, Category = "Weapon Pool")
+	int32 GetNumPooled() const;
+
+	/** Writes the stats to the log */
+	void LogStats() const;
+
+	// UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	// End of UWorldSubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Spawns a deactivated weapon */
+	AActor* SpawnWeapon(TSubclassOf<AActor> WeaponClass, const FTransform& Transform) const;
+
+	/** Enables or disables everything that makes the weapon part of the game */
+	static void SetWeaponActive(AActor* Weapon, bool bActive);
+
+	/** Deactivated weapons per class */
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FFPTestWeaponPoolBucket> Pools;
+
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+	int32 NumLive = 0;
+};
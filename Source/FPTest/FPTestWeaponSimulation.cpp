@@ -0,0 +1,369 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestWeaponSimulation.h"
+#include "FPTestFireModes.h"
+#include "FPTestWeaponDefinition.h"
+#include "TP_WeaponComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/UObjectIterator.h"
+
+void FFPTestWeaponSimulation::Reset(double Time, int32 InAmmo, int32 InMaxMagazine)
+{
+	Tick = FMath::FloorToInt64(Time / TickInterval);
+	NextFireTime = 0.0;
+	MaxMagazine = FMath::Max(InMaxMagazine, 0);
+	Ammo = FMath::Clamp(InAmmo, 0, MaxMagazine);
+	Commands.Reset();
+	NextCommand = 0;
+	Events.Reset();
+	bTriggerHeld = false;
+	bTriggeredThisTick = false;
+}
+
+void FFPTestWeaponSimulation::QueueCommand(const FFPTestWeaponCommand& Command)
+{
+	// Input for a tick which is already simulated goes into the next one
+	FFPTestWeaponCommand QueuedCommand = Command;
+	QueuedCommand.Time = FMath::Max(QueuedCommand.Time, GetTime());
+
+	// Input comes in order almost always, otherwise it is sorted in after the last command with the same or an earlier time
+	int32 Index = Commands.Num();
+	while (Index > NextCommand && Commands[Index - 1].Time > QueuedCommand.Time)
+	{
+		Index--;
+	}
+	Commands.Insert(QueuedCommand, Index);
+}
+
+void FFPTestWeaponSimulation::Advance(double Time, const FFPTestFireModeTable& FireModes)
+{
+	for (;;)
+	{
+		// Nothing happens in ticks without input and without a held trigger, so they are skipped
+		if (!bTriggerHeld)
+		{
+			const double SkipUntil = NextCommand < Commands.Num() ? FMath::Min(Time, Commands[NextCommand].Time) : Time;
+			Tick = FMath::Max(Tick, FMath::FloorToInt64(SkipUntil / TickInterval));
+		}
+
+		const double TickEnd = (Tick + 1) * TickInterval;
+		if (TickEnd > Time)
+		{
+			break;
+		}
+
+		while (NextCommand < Commands.Num() && Commands[NextCommand].Time < TickEnd)
+		{
+			ApplyCommand(Commands[NextCommand++], FireModes);
+		}
+
+		// Modes firing while held get triggered once per tick, no matter how many input events there were
+		if ((bTriggerHeld || bTriggeredThisTick) && HeldFireMode < FireModes.Num())
+		{
+			CurrentFireMode = HeldFireMode;
+			const FFPTestFireMode& FireMode = FireModes[HeldFireMode];
+			FireMode.Kernel->Triggered(*this, FireMode);
+		}
+		bTriggeredThisTick = false;
+
+		Tick++;
+	}
+
+	if (NextCommand >= Commands.Num())
+	{
+		Commands.Reset();
+		NextCommand = 0;
+	}
+}
+
+void FFPTestWeaponSimulation::ApplyCommand(const FFPTestWeaponCommand& Command, const FFPTestFireModeTable& FireModes)
+{
+	if (Command.Input == EFPTestWeaponInput::Reload)
+	{
+		if (Ammo < MaxMagazine)
+		{
+			Ammo = MaxMagazine;
+			AddEvent(EFPTestWeaponEventType::Reload, 0);
+		}
+		return;
+	}
+
+	if (Command.FireMode >= FireModes.Num())
+	{
+		return;
+	}
+
+	CurrentFireMode = Command.FireMode;
+	const FFPTestFireMode& FireMode = FireModes[Command.FireMode];
+
+	switch (Command.Input)
+	{
+	case EFPTestWeaponInput::Press:
+		FireMode.Kernel->Started(*this, FireMode);
+		break;
+	case EFPTestWeaponInput::Trigger:
+		if (FireMode.Kernel->bRepeatsWhileHeld)
+		{
+			bTriggerHeld = true;
+			bTriggeredThisTick = true;
+			HeldFireMode = Command.FireMode;
+		}
+		else
+		{
+			FireMode.Kernel->Triggered(*this, FireMode);
+		}
+		break;
+	case EFPTestWeaponInput::Release:
+		bTriggerHeld = false;
+		break;
+	default:
+		break;
+	}
+}
+
+void FFPTestWeaponSimulation::StartCooldown()
+{
+	// Time the trigger was released does not count as accumulated shots
+	NextFireTime = FMath::Max(NextFireTime, GetTime());
+}
+
+int32 FFPTestWeaponSimulation::ConsumeCooldown(float Interval, int32 MaxShots)
+{
+	const double Now = GetTime();
+	if (Now < NextFireTime)
+	{
+		return 0;
+	}
+
+	if (Interval <= 0.0f)
+	{
+		NextFireTime = Now;
+		return 1;
+	}
+
+	const int32 NumDue = 1 + FMath::FloorToInt32((Now - NextFireTime) / Interval);
+	if (NumDue > MaxShots)
+	{
+		// We fell too far behind, the trigger was not held since the last shot
+		// so we start over instead of firing the whole backlog at once
+		NextFireTime = Now + Interval;
+		return 1;
+	}
+
+	NextFireTime += NumDue * Interval;
+	return NumDue;
+}
+
+void FFPTestWeaponSimulation::Fire(const FFPTestFireMode& FireMode, int32 NumShots)
+{
+	if (Ammo <= 0)
+	{
+		AddEvent(EFPTestWeaponEventType::DryFire, 0);
+		return;
+	}
+
+	NumShots = FMath::Min(NumShots, Ammo);
+	Ammo -= NumShots;
+	AddEvent(EFPTestWeaponEventType::Shots, NumShots);
+}
+
+void FFPTestWeaponSimulation::StartCharging(const FFPTestFireMode& FireMode)
+{
+	AddEvent(EFPTestWeaponEventType::Charge, 0);
+}
+
+void FFPTestWeaponSimulation::AddEvent(EFPTestWeaponEventType Type, int32 NumShots)
+{
+	FFPTestWeaponEvent& Event = Events.AddDefaulted_GetRef();
+	Event.Tick = Tick;
+	Event.Type = Type;
+	Event.FireMode = CurrentFireMode;
+	Event.NumShots = NumShots;
+	Event.Ammo = Ammo;
+}
+
+FFPTestWeaponSimulation::FReplayResult FFPTestWeaponSimulation::Replay(TConstArrayView<FFPTestWeaponCommand> Commands, const FFPTestFireModeTable& FireModes, int32 MaxMagazine, float FrameRate)
+{
+	FReplayResult Result;
+	if (Commands.Num() == 0 || FrameRate <= 0.0f)
+	{
+		return Result;
+	}
+
+	const double StartTime = Commands[0].Time;
+	const double EndTime = Commands.Last().Time + 1.0;
+	const double FrameTime = 1.0 / FrameRate;
+
+	FFPTestWeaponSimulation Simulation;
+	Simulation.Reset(StartTime, MaxMagazine, MaxMagazine);
+
+	const auto Count = [&Simulation, &Result]()
+	{
+		for (const FFPTestWeaponEvent& Event : Simulation.GetEvents())
+		{
+			switch (Event.Type)
+			{
+			case EFPTestWeaponEventType::Shots:		Result.NumShots += Event.NumShots; break;
+			case EFPTestWeaponEventType::DryFire:	Result.NumDryFires++; break;
+			case EFPTestWeaponEventType::Charge:	Result.NumCharges++; break;
+			case EFPTestWeaponEventType::Reload:	Result.NumReloads++; break;
+			}
+		}
+		Simulation.ClearEvents();
+	};
+
+	// Every frame gets the input which happened until its end, like the input processing of a real frame
+	int32 NextCommand = 0;
+	for (int64 Frame = 1; StartTime + Frame * FrameTime < EndTime; Frame++)
+	{
+		const double Now = StartTime + Frame * FrameTime;
+		while (NextCommand < Commands.Num() && Commands[NextCommand].Time <= Now)
+		{
+			Simulation.QueueCommand(Commands[NextCommand++]);
+		}
+		Simulation.Advance(Now, FireModes);
+		Count();
+	}
+
+	// All frame rates end at the same time
+	while (NextCommand < Commands.Num())
+	{
+		Simulation.QueueCommand(Commands[NextCommand++]);
+	}
+	Simulation.Advance(EndTime, FireModes);
+	Count();
+
+	return Result;
+}
+
+namespace FPTestWeaponSimulation
+{
+	/** Input like a player would make it at 144 fps: single shots, a burst of automatic fire with a reload and a charged shot */
+	static TArray<FFPTestWeaponCommand> MakeExampleCommands(const FFPTestFireModeTable& FireModes)
+	{
+		TArray<FFPTestWeaponCommand> Commands;
+		const auto Add = [&Commands](double Time, EFPTestWeaponInput Input, int32 FireMode)
+		{
+			if (FireMode != INDEX_NONE)
+			{
+				Commands.Add({ Time, Input, static_cast<uint8>(FireMode) });
+			}
+		};
+
+		const double InputFrame = 1.0 / 144.0;
+		const int32 Single = FireModes.FindIndex(EWeaponShootType::Single);
+		const int32 Automatic = FireModes.FindIndex(EWeaponShootType::Automatic);
+		const int32 Charged = FireModes.FindIndex(EWeaponShootType::Charged);
+
+		for (int32 Shot = 0; Shot < 5; Shot++)
+		{
+			const double Time = 0.013 + Shot * 0.237;
+			Add(Time, EFPTestWeaponInput::Press, Single);
+			Add(Time, EFPTestWeaponInput::Trigger, Single);
+			Add(Time + 0.05, EFPTestWeaponInput::Release, Single);
+		}
+
+		Add(2.004, EFPTestWeaponInput::Press, Automatic);
+		for (double Time = 2.004; Time < 4.5; Time += InputFrame)
+		{
+			Add(Time, EFPTestWeaponInput::Trigger, Automatic);
+		}
+		Add(4.5, EFPTestWeaponInput::Release, Automatic);
+		Add(4.8, EFPTestWeaponInput::Reload, Automatic);
+
+		Add(5.51, EFPTestWeaponInput::Press, Charged);
+		Add(6.52, EFPTestWeaponInput::Trigger, Charged);
+		Add(6.6, EFPTestWeaponInput::Release, Charged);
+
+		return Commands;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdFPTestWeaponSimReplay(
+	TEXT("FPTest.WeaponSim.Replay"),
+	TEXT("Replays weapon input at several frame rates and checks that the shots are the same. Uses the input recorded with FPTest.WeaponSim.Record 1 by a weapon of the world, otherwise an example. Arguments: frame rates, 30 60 144 240 if none are given."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		TArray<float> FrameRates;
+		for (const FString& Arg : Args)
+		{
+			FrameRates.Add(FCString::Atof(*Arg));
+		}
+		if (FrameRates.Num() == 0)
+		{
+			FrameRates = { 30.0f, 60.0f, 144.0f, 240.0f };
+		}
+
+		const UTP_WeaponComponent* RecordedWeapon = nullptr;
+		for (TObjectIterator<UTP_WeaponComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == World && It->GetRecordedCommands().Num() > 0)
+			{
+				RecordedWeapon = *It;
+				break;
+			}
+		}
+
+		const FFPTestFireModeTable& FireModes = RecordedWeapon ? RecordedWeapon->GetFireModes() : UFPTestWeaponDefinition::GetDefaultFireModeTable();
+		const int32 MaxMagazine = RecordedWeapon ? RecordedWeapon->MaxMagazine : 30;
+		const TArray<FFPTestWeaponCommand> Commands = RecordedWeapon ? RecordedWeapon->GetRecordedCommands() : FPTestWeaponSimulation::MakeExampleCommands(FireModes);
+
+		UE_LOG(LogTemp, Display, TEXT("WeaponSim: replaying %d commands of %s"), Commands.Num(), RecordedWeapon ? *RecordedWeapon->GetPathName() : TEXT("the example"));
+
+		bool bIdentical = true;
+		FFPTestWeaponSimulation::FReplayResult FirstResult;
+		for (int32 Index = 0; Index < FrameRates.Num(); Index++)
+		{
+			const FFPTestWeaponSimulation::FReplayResult Result = FFPTestWeaponSimulation::Replay(Commands, FireModes, MaxMagazine, FrameRates[Index]);
+			UE_LOG(LogTemp, Display, TEXT("WeaponSim: %6.1f fps: %d shots, %d dry fires, %d charges, %d reloads"),
+				FrameRates[Index], Result.NumShots, Result.NumDryFires, Result.NumCharges, Result.NumReloads);
+
+			if (Index == 0)
+			{
+				FirstResult = Result;
+			}
+			else if (!(Result == FirstResult))
+			{
+				bIdentical = false;
+			}
+		}
+
+		if (bIdentical)
+		{
+			UE_LOG(LogTemp, Display, TEXT("WeaponSim: identical at all frame rates"));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("WeaponSim: results differ between frame rates"));
+		}
+	}));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPTestWeaponSimulationFrameRateTest, "FPTest.WeaponSimulation.FrameRateIndependent",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPTestWeaponSimulationFrameRateTest::RunTest(const FString& Parameters)
+{
+	const FFPTestFireModeTable& FireModes = UFPTestWeaponDefinition::GetDefaultFireModeTable();
+	const int32 MaxMagazine = 30;
+	const TArray<FFPTestWeaponCommand> Commands = FPTestWeaponSimulation::MakeExampleCommands(FireModes);
+
+	// The simulation ticks at 60, so that is what every other frame rate has to match
+	const FFPTestWeaponSimulation::FReplayResult Expected = FFPTestWeaponSimulation::Replay(Commands, FireModes, MaxMagazine, 60.0f);
+	TestTrue(TEXT("The example fires shots"), Expected.NumShots > 0);
+	TestTrue(TEXT("The example reloads"), Expected.NumReloads > 0);
+
+	for (const float FrameRate : { 30.0f, 60.0f, 144.0f, 240.0f })
+	{
+		const FFPTestWeaponSimulation::FReplayResult Result = FFPTestWeaponSimulation::Replay(Commands, FireModes, MaxMagazine, FrameRate);
+		TestEqual(FString::Printf(TEXT("Shots at %.0f fps"), FrameRate), Result.NumShots, Expected.NumShots);
+		TestEqual(FString::Printf(TEXT("Reloads at %.0f fps"), FrameRate), Result.NumReloads, Expected.NumReloads);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,162 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FFPTestFireMode;
+struct FFPTestFireModeTable;
+
+/** Trigger and weapon input, recorded with the time it happened */
+enum class EFPTestWeaponInput : uint8
+{
+	/** The trigger got pressed, the Started event of the input */
+	Press,
+	/** The trigger fired or is held, the Triggered event of the input */
+	Trigger,
+	/** The trigger got released, the Completed or Canceled event of the input */
+	Release,
+	Reload
+};
+
+/** One buffered input */
+struct FFPTestWeaponCommand
+{
+	/** World time the input happened at, decides the tick it gets simulated in */
+	double Time = 0.0;
+
+	EFPTestWeaponInput Input = EFPTestWeaponInput::Press;
+
+	/** Fire mode selected when the input happened */
+	uint8 FireMode = 0;
+};
+
+/** What the weapon has to do for a simulated tick */
+enum class EFPTestWeaponEventType : uint8
+{
+	/** Fire NumShots shots */
+	Shots,
+	/** The trigger got pulled with an empty magazine */
+	DryFire,
+	/** A charged shot got started */
+	Charge,
+	/** The magazine got refilled */
+	Reload
+};
+
+struct FFPTestWeaponEvent
+{
+	/** Tick of the simulation the event happened in */
+	int64 Tick = 0;
+
+	EFPTestWeaponEventType Type = EFPTestWeaponEventType::Shots;
+	uint8 FireMode = 0;
+	int32 NumShots = 0;
+
+	/** Predicted ammunition after the event */
+	int32 Ammo = 0;
+};
+
+/**
+ * Fire logic of a weapon at a fixed tick rate
+ * Input is buffered with its time and simulated in the tick the time falls into, so the shots only depend
+ * on when the input happened and not on the frame rate the input got processed or simulated at.
+ * The fire mode kernels run here, the weapon turns the resulting events into shots and effects.
+ * The simulation predicts ammunition and cooldown, the weapon corrects the ammunition when the server disagrees.
+ * No UObjects, so recorded input can be replayed without a world, see FPTest.WeaponSim.Replay
+ */
+class FPTEST_API FFPTestWeaponSimulation
+{
+public:
+	/** Ticks per second, the same on every machine */
+	static constexpr int32 TickRate = 60;
+	static constexpr double TickInterval = 1.0 / TickRate;
+
+	/** Starts over at the time, drops buffered input */
+	void Reset(double Time, int32 InAmmo, int32 InMaxMagazine);
+
+	/** Buffers input, it gets simulated with the tick its time falls into */
+	void QueueCommand(const FFPTestWeaponCommand& Command);
+
+	/** Simulates all ticks which ended before the time, the events of the ticks are added to GetEvents */
+	void Advance(double Time, const FFPTestFireModeTable& FireModes);
+
+	/** Events of the simulated ticks, in order */
+	const TArray<FFPTestWeaponEvent>& GetEvents() const { return Events; }
+	void ClearEvents() { Events.Reset(); }
+
+	/** Predicted ammunition */
+	int32 GetAmmo() const { return Ammo; }
+	void SetAmmo(int32 NewAmmo) { Ammo = FMath::Clamp(NewAmmo, 0, MaxMagazine); }
+
+	/** Next tick to simulate */
+	int64 GetTick() const { return Tick; }
+
+	/** Start time of the tick being simulated */
+	double GetTime() const { return Tick * TickInterval; }
+
+	/** If there is something left to simulate, otherwise Advance only moves the tick */
+	bool IsIdle() const { return NextCommand >= Commands.Num() && !bTriggerHeld; }
+
+	// Used by the fire mode kernels
+
+	/** Lets the next shot come right away if the cooldown already passed, called when the trigger gets pressed */
+	void StartCooldown();
+
+	/**
+	 * Returns how many shots are due with the interval and consumes them
+	 * The time of the next shot is advanced by whole intervals, so fire rates above the tick rate fire several shots in one tick
+	 */
+	int32 ConsumeCooldown(float Interval, int32 MaxShots);
+
+	/** Fires as many of the shots as the magazine has */
+	void Fire(const FFPTestFireMode& FireMode, int32 NumShots);
+
+	/** Starts a charged shot */
+	void StartCharging(const FFPTestFireMode& FireMode);
+
+	/** What a replay produced */
+	struct FReplayResult
+	{
+		int32 NumShots = 0;
+		int32 NumDryFires = 0;
+		int32 NumCharges = 0;
+		int32 NumReloads = 0;
+
+		bool operator==(const FReplayResult& Other) const
+		{
+			return NumShots == Other.NumShots && NumDryFires == Other.NumDryFires && NumCharges == Other.NumCharges && NumReloads == Other.NumReloads;
+		}
+	};
+
+	/** Simulates recorded input like a game running at the frame rate would, the input of a frame is processed at its end */
+	static FReplayResult Replay(TConstArrayView<FFPTestWeaponCommand> Commands, const FFPTestFireModeTable& FireModes, int32 MaxMagazine, float FrameRate);
+
+private:
+	void ApplyCommand(const FFPTestWeaponCommand& Command, const FFPTestFireModeTable& FireModes);
+	void AddEvent(EFPTestWeaponEventType Type, int32 NumShots);
+
+	/** Buffered input, sorted by time, everything before NextCommand is simulated */
+	TArray<FFPTestWeaponCommand> Commands;
+	int32 NextCommand = 0;
+
+	TArray<FFPTestWeaponEvent> Events;
+
+	int64 Tick = 0;
+
+	/** Time at which the next shot is allowed */
+	double NextFireTime = 0.0;
+
+	int32 Ammo = 0;
+	int32 MaxMagazine = 0;
+
+	/** Held trigger of a mode which keeps firing while held */
+	bool bTriggerHeld = false;
+	uint8 HeldFireMode = 0;
+
+	/** The trigger of a mode which keeps firing while held got triggered in this tick, it might be released again already */
+	bool bTriggeredThisTick = false;
+
+	/** Index of the fire mode in the table, set while a kernel runs */
+	uint8 CurrentFireMode = 0;
+};
@@ -0,0 +1,144 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "FPTestWeaponTypes.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/CoreNet.h"
+
+uint16 FFPTestShotPacket::CompressShotTime(double ServerTime)
+{
+	return static_cast<uint16>(static_cast<uint64>(FMath::Max(ServerTime, 0.0) * 1000.0) & 0xFFFF);
+}
+
+double FFPTestShotPacket::DecompressShotTime(double ServerTime) const
+{
+	// The difference is interpreted signed, so a client slightly ahead of the server does not wrap into the past
+	const int16 AgeMs = static_cast<int16>(CompressShotTime(ServerTime) - ShotTimeMs);
+	return ServerTime - AgeMs / 1000.0;
+}
+
+bool FFPTestShotPacket::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Origin with one decimal, that is more than enough for a muzzle location
+	bOutSuccess = SerializePackedVector<10, 24>(Origin, Ar);
+
+	// Direction as compressed pitch and yaw, the roll does not matter for a ray
+	uint16 Pitch = 0;
+	uint16 Yaw = 0;
+	if (Ar.IsSaving())
+	{
+		const FRotator Rotation = Direction.Rotation();
+		Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+		Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	}
+	Ar << Pitch;
+	Ar << Yaw;
+	if (Ar.IsLoading())
+	{
+		Direction = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f).Vector();
+	}
+
+	Ar << Sequence;
+	Ar << ShotTimeMs;
+
+	// Two bits are enough for the fire modes we have
+	static_assert(static_cast<uint8>(EWeaponShootType::Num) <= 4, "Fire mode does not fit into two bits anymore");
+	uint8 ShootTypeBits = static_cast<uint8>(ShootType);
+	Ar.SerializeBits(&ShootTypeBits, 2);
+	ShootType = static_cast<EWeaponShootType>(ShootTypeBits);
+
+	Ar << Ammo;
+	Ar << ReloadEpoch;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Bandwidth comparison
+
+namespace FPTestFireBandwidth
+{
+	// Rough cost of the function handle and bunch header of an RPC, the same for the old and the new RPC
+	static constexpr int32 RPCHeaderBits = 32;
+
+	// Rough cost of the handle of a changed replicated property
+	static constexpr int32 PropertyHeaderBits = 8;
+
+	static int64 MeasureBits(TFunctionRef<void(FNetBitWriter&)> Serialize)
+	{
+		FNetBitWriter Writer(nullptr, 8 * 1024);
+		Serialize(Writer);
+		return Writer.GetNumBits();
+	}
+}
+
+static void FPTestFireBandwidthCommand(const TArray<FString>& Args)
+{
+	using namespace FPTestFireBandwidth;
+
+	// Default is the rate of the default automatic fire mode with a cooldown of 0.2
+	const float ShotsPerSecond = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 5.0f;
+	const int32 NumObservers = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 63;
+	const float NetUpdateFrequency = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 100.0f;
+
+	FVector Start(1234.5f, -6789.1f, 150.3f);
+	FVector End(101234.5f, -6789.1f, 1150.3f);
+	float ImpactModifier = 0.5f;
+	int32 Damage = 1;
+
+	// Before: Server_FireTrace(FVector, FVector, float, int32) and All_FireVisual(FVector, FVector), both reliable
+	const int64 OldServerBits = RPCHeaderBits + MeasureBits([&](FNetBitWriter& Writer)
+	{
+		Writer << Start << End << ImpactModifier << Damage;
+	});
+	const int64 OldMulticastBits = RPCHeaderBits + MeasureBits([&](FNetBitWriter& Writer)
+	{
+		Writer << Start << End;
+	});
+
+	// After: Server_FireShot(FFPTestShotPacket) unreliable and the FireVisualState counter
+	FFPTestShotPacket Shot;
+	Shot.Origin = Start;
+	Shot.Direction = (End - Start).GetSafeNormal();
+	Shot.Sequence = 4242;
+	Shot.ShotTimeMs = 31337;
+	Shot.ShootType = EWeaponShootType::Automatic;
+	const int64 NewServerBits = RPCHeaderBits + MeasureBits([&](FNetBitWriter& Writer)
+	{
+		bool bSuccess = true;
+		Shot.NetSerialize(Writer, nullptr, bSuccess);
+	});
+
+	FFPTestFireVisualState VisualState;
+	VisualState.ShotCounter = 42;
+	VisualState.LastShotOrigin = Start;
+	VisualState.LastShotDirection = Shot.Direction;
+	const int64 NewStateBits = 3 * PropertyHeaderBits + MeasureBits([&](FNetBitWriter& Writer)
+	{
+		bool bSuccess = true;
+		Writer << VisualState.ShotCounter;
+		VisualState.LastShotOrigin.NetSerialize(Writer, nullptr, bSuccess);
+		VisualState.LastShotDirection.NetSerialize(Writer, nullptr, bSuccess);
+	});
+
+	// The multicast goes to every observer and the owner, for every shot
+	// The state goes to the same connections, but at most once per net update, no matter how many shots happened
+	const int32 NumReceivers = NumObservers + 1;
+	const float StateUpdatesPerSecond = FMath::Min(ShotsPerSecond, NetUpdateFrequency);
+
+	const double OldUpBytes = ShotsPerSecond * OldServerBits / 8.0;
+	const double OldDownBytes = ShotsPerSecond * OldMulticastBits * NumReceivers / 8.0;
+	const double NewUpBytes = ShotsPerSecond * NewServerBits / 8.0;
+	const double NewDownBytes = StateUpdatesPerSecond * NewStateBits * NumReceivers / 8.0;
+
+	UE_LOG(LogTemp, Display, TEXT("FireBandwidth: %.1f shots/s, %d observers, NetUpdateFrequency %.1f"), ShotsPerSecond, NumObservers, NetUpdateFrequency);
+	UE_LOG(LogTemp, Display, TEXT("FireBandwidth: per shot  before: server rpc %lld bits, multicast %lld bits | after: server rpc %lld bits, state update %lld bits"),
+		OldServerBits, OldMulticastBits, NewServerBits, NewStateBits);
+	UE_LOG(LogTemp, Display, TEXT("FireBandwidth: per weapon before: up %.1f B/s, down %.1f B/s (reliable) | after: up %.1f B/s, down %.1f B/s (replicated state)"),
+		OldUpBytes, OldDownBytes, NewUpBytes, NewDownBytes);
+}
+
+static FAutoConsoleCommand CmdFPTestFireBandwidth(
+	TEXT("FPTest.Net.FireBandwidth"),
+	TEXT("Compares the bytes per second per weapon of the old reliable fire RPCs and the quantized fire events.\n")
+	TEXT("Arguments: [ShotsPerSecond=5] [NumObservers=63] [NetUpdateFrequency=100]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPTestFireBandwidthCommand));
@@ -0,0 +1,111 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "FPTestWeaponTypes.generated.h"
+
+UENUM(BlueprintType)
+enum class EWeaponShootType : uint8
+{
+	Single,
+	Automatic,
+	Charged,
+	Num UMETA(Hidden)
+};
+
+/**
+ * Everything the server needs to know about a shot, sent unreliable
+ * The origin is quantized, the direction is sent as compressed pitch and yaw
+ * and the fire time as wrapped milliseconds, so a shot costs a fraction of two full precision vectors
+ */
+USTRUCT()
+struct FPTEST_API FFPTestShotPacket
+{
+	GENERATED_BODY()
+
+	/** Where the shot starts, quantized to a tenth of a unit */
+	FVector Origin = FVector::ZeroVector;
+
+	/** Normalized direction of the shot */
+	FVector Direction = FVector::ForwardVector;
+
+	/** Increases with every shot of the weapon, lets the server drop old and duplicated shots */
+	uint16 Sequence = 0;
+
+	/** Server time in milliseconds at which the client fired, wrapped to 16 bits */
+	uint16 ShotTimeMs = 0;
+
+	/** Fire mode the shot was fired with */
+	EWeaponShootType ShootType = EWeaponShootType::Single;
+
+	/** Ammunition the shooter predicted after the shot, the server corrects the shooter if it disagrees */
+	uint8 Ammo = 0;
+
+	/** Increases with every reload of the shooter, tells the server which magazine the shot came from */
+	uint8 ReloadEpoch = 0;
+
+	/** Wraps the server time to what is sent in ShotTimeMs */
+	static uint16 CompressShotTime(double ServerTime);
+
+	/** Unwraps ShotTimeMs relative to the current server time */
+	double DecompressShotTime(double ServerTime) const;
+
+	/** True if the sequence is newer than the other one, taking the wrap around into account */
+	static bool IsNewerSequence(uint16 Sequence, uint16 OtherSequence) { return static_cast<int16>(Sequence - OtherSequence) > 0; }
+
+	/** True if the reload epoch is newer than the other one, taking the wrap around into account */
+	static bool IsNewerReloadEpoch(uint8 Epoch, uint8 OtherEpoch) { return static_cast<int8>(Epoch - OtherEpoch) > 0; }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FFPTestShotPacket> : public TStructOpsTypeTraitsBase2<FFPTestShotPacket>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Shot the owner fired and played before the server answered, the shot sequence is its prediction key */
+struct FFPTestPredictedShot
+{
+	uint16 Sequence = 0;
+
+	/** If the effects of the shot got played, only a few are played per frame */
+	bool bPlayedVisual = false;
+};
+
+/**
+ * Replicated state which drives the cosmetic effects of a weapon
+ * Instead of a reliable multicast per event, the server increases a counter and the clients play
+ * the effects for every step the counter made. Multiple shots within one net update only cost one update
+ */
+USTRUCT(BlueprintType)
+struct FPTEST_API FFPTestFireVisualState
+{
+	GENERATED_BODY()
+
+	/** Increased for every shot the server accepted */
+	UPROPERTY()
+	uint8 ShotCounter = 0;
+
+	/** Increased for every reload */
+	UPROPERTY()
+	uint8 ReloadCounter = 0;
+
+	/** Increased every time a charged shot gets started */
+	UPROPERTY()
+	uint8 ChargeCounter = 0;
+
+	/** Origin of the last accepted shot */
+	UPROPERTY()
+	FVector_NetQuantize LastShotOrigin = FVector::ZeroVector;
+
+	/** Direction of the last accepted shot */
+	UPROPERTY()
+	FVector_NetQuantizeNormal LastShotDirection = FVector::ForwardVector;
+};
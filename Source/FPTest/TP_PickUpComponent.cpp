@@ -1,6 +1,8 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "TP_PickUpComponent.h"
+#include "FPTestPickUpSubsystem.h"
+#include "FPTestStats.h"
 
 UTP_PickUpComponent::UTP_PickUpComponent()
 {
@@ -12,20 +14,77 @@ void UTP_PickUpComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Let the pickup subsystem find the characters, moving characters then don't update overlaps against us
+	UFPTestPickUpSubsystem* PickUps = GetWorld()->GetSubsystem<UFPTestPickUpSubsystem>();
+	if (GFPTestPickUpSpatialHash != 0 && PickUps)
+	{
+		bUsesSpatialHash = true;
+		SetGenerateOverlapEvents(false);
+		PickUps->RegisterPickUp(this);
+		return;
+	}
+
 	// Register our Overlap Event
 	OnComponentBeginOverlap.AddDynamic(this, &UTP_PickUpComponent::OnSphereBeginOverlap);
 }
 
+void UTP_PickUpComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bUsesSpatialHash)
+	{
+		if (UFPTestPickUpSubsystem* PickUps = GetWorld()->GetSubsystem<UFPTestPickUpSubsystem>())
+		{
+			PickUps->UnregisterPickUp(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTP_PickUpComponent::ResetPickUp()
+{
+	if (bUsesSpatialHash)
+	{
+		// Also moves us to where the pool put the weapon
+		if (UFPTestPickUpSubsystem* PickUps = GetWorld()->GetSubsystem<UFPTestPickUpSubsystem>())
+		{
+			PickUps->RegisterPickUp(this);
+		}
+		return;
+	}
+
+	// Register our Overlap Event again, it got removed on the last pick up
+	OnComponentBeginOverlap.AddUniqueDynamic(this, &UTP_PickUpComponent::OnSphereBeginOverlap);
+}
+
+void UTP_PickUpComponent::NotifyPickUp(AFPTestCharacter* Character)
+{
+	// Notify that the actor is being picked up
+	FPTEST_COUNT(PickUps, 1);
+	OnPickUp.Broadcast(Character);
+
+	// Unregister so it is no longer triggered
+	if (bUsesSpatialHash)
+	{
+		if (UFPTestPickUpSubsystem* PickUps = GetWorld()->GetSubsystem<UFPTestPickUpSubsystem>())
+		{
+			PickUps->UnregisterPickUp(this);
+		}
+	}
+	else
+	{
+		OnComponentBeginOverlap.RemoveAll(this);
+	}
+}
+
 void UTP_PickUpComponent::OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	FPTEST_SCOPE(PickUpOverlap);
+
 	// Checking if it is a First Person Character overlapping
 	AFPTestCharacter* Character = Cast<AFPTestCharacter>(OtherActor);
 	if(Character != nullptr)
 	{
-		// Notify that the actor is being picked up
-		OnPickUp.Broadcast(Character);
-
-		// Unregister from the Overlap Event so it is no longer triggered
-		OnComponentBeginOverlap.RemoveAll(this);
+		NotifyPickUp(Character);
 	}
 }
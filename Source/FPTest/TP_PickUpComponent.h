@@ -23,12 +23,24 @@ public:
 	FOnPickUp OnPickUp;
 
 	UTP_PickUpComponent();
+
+	/** Makes the pickup work again after it got picked up, used when the weapon is reused from the pool */
+	void ResetPickUp();
+
+	/** Lets everybody know the character picked us up and stops reacting until ResetPickUp */
+	void NotifyPickUp(AFPTestCharacter* Character);
 protected:
 
 	/** Called when the game starts */
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** Code for when something overlaps this component */
 	UFUNCTION()
 	void OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+private:
+	/** If the pickup subsystem finds the characters instead of the overlap events */
+	bool bUsesSpatialHash = false;
 };
\ No newline at end of file
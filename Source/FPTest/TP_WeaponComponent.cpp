@@ -3,13 +3,44 @@
 
 #include "TP_WeaponComponent.h"
 #include "FPTestCharacter.h"
+#include "FPTestCosmetics.h"
+#include "FPTestDamageSubsystem.h"
+#include "FPTestFireModes.h"
+#include "FPTestImpulseSubsystem.h"
+#include "FPTestProjectileSubsystem.h"
+#include "FPTestReplicationGraph.h"
+#include "FPTestShotDebugSubsystem.h"
+#include "FPTestShotResolverSubsystem.h"
+#include "FPTestStats.h"
+#include "FPTestTelemetry.h"
+#include "FPTestWeaponAudioSubsystem.h"
+#include "FPTestWeaponDefinition.h"
+#include "FPTestWeaponPoolSubsystem.h"
+#include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerController.h"
 #include "Camera/PlayerCameraManager.h"
-#include "Kismet/GameplayStatics.h"
+#include "Engine/DemoNetDriver.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+static bool GFPTestRecordWeaponInput = false;
+static FAutoConsoleVariableRef CVarFPTestRecordWeaponInput(
+	TEXT("FPTest.WeaponSim.Record"),
+	GFPTestRecordWeaponInput,
+	TEXT("Records the input of locally controlled weapons for FPTest.WeaponSim.Replay."),
+	ECVF_Default);
+
+// Enough for a few minutes of automatic fire at 144 fps
+static constexpr int32 FPTestMaxRecordedCommands = 8192;
+
+// If many shots happen in one frame or net update, only this many of them play their effects
+static constexpr int32 FPTestMaxVisualShotsPerUpdate = 3;
+
+// Most shots waiting for an answer of the server, older ones got lost on the way
+static constexpr int32 FPTestMaxPredictedShots = 64;
 
 // Sets default values for this component's properties
 UTP_WeaponComponent::UTP_WeaponComponent()
@@ -18,68 +49,311 @@ UTP_WeaponComponent::UTP_WeaponComponent()
 	MuzzleOffset = FVector(100.0f, 0.0f, 10.0f);
 	// Set the Ammunition to be the Magazine Value
 	CurrentAmmunition = MaxMagazine;
+	// The simulation has its own tick, it only runs while there is input to simulate
+	SimulationTick.bCanEverTick = true;
+	SimulationTick.bStartWithTickEnabled = false;
+	SimulationTick.TickGroup = TG_PrePhysics;
+}
+
+void UTP_WeaponComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Remember where we are, a pooled weapon gets reattached there
+	InitialAttachParent = GetAttachParent();
+	InitialRelativeTransform = GetRelativeTransform();
+
+	// The definition replaces the stats set on the weapon
+	if (WeaponDefinition)
+	{
+		MaxMagazine = WeaponDefinition->MaxMagazine;
+		HitCastMaxDistance = WeaponDefinition->HitCastMaxDistance;
+		HitImpulse = WeaponDefinition->HitImpulse;
+		PenetrationTable = WeaponDefinition->PenetrationTable;
+		MaxPenetrations = WeaponDefinition->MaxPenetrations;
+		SetAmmunition(MaxMagazine);
+	}
+	else
+	{
+		BuildLegacyFireModes();
+	}
+
+	// Nobody sees the weapon move, the simulation tick is not affected
+	bCosmeticsStripped = FFPTestCosmetics::AreStripped(GetWorld());
+	if (bCosmeticsStripped)
+	{
+		FFPTestCosmetics::StripMesh(this);
+	}
+
+	CurrentFireMode = 0;
+	SetShootType(GetFireModes()[0].ShootType);
+	ResetSimulation();
+}
+
+
+void UTP_WeaponComponent::PressTrigger()
+{
+	OnFireModeStarted(CurrentFireMode);
+}
+
+void UTP_WeaponComponent::HoldTrigger()
+{
+	OnFireModeTriggered(CurrentFireMode);
 }
 
+void UTP_WeaponComponent::ReleaseTrigger()
+{
+	OnFireModeCompleted(CurrentFireMode);
+}
 
 void UTP_WeaponComponent::FireSingle()
 {
-	if (ShootType != EWeaponShootType::Single)
+	OnFireModeTriggered(GetFireModes().FindIndex(EWeaponShootType::Single));
+}
+
+void UTP_WeaponComponent::FireAutomatic()
+{
+	// Every call fired at most once before, so the trigger is released right away instead of held
+	const int32 FireModeIndex = GetFireModes().FindIndex(EWeaponShootType::Automatic);
+	OnFireModeTriggered(FireModeIndex);
+	OnFireModeCompleted(FireModeIndex);
+}
+
+void UTP_WeaponComponent::FireCharged()
+{
+	OnFireModeTriggered(GetFireModes().FindIndex(EWeaponShootType::Charged));
+}
+
+void UTP_WeaponComponent::StartFireCharged()
+{
+	OnFireModeStarted(GetFireModes().FindIndex(EWeaponShootType::Charged));
+}
+
+void UTP_WeaponComponent::BuildLegacyFireModes()
+{
+	// Only weapons which changed the old properties need their own table, everybody else shares the defaults
+	const FFPTestFireMode* DefaultAutomatic = UFPTestWeaponDefinition::GetDefaultFireModeTable().Find(EWeaponShootType::Automatic);
+	bUsesLegacyFireModes = DefaultAutomatic && (AutomaticCooldown != DefaultAutomatic->Cooldown || MaxAutomaticShotsPerFrame != DefaultAutomatic->MaxShotsPerFrame);
+	if (!bUsesLegacyFireModes)
+	{
 		return;
+	}
 
-	Fire_Internal(1.0f, 2);
+	TArray<FFPTestFireModeDefinition> FireModes = UFPTestWeaponDefinition::GetDefaultFireModes();
+	for (FFPTestFireModeDefinition& FireMode : FireModes)
+	{
+		if (FireMode.ShootType == EWeaponShootType::Automatic)
+		{
+			FireMode.Cooldown = FMath::Max(AutomaticCooldown, 0.0f);
+			FireMode.MaxShotsPerFrame = FMath::Max(MaxAutomaticShotsPerFrame, 1);
+		}
+	}
+	LegacyFireModes.Build(FireModes);
 }
 
-void UTP_WeaponComponent::FireAutomatic()
+void UTP_WeaponComponent::OnFireModeStarted(int32 FireModeIndex)
 {
-	if (ShootType != EWeaponShootType::Automatic || !CanShoot)
+	// Several modes can share an input action, only the selected one reacts
+	if (FireModeIndex != CurrentFireMode)
 		return;
 
+	QueueInput(EFPTestWeaponInput::Press);
+}
+
+void UTP_WeaponComponent::OnFireModeTriggered(int32 FireModeIndex)
+{
+	if (FireModeIndex != CurrentFireMode)
+		return;
+
+	QueueInput(EFPTestWeaponInput::Trigger);
+}
+
+void UTP_WeaponComponent::OnFireModeCompleted(int32 FireModeIndex)
+{
+	if (FireModeIndex != CurrentFireMode)
+		return;
+
+	QueueInput(EFPTestWeaponInput::Release);
+}
+
+void UTP_WeaponComponent::QueueInput(EFPTestWeaponInput Input)
+{
 	UWorld* const World = GetWorld();
 	if (!World)
 	{
 		return;
 	}
 
-	CanShoot = false;
+	// The kernels do not run right away anymore, the simulation runs them in the tick the input happened in
+	FFPTestWeaponCommand Command;
+	Command.Time = World->GetTimeSeconds();
+	Command.Input = Input;
+	Command.FireMode = static_cast<uint8>(CurrentFireMode);
+	Simulation.QueueCommand(Command);
+	SimulationTick.SetTickFunctionEnable(true);
+
+	if (GFPTestRecordWeaponInput && RecordedCommands.Num() < FPTestMaxRecordedCommands)
+	{
+		RecordedCommands.Add(Command);
+	}
+}
+
+void UTP_WeaponComponent::ResetSimulation()
+{
+	UWorld* const World = GetWorld();
+	Simulation.Reset(World ? World->GetTimeSeconds() : 0.0, CurrentAmmunition, MaxMagazine);
+}
 
-	// Add a Delegate to spawn the weapon after the delay
+void UTP_WeaponComponent::RegisterComponentTickFunctions(bool bRegister)
+{
+	Super::RegisterComponentTickFunctions(bRegister);
 
-	FTimerDelegate TimerDelegate;
-	TimerDelegate.BindLambda([&]
+	if (bRegister)
 	{
-		CanShoot = true;
-	});
+		if (SetupActorComponentTickFunction(&SimulationTick))
+		{
+			SimulationTick.Weapon = this;
+		}
+	}
+	else if (SimulationTick.IsTickFunctionRegistered())
+	{
+		SimulationTick.UnRegisterTickFunction();
+	}
+}
 
-	// Add the timer to have the Respawn Delay
+void UTP_WeaponComponent::TickSimulation()
+{
+	// Everybody else gets the shots from the server
+	UWorld* const World = GetWorld();
+	if (!World || !IsLocallyControlledOwner())
+	{
+		SimulationTick.SetTickFunctionEnable(false);
+		return;
+	}
 
-	FTimerHandle TimerHandle;
-	World->GetTimerManager().SetTimer(TimerHandle, TimerDelegate, AutomaticCooldown, false);
+	Simulation.Advance(World->GetTimeSeconds(), GetFireModes());
+	RunSimulationEvents();
 
-	Fire_Internal(0.5f, 1);
+	if (Simulation.IsIdle())
+	{
+		SimulationTick.SetTickFunctionEnable(false);
+	}
 }
 
+void FFPTestWeaponSimulationTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Weapon && IsValid(Weapon))
+	{
+		FActorComponentTickFunction::ExecuteTickHelper(Weapon, false, DeltaTime, TickType, [this](float DilatedTime)
+		{
+			Weapon->TickSimulation();
+		});
+	}
+}
 
-void UTP_WeaponComponent::FireCharged()
+FString FFPTestWeaponSimulationTickFunction::DiagnosticMessage()
 {
-	if (ShootType != EWeaponShootType::Charged)
-		return;
+	return Weapon ? Weapon->GetFullName() + TEXT("[TickSimulation]") : TEXT("<NULL>[TickSimulation]");
+}
 
-	Fire_Internal(5.0f, 4);
+FName FFPTestWeaponSimulationTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return Weapon ? Weapon->GetClass()->GetFName() : NAME_None;
 }
 
-void UTP_WeaponComponent::StartFireCharged()
+void UTP_WeaponComponent::RunSimulationEvents()
 {
-	if (ShootType != EWeaponShootType::Charged)
-		return;
+	const FFPTestFireModeTable& FireModes = GetFireModes();
+	for (const FFPTestWeaponEvent& Event : Simulation.GetEvents())
+	{
+		if (Event.FireMode >= FireModes.Num())
+		{
+			continue;
+		}
+
+		switch (Event.Type)
+		{
+		case EFPTestWeaponEventType::Shots:
+			Fire_Internal(FireModes[Event.FireMode], Event.NumShots, Event.Ammo);
+			break;
+		case EFPTestWeaponEventType::DryFire:
+			// we have got no ammo, so just play a sound and skip firing
+			if (NoAmmoSound != nullptr && Character && !bCosmeticsStripped)
+			{
+				UFPTestWeaponAudioSubsystem::Play(this, NoAmmoSound, Character->GetActorLocation());
+			}
+			break;
+		case EFPTestWeaponEventType::Charge:
+			StartCharging();
+			break;
+		case EFPTestWeaponEventType::Reload:
+			SetAmmunition(Event.Ammo);
+			OnAmmoChanged.Broadcast(CurrentAmmunition);
+
+			// Play it right away for ourself, the server lets the others know
+			// Shots from now on carry the new epoch, corrections for the old magazine would take the new one away again
+			LastReloadShotSequence = ShotSequence;
+			ReloadEpoch++;
+			PlayReloadEffects();
+			FPTEST_COUNT(RPCsSent, 1);
+			Server_Reload(ReloadEpoch, ShotSequence);
+			break;
+		}
+	}
+	Simulation.ClearEvents();
+}
+
+const FFPTestFireModeTable& UTP_WeaponComponent::GetFireModes() const
+{
+	if (WeaponDefinition)
+	{
+		const FFPTestFireModeTable& FireModes = WeaponDefinition->GetFireModeTable();
+		if (FireModes.Num() > 0)
+		{
+			return FireModes;
+		}
+	}
+	return bUsesLegacyFireModes ? LegacyFireModes : UFPTestWeaponDefinition::GetDefaultFireModeTable();
+}
+
+UInputAction* UTP_WeaponComponent::GetDefaultInputAction(EWeaponShootType FireType) const
+{
+	// Weapons set up before there were definitions have one action per shoot type
+	switch (FireType)
+	{
+	case EWeaponShootType::Single:
+		return FireSingleAction;
+	case EWeaponShootType::Automatic:
+		return FireAutomaticAction;
+	case EWeaponShootType::Charged:
+		return FireChargedAction;
+	default:
+		return nullptr;
+	}
+}
 
-	All_StartCharging();
+void UTP_WeaponComponent::StartCharging()
+{
+	// Play it right away for ourself, the server lets the others know
+	PlayChargeEffects();
+	FPTEST_COUNT(RPCsSent, 1);
+	Server_StartCharging();
 }
 
+float UTP_WeaponComponent::GetTraceDistance() const
+{
+	// The end location was always computed from the rotated MuzzleOffset times HitCastMaxDistance
+	// so the length of the offset is part of the distance, we keep it like that to not change the behavior
+	return MuzzleOffset.Size() * HitCastMaxDistance;
+}
 
-void UTP_WeaponComponent::Fire_Internal(float ImpactModifier, int32 Damage)
+void UTP_WeaponComponent::Fire_Internal(const FFPTestFireMode& FireMode, int32 NumShots, int32 AmmoAfterShots)
 {
+	FPTEST_SCOPE(FireInternal);
+
 	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Fire"));
 
+	// Checked once for all shots of the frame
 	if (Character == nullptr || Character->GetController() == nullptr)
 	{
 		return;
@@ -91,46 +365,70 @@ void UTP_WeaponComponent::Fire_Internal(float ImpactModifier, int32 Damage)
 		return;
 	}
 
-	// if Ammunition reaches 0, we play the NoAmmo Sound
-	// It would be extremely weird if the Ammunition reaches below zero
-	// But as other people might also work with this and a value like this could be manipulated throughout the code (Which is bad tbh, but hard to manage when working with a big team)
-	// we just catch also cases below 0 and reset it, just to be safe
-	if (CurrentAmmunition <= 0)
-	{
-		// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("No Ammo"));
-		CurrentAmmunition = 0;
-		// we have got no ammo, so just play a sound and skip firing
-		if (NoAmmoSound != nullptr)
-		{
-			UGameplayStatics::PlaySoundAtLocation(this, NoAmmoSound, Character->GetActorLocation());
-		}
-		return;
-	}
-
-	// Reduce ammunition by one
-	CurrentAmmunition--;
+	// The simulation already checked the magazine and took the shots from it
+	SetAmmunition(AmmoAfterShots);
+	FPTEST_COUNT(ShotsFired, NumShots);
 
 	OnAmmoChanged.Broadcast(CurrentAmmunition);
 
 	// This is the same logic as the Projectile firing
 	// we want to keep it as before and just transition to the line trace
+	// Bots have no camera, they aim with their control rotation
 	APlayerController* PlayerController = Cast<APlayerController>(Character->GetController());
-	const FRotator SpawnRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+	const FRotator SpawnRotation = PlayerController ? PlayerController->PlayerCameraManager->GetCameraRotation() : Character->GetControlRotation();
 
 	// For Forward Vector, we use the same logic as before, offsetting by MuzzleOffset
 	const FVector ForwardVector = SpawnRotation.RotateVector(MuzzleOffset);
 	const FVector StartLocation = GetOwner()->GetActorLocation() + ForwardVector;
 
-	// So for line tracing, we also need the forward Vector as well as the End Location
-	const FVector EndLocation = ((ForwardVector * HitCastMaxDistance) + StartLocation);
+	// The server time at which we fire, so the server can rewind the other characters to what we saw
+	const AGameStateBase* GameState = World->GetGameState();
+	const double ShotTime = GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
 
-	Server_FireTrace(StartLocation, EndLocation, ImpactModifier, Damage);
-}
+	// Instead of the end location we only send the direction, the server knows the trace distance
+	FFPTestShotPacket Shot;
+	Shot.Origin = StartLocation;
+	Shot.Direction = ForwardVector.GetSafeNormal();
+	Shot.ShotTimeMs = FFPTestShotPacket::CompressShotTime(ShotTime);
+	Shot.ShootType = FireMode.ShootType;
+	Shot.ReloadEpoch = ReloadEpoch;
+
+	// Without authority we do not wait for the server to play our shots, it confirms or rejects them later
+	const bool bPredicted = !GetOwner()->HasAuthority();
+	const FVector EndLocation = StartLocation + Shot.Direction * GetTraceDistance();
 
+	FPTEST_COUNT(RPCsSent, NumShots);
+	for (int32 Index = 0; Index < NumShots; Index++)
+	{
+		Shot.Sequence = ++ShotSequence;
+		// What we predict after this shot, the server checks it against its own count
+		Shot.Ammo = static_cast<uint8>(FMath::Clamp(AmmoAfterShots + NumShots - 1 - Index, 0, 255));
+
+		if (bPredicted)
+		{
+			if (PredictedShots.Num() >= FPTestMaxPredictedShots)
+			{
+				PredictedShots.RemoveAt(0, 1, false);
+			}
+
+			FFPTestPredictedShot& PredictedShot = PredictedShots.AddDefaulted_GetRef();
+			PredictedShot.Sequence = Shot.Sequence;
+			PredictedShot.bPlayedVisual = Index < FPTestMaxVisualShotsPerUpdate;
+			if (PredictedShot.bPlayedVisual)
+			{
+				PlayFireVisual(StartLocation, EndLocation);
+			}
+		}
+
+		Server_FireShot(Shot);
+	}
+}
 
-void UTP_WeaponComponent::Server_FireTrace_Implementation(FVector StartLocation, FVector EndLocation, float ImpactModifier, int32 Damage)
+void UTP_WeaponComponent::Server_FireShot_Implementation(const FFPTestShotPacket& Shot)
 {
-	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Server_FireTrace"));
+	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Server_FireShot"));
+	FPTEST_SCOPE(ServerFireShot);
+	FPTEST_COUNT(RPCsReceived, 1);
 
 	UWorld* const World = GetWorld();
 	if (!World)
@@ -138,56 +436,307 @@ void UTP_WeaponComponent::Server_FireTrace_Implementation(FVector StartLocation,
 		return;
 	}
 
+	// The RPC is unreliable, so drop anything older than what we already got
+	if (bHasReceivedShot && !FFPTestShotPacket::IsNewerSequence(Shot.Sequence, LastReceivedShotSequence))
+	{
+		RejectShot(Shot.Sequence);
+		return;
+	}
+
+	// A new owner counts its reloads from wherever its copy of the weapon is
+	if (!bHasReceivedShot)
+	{
+		ReceivedReloadEpoch = Shot.ReloadEpoch;
+		ReceivedReloadShotSequence = Shot.Sequence - 1;
+	}
+	bHasReceivedShot = true;
+	LastReceivedShotSequence = Shot.Sequence;
+
+	// The damage is not sent anymore, it is given by the fire mode
+	// A mode the weapon does not have can only come from a broken or modified client
+	const FFPTestFireMode* FireMode = GetFireModes().Find(Shot.ShootType);
+	if (!FireMode)
+	{
+		RejectShot(Shot.Sequence);
+		return;
+	}
+
 	// Do the line Trace going from the Start to the End
 	// This should mirror the behavior of the projectile before, but only as trace
+	const FVector StartLocation = Shot.Origin;
+	const FVector EndLocation = StartLocation + Shot.Direction * GetTraceDistance();
+
+	// The owner already took the ammunition, we keep track for everybody else
+	// Shots of remote owners are checked, we only trust what we simulated ourself
+	if (!IsLocallyControlledOwner())
+	{
+		if (Character == nullptr)
+		{
+			RejectShot(Shot.Sequence);
+			return;
+		}
 
-	All_FireVisual(StartLocation, EndLocation);
+		// The reload is reliable and the shots are not, so a shot after a reload can arrive before it
+		// The shot tells us about the reload already, the RPC only gives us the exact last shot before it
+		if (FFPTestShotPacket::IsNewerReloadEpoch(Shot.ReloadEpoch, ReceivedReloadEpoch))
+		{
+			ReceiveReload(Shot.ReloadEpoch, Shot.Sequence - 1);
+		}
+
+		// Shots of the magazine before the reload can still arrive after it, that magazine is gone so they are not checked against ours
+		// A working client cannot fire a shot of an old magazine after its reload
+		const bool bCurrentEpoch = Shot.ReloadEpoch == ReceivedReloadEpoch;
+		if (!bCurrentEpoch && FFPTestShotPacket::IsNewerSequence(Shot.Sequence, ReceivedReloadShotSequence))
+		{
+			RejectShot(Shot.Sequence);
+			return;
+		}
 
-	FHitResult OutHit;
-	FCollisionQueryParams CollisionParams;
-	if (World->LineTraceSingleByChannel(OutHit, StartLocation, EndLocation, COLLISION_SHOTTRACE, CollisionParams))
+		FFPTestShotContext Context;
+		Context.WeaponLocation = GetOwner()->GetActorLocation();
+		Context.AimDirection = Character->GetBaseAimRotation().Vector();
+		Context.MuzzleDistance = MuzzleOffset.Size();
+		Context.Interval = FireMode->Cooldown;
+		Context.Ammo = bCurrentEpoch ? CurrentAmmunition : 1;
+		Context.Time = World->GetTimeSeconds();
+
+		const EFPTestShotViolation Violations = ShotValidator.Validate(Shot, Context);
+		if (Violations != EFPTestShotViolation::None)
+		{
+			FFPTestShotValidator::CountViolations(Violations);
+			RejectShot(Shot.Sequence);
+			return;
+		}
+
+		if (bCurrentEpoch)
+		{
+			SetAmmunition(CurrentAmmunition - 1);
+		}
+		SetShootType(Shot.ShootType);
+
+		// Confirms the predicted shots of the owner up to this one
+		ConfirmedShotSequence = Shot.Sequence;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UTP_WeaponComponent, ConfirmedShotSequence, this);
+
+		// Lost shots or a lost reload let the prediction of the owner drift, tell it what we have
+		if (bCurrentEpoch && Shot.Ammo != FMath::Clamp(CurrentAmmunition, 0, 255))
+		{
+			FPTEST_COUNT(RPCsSent, 1);
+			Client_ReconcileAmmo(Shot.Sequence, ReceivedReloadEpoch, static_cast<uint8>(FMath::Clamp(CurrentAmmunition, 0, 255)));
+		}
+	}
+
+	// The clients play the visual once the counter replicates, we play it right away
+	FireVisualState.ShotCounter++;
+	FireVisualState.LastShotOrigin = StartLocation;
+	FireVisualState.LastShotDirection = Shot.Direction;
+	MarkFireVisualStateDirty();
+	PlayFireVisual(StartLocation, EndLocation);
+
+	const double ShotTime = Shot.DecompressShotTime(World->GetTimeSeconds());
+	if (FFPTestTelemetry::IsRecording())
+	{
+		FFPTestTelemetryRecord Record;
+		Record.Type = EFPTestTelemetryType::Shot;
+		Record.Time = World->GetTimeSeconds();
+		Record.ShooterId = Character ? Character->GetUniqueID() : 0;
+		Record.Location = FVector3f(StartLocation);
+		Record.SetDirection(Shot.Direction);
+		Record.Damage = static_cast<uint16>(FMath::Clamp(FireMode->Damage, 0, MAX_uint16));
+		Record.LatencyMs = static_cast<uint16>(FMath::Clamp((Record.Time - ShotTime) * 1000.0, 0.0, static_cast<double>(MAX_uint16)));
+		Record.Sequence = Shot.Sequence;
+		Record.ShootType = static_cast<uint8>(Shot.ShootType);
+		FFPTestTelemetry::Record(Record);
+	}
+
+	// Modes with a projectile speed fly, the projectile subsystem calls ApplyShotHit once they hit something
+	if (FireMode->ProjectileSpeed > 0.0f && UFPTestProjectileSubsystem::AreProjectilesEnabled())
 	{
-		if (!OutHit.bBlockingHit || !OutHit.Component.IsValid())
+		UFPTestProjectileSubsystem* Projectiles = World->GetSubsystem<UFPTestProjectileSubsystem>();
+		if (Projectiles && Projectiles->SpawnProjectile(this, *FireMode, StartLocation, Shot.Direction, ShotTime, Shot.Sequence))
+		{
 			return;
+		}
+	}
+
+	// The trace is not done right here anymore
+	// The resolver traces all shots of this frame in one batch and calls ApplyShotHit in the order the shots came in
+	if (UFPTestShotResolverSubsystem* ShotResolver = World->GetSubsystem<UFPTestShotResolverSubsystem>())
+	{
+		ShotResolver->QueueShot(this, StartLocation, EndLocation, FireMode->ImpactModifier, FireMode->Damage, FireMode->ShootType, ShotTime, Shot.Sequence);
+	}
+}
+
+void UTP_WeaponComponent::RejectShot(uint16 Sequence)
+{
+	FPTEST_COUNT(ShotsRejected, 1);
+
+	// Shots of a locally controlled owner are not predicted, there is nothing to roll back
+	if (IsLocallyControlledOwner())
+	{
+		return;
+	}
+
+	FPTEST_COUNT(RPCsSent, 1);
+	Client_RejectShot(Sequence, LastReceivedShotSequence, ReceivedReloadEpoch, static_cast<uint8>(FMath::Clamp(CurrentAmmunition, 0, 255)));
+}
+
+bool UTP_WeaponComponent::Server_FireShot_Validate(const FFPTestShotPacket& Shot)
+{
+	// Nothing a working client can send, the connection gets closed
+	return Shot.ShootType < EWeaponShootType::Num && !Shot.Origin.ContainsNaN();
+}
 
-		AFPTestCharacter* character = Cast< AFPTestCharacter>(OutHit.GetActor());
-		if (character)
+void UTP_WeaponComponent::Client_ReconcileAmmo_Implementation(uint16 Sequence, uint8 Epoch, uint8 ServerAmmo)
+{
+	FPTEST_COUNT(RPCsReceived, 1);
+	ReconcileAmmo(Sequence, Epoch, ServerAmmo);
+}
+
+void UTP_WeaponComponent::Client_RejectShot_Implementation(uint16 Sequence, uint16 ServerSequence, uint8 Epoch, uint8 ServerAmmo)
+{
+	FPTEST_COUNT(RPCsReceived, 1);
+	FPTEST_COUNT(ShotsRejected, 1);
+
+	const int32 Index = PredictedShots.IndexOfByPredicate([Sequence](const FFPTestPredictedShot& PredictedShot)
+	{
+		return PredictedShot.Sequence == Sequence;
+	});
+	if (Index != INDEX_NONE)
+	{
+		if (PredictedShots[Index].bPlayedVisual)
 		{
-			character->Server_OnDamageTaken(Damage);
+			RollBackShotVisual();
 		}
-		else if (OutHit.Component->IsSimulatingPhysics())
+		PredictedShots.RemoveAt(Index, 1, false);
+	}
+
+	// The server did not take ammunition for the shot, this gives it back
+	ReconcileAmmo(ServerSequence, Epoch, ServerAmmo);
+}
+
+void UTP_WeaponComponent::OnRep_ConfirmedShotSequence()
+{
+	// Shots are confirmed in order, unanswered shots before the confirmed one got lost on the way
+	// and the ammunition got corrected with the confirmed one already
+	const int32 NumPredicted = PredictedShots.Num();
+	PredictedShots.RemoveAll([this](const FFPTestPredictedShot& PredictedShot)
+	{
+		return !FFPTestShotPacket::IsNewerSequence(PredictedShot.Sequence, ConfirmedShotSequence);
+	});
+	FPTEST_COUNT(ShotsConfirmed, NumPredicted - PredictedShots.Num());
+}
+
+void UTP_WeaponComponent::RollBackShotVisual()
+{
+	if (!Character || bCosmeticsStripped)
+	{
+		return;
+	}
+
+	if (FireSound != nullptr)
+	{
+		UFPTestWeaponAudioSubsystem::Stop(this, FireSound);
+	}
+
+	if (FireAnimation != nullptr)
+	{
+		UAnimInstance* AnimInstance = Character->GetMesh1P()->GetAnimInstance();
+		if (AnimInstance != nullptr && AnimInstance->Montage_IsPlaying(FireAnimation))
 		{
-			// Just to keep the same behavior as before, we keep the Impulse
-			// Normally we would also deal damage, spawn a decal or do something else here
-			// but we keep it as that for now
-			OutHit.Component->AddImpulseAtLocation(-OutHit.ImpactNormal * HitImpulse * ImpactModifier, OutHit.Location);
+			AnimInstance->Montage_Stop(0.1f, FireAnimation);
 		}
-		// Also visualize
-		DrawDebugSphere(World, OutHit.Location, 10.0f, 32, FColor::Red, false, 1, 0, 1);
 	}
 }
 
-void UTP_WeaponComponent::All_FireVisual_Implementation(FVector StartLocation, FVector EndLocation)
+void UTP_WeaponComponent::ReconcileAmmo(uint16 Sequence, uint8 Epoch, uint8 ServerAmmo)
+{
+	// The server answered for a magazine before our last reload, it gets the reload too
+	if (Epoch != ReloadEpoch)
+	{
+		return;
+	}
+
+	// The shots we fired after that one did not reach the server yet when it answered
+	// Shots before the reload came from the old magazine, they do not count against the ammunition of the server
+	const uint16 FirstSequence = FFPTestShotPacket::IsNewerSequence(Sequence, LastReloadShotSequence) ? Sequence : LastReloadShotSequence;
+	const int32 ShotsSince = static_cast<uint16>(ShotSequence - FirstSequence);
+	const int32 ReconciledAmmo = FMath::Clamp(ServerAmmo - ShotsSince, 0, MaxMagazine);
+	if (ReconciledAmmo == CurrentAmmunition)
+	{
+		return;
+	}
+
+	Simulation.SetAmmo(ReconciledAmmo);
+	SetAmmunition(ReconciledAmmo);
+	OnAmmoChanged.Broadcast(CurrentAmmunition);
+}
+
+void UTP_WeaponComponent::ApplyShotHit(const FHitResult& OutHit, float ImpactModifier, int32 Damage, EWeaponShootType FiredShootType)
 {
+	UWorld* const World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	if (!OutHit.bBlockingHit || !OutHit.Component.IsValid())
+		return;
+
+	AFPTestCharacter* character = Cast< AFPTestCharacter>(OutHit.GetActor());
+	if (character)
+	{
+		FPTEST_COUNT(CharacterHits, 1);
+		// Applied at the end of the frame together with all other hits on the character
+		if (UFPTestDamageSubsystem* DamageSubsystem = World->GetSubsystem<UFPTestDamageSubsystem>())
+		{
+			DamageSubsystem->QueueDamage(character, Character, Damage, FiredShootType);
+		}
+	}
+	else if (OutHit.Component->IsSimulatingPhysics(OutHit.BoneName))
+	{
+		// Just to keep the same behavior as before, we keep the Impulse
+		// Normally we would also deal damage, spawn a decal or do something else here
+		// but we keep it as that for now
+		// Summed up with all other hits on the body and applied before the next physics step
+		if (UFPTestImpulseSubsystem* ImpulseSubsystem = World->GetSubsystem<UFPTestImpulseSubsystem>())
+		{
+			ImpulseSubsystem->QueueImpulse(OutHit.Component.Get(), OutHit.BoneName, -OutHit.ImpactNormal * HitImpulse * ImpactModifier, OutHit.Location);
+		}
+	}
+	// Also visualize, only recorded if shot debugging is on
+	FPTEST_SHOT_DEBUG_IMPACT(World, OutHit.Location);
+}
+
+void UTP_WeaponComponent::PlayFireVisual(FVector StartLocation, FVector EndLocation)
+{
+	FPTEST_SCOPE(FireVisual);
+
 	UWorld* const World = GetWorld();
 	if (!World || !Character)
 	{
 		return;
 	}
 
-	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("All_FireVisual"));
+	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("PlayFireVisual"));
+
+	// Visualize the Trace, only recorded if shot debugging is on
+	FPTEST_SHOT_DEBUG_TRACE(World, StartLocation, EndLocation);
 
-	// Visualize the Trace
-	DrawDebugLine(World, StartLocation, EndLocation, FColor::Green, false, 1, 0, 1);
+	// Far away or out of view characters play nothing, see UFPTestSignificanceSubsystem
+	if (bCosmeticsStripped || Character->GetSignificance() == EFPTestSignificance::Culled)
+	{
+		return;
+	}
 
-	// Try and play the sound if specified
+	// Try and play the sound if specified, pooled and culled by the weapon audio
 	if (FireSound != nullptr)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, FireSound, Character->GetActorLocation());
+		UFPTestWeaponAudioSubsystem::Play(this, FireSound, Character->GetActorLocation());
 	}
 
-	// Try and play a firing animation if specified
-	if (FireAnimation != nullptr)
+	// Try and play a firing animation if specified, the arms mesh is only seen by its owner
+	if (FireAnimation != nullptr && IsLocallyControlledOwner())
 	{
 		// Get the animation object for the arms mesh
 		UAnimInstance* AnimInstance = Character->GetMesh1P()->GetAnimInstance();
@@ -202,44 +751,155 @@ void UTP_WeaponComponent::Reload()
 {
 	// Normally this would trigger an animation which disables firing
 	// There was nothing like this written in the document, so I keep it simple
-	CurrentAmmunition = MaxMagazine;
+	// The simulation refills the magazine in order with the shots, see RunSimulationEvents
+	QueueInput(EFPTestWeaponInput::Reload);
+}
 
-	OnAmmoChanged.Broadcast(CurrentAmmunition);
+void UTP_WeaponComponent::ToggleType()
+{
+	// A held trigger does not carry over to the next mode
+	QueueInput(EFPTestWeaponInput::Release);
 
-	All_Reload();
+	// Go through the fire modes in the order of the table
+	const FFPTestFireModeTable& FireModes = GetFireModes();
+	CurrentFireMode = (CurrentFireMode + 1) % FireModes.Num();
+	SetShootType(FireModes[CurrentFireMode].ShootType);
+	FPTEST_COUNT(RPCsSent, 1);
+	Server_SetFireMode(static_cast<uint8>(CurrentFireMode));
 }
 
-void UTP_WeaponComponent::ToggleType()
+void UTP_WeaponComponent::Server_SetFireMode_Implementation(uint8 FireModeIndex)
 {
-	switch (ShootType)
+	FPTEST_COUNT(RPCsReceived, 1);
+
+	const FFPTestFireModeTable& FireModes = GetFireModes();
+	if (FireModeIndex >= FireModes.Num())
 	{
-	case EWeaponShootType::Single:
-		ShootType = EWeaponShootType::Automatic;
-		break;
-	case EWeaponShootType::Automatic:
-		ShootType = EWeaponShootType::Charged;
-		break;
-	case EWeaponShootType::Charged:
-		ShootType = EWeaponShootType::Single;
-		break;
+		return;
+	}
+
+	CurrentFireMode = FireModeIndex;
+	SetShootType(FireModes[CurrentFireMode].ShootType);
+}
+
+
+void UTP_WeaponComponent::Server_Reload_Implementation(uint8 Epoch, uint16 Sequence)
+{
+	FPTEST_COUNT(RPCsReceived, 1);
+
+	// A shot after the reload got here first and did the reload already, it could only guess the last shot before it
+	if (Epoch == ReceivedReloadEpoch && bHasReceivedShot)
+	{
+		ReceivedReloadShotSequence = Sequence;
+		return;
+	}
+
+	ReceiveReload(Epoch, Sequence);
+}
+
+void UTP_WeaponComponent::ReceiveReload(uint8 Epoch, uint16 Sequence)
+{
+	// Older reloads got skipped by a shot of a newer epoch, the magazine is already full
+	if (bHasReceivedShot && !FFPTestShotPacket::IsNewerReloadEpoch(Epoch, ReceivedReloadEpoch))
+	{
+		return;
+	}
+	ReceivedReloadEpoch = Epoch;
+	ReceivedReloadShotSequence = Sequence;
+
+	FireVisualState.ReloadCounter++;
+	MarkFireVisualStateDirty();
+
+	// The owner already reloaded and played it locally
+	if (!IsLocallyControlledOwner())
+	{
+		SetAmmunition(MaxMagazine);
+		PlayReloadEffects();
+	}
+}
+
+void UTP_WeaponComponent::Server_StartCharging_Implementation()
+{
+	FPTEST_COUNT(RPCsReceived, 1);
+	FireVisualState.ChargeCounter++;
+	MarkFireVisualStateDirty();
+
+	// The owner already played it locally
+	if (!IsLocallyControlledOwner())
+	{
+		PlayChargeEffects();
+	}
+}
+
+void UTP_WeaponComponent::OnRep_FireVisualState()
+{
+	// The counters before the update are the ones we saw last, not the ones the engine had
+	// On the first update the engine compares against the default state, which would replay shots fired long ago
+	const FFPTestFireVisualState OldState = SeenFireVisualState;
+	const bool bFirstState = !bHasSeenFireVisualState;
+	SeenFireVisualState = FireVisualState;
+	bHasSeenFireVisualState = true;
+
+	// Joining, coming back into relevancy or loading a replay checkpoint only takes over the counters
+	if (bFirstState)
+	{
+		return;
+	}
+
+	// Scrubbing a replay jumps over many shots at once, only the state matters there
+	const UWorld* const World = GetWorld();
+	if (World && World->IsPlayingReplay() && World->GetDemoNetDriver() && World->GetDemoNetDriver()->IsFastForwarding())
+	{
+		return;
+	}
+
+	// Counters wrap around, so the difference is taken as uint8
+	// If many shots got coalesced into one update, we only play a few of them
+	const uint8 NewShots = FMath::Min<uint8>(static_cast<uint8>(FireVisualState.ShotCounter - OldState.ShotCounter), FPTestMaxVisualShotsPerUpdate);
+	const FVector StartLocation = FireVisualState.LastShotOrigin;
+	const FVector EndLocation = StartLocation + FireVisualState.LastShotDirection * GetTraceDistance();
+	for (uint8 Index = 0; Index < NewShots; Index++)
+	{
+		PlayFireVisual(StartLocation, EndLocation);
+	}
+
+	// The owner does not get the state, it predicts everything itself
+	// This only stays for a character which just became locally controlled
+	if (IsLocallyControlledOwner())
+	{
+		return;
+	}
+
+	if (FireVisualState.ReloadCounter != OldState.ReloadCounter)
+	{
+		PlayReloadEffects();
+	}
+
+	if (FireVisualState.ChargeCounter != OldState.ChargeCounter)
+	{
+		PlayChargeEffects();
 	}
 }
 
+bool UTP_WeaponComponent::IsLocallyControlledOwner() const
+{
+	return Character != nullptr && Character->IsLocallyControlled();
+}
 
-void UTP_WeaponComponent::All_Reload_Implementation()
+void UTP_WeaponComponent::PlayReloadEffects()
 {
-	if (ReloadSound != nullptr && Character)
+	if (ReloadSound != nullptr && Character && !bCosmeticsStripped && Character->GetSignificance() != EFPTestSignificance::Culled)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ReloadSound, Character->GetActorLocation());
+		UFPTestWeaponAudioSubsystem::Play(this, ReloadSound, Character->GetActorLocation());
 	}
 }
 
 
-void UTP_WeaponComponent::All_StartCharging_Implementation()
+void UTP_WeaponComponent::PlayChargeEffects()
 {
-	if (ChargeSound != nullptr && Character)
+	if (ChargeSound != nullptr && Character && !bCosmeticsStripped && Character->GetSignificance() != EFPTestSignificance::Culled)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ChargeSound, Character->GetActorLocation());
+		UFPTestWeaponAudioSubsystem::Play(this, ChargeSound, Character->GetActorLocation());
 	}
 }
 
@@ -252,12 +912,13 @@ void UTP_WeaponComponent::AttachWeapon(AFPTestCharacter* TargetCharacter)
 
 	// Set the owner of the Weapon to the Character
 	// This allows us to receive Input as the client is now the owner
-	// But this would lead in PC games to cheating, where it would be possible to manipulate values
-	// like the magazine, which is now handled by the weapon
-	// We can leave it as it is as it was not a requirement
-	// but I still want to point out the issue
+	// The client only predicts values like the magazine, the server keeps its own
+	// and checks every shot of the client, see FFPTestShotValidator
 	GetOwner()->SetOwner(TargetCharacter);
 
+	// The weapon was dormant while it was lying around
+	GetOwner()->SetNetDormancy(DORM_Awake);
+
 	// If the Character already has a weapon, we destroy ourself
 	if (TargetCharacter->GetHasRifle())
 	{
@@ -265,11 +926,19 @@ void UTP_WeaponComponent::AttachWeapon(AFPTestCharacter* TargetCharacter)
 		return;
 	}
 
-	Character = TargetCharacter;
+	SetCharacter(TargetCharacter);
+	Character->SetWeapon(this);
+	ResetSimulation();
 
 	// Attach the weapon to the First Person Character
 	FAttachmentTransformRules AttachmentRules(EAttachmentRule::SnapToTarget, true);
 	AttachToComponent(Character->GetMesh1P(), AttachmentRules, FName(TEXT("GripPoint")));
+
+	// From now on the weapon is relevant whenever the character is
+	if (UFPTestReplicationGraph* ReplicationGraph = UFPTestReplicationGraph::Get(GetWorld()))
+	{
+		ReplicationGraph->OnWeaponAttached(GetOwner(), Character);
+	}
 	
 	// switch bHasRifle so the animation blueprint can switch to another animation set
 	Character->SetHasRifle(true);
@@ -285,11 +954,20 @@ void UTP_WeaponComponent::AttachWeapon(AFPTestCharacter* TargetCharacter)
 
 		if (UEnhancedInputComponent* EnhancedInputComponent = Cast<UEnhancedInputComponent>(PlayerController->InputComponent))
 		{
-			// Fire
-			EnhancedInputComponent->BindAction(FireSingleAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::FireSingle);
-			EnhancedInputComponent->BindAction(FireAutomaticAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::FireAutomatic);
-			EnhancedInputComponent->BindAction(FireChargedAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::FireCharged);
-			EnhancedInputComponent->BindAction(FireChargedAction, ETriggerEvent::Started, this, &UTP_WeaponComponent::StartFireCharged);
+			// Fire, every mode gets its action bound with its index, the kernel of the mode decides what happens
+			const FFPTestFireModeTable& FireModes = GetFireModes();
+			for (int32 FireModeIndex = 0; FireModeIndex < FireModes.Num(); FireModeIndex++)
+			{
+				const UInputAction* FireAction = FireModes.GetInputAction(FireModeIndex);
+				if (!FireAction)
+				{
+					FireAction = GetDefaultInputAction(FireModes[FireModeIndex].ShootType);
+				}
+				EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Started, this, &UTP_WeaponComponent::OnFireModeStarted, FireModeIndex);
+				EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::OnFireModeTriggered, FireModeIndex);
+				EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Completed, this, &UTP_WeaponComponent::OnFireModeCompleted, FireModeIndex);
+				EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Canceled, this, &UTP_WeaponComponent::OnFireModeCompleted, FireModeIndex);
+			}
 			// Reload
 			EnhancedInputComponent->BindAction(ReloadAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::Reload);
 			// Toggle Type
@@ -301,16 +979,69 @@ void UTP_WeaponComponent::AttachWeapon(AFPTestCharacter* TargetCharacter)
 void UTP_WeaponComponent::DestroySelf()
 {
 	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Destroy Weapon"));
+
+	// Return the weapon to the pool so the spawners can reuse it
+	if (UFPTestWeaponPoolSubsystem* WeaponPool = GetWorld() ? GetWorld()->GetSubsystem<UFPTestWeaponPoolSubsystem>() : nullptr)
+	{
+		WeaponPool->ReleaseWeapon(GetOwner());
+		return;
+	}
+
 	GetOwner()->Destroy();
 }
 
+void UTP_WeaponComponent::ResetForPool()
+{
+	if (Character != nullptr)
+	{
+		RemoveInputMapping();
+		SetCharacter(nullptr);
+	}
+
+	if (UFPTestReplicationGraph* ReplicationGraph = UFPTestReplicationGraph::Get(GetWorld()))
+	{
+		ReplicationGraph->OnWeaponDetached(GetOwner());
+	}
+
+	if (InitialAttachParent && GetAttachParent() != InitialAttachParent)
+	{
+		AttachToComponent(InitialAttachParent, FAttachmentTransformRules::KeepRelativeTransform);
+	}
+	else if (!InitialAttachParent && GetAttachParent())
+	{
+		// Otherwise it stays on the arms of the last character
+		DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+	SetRelativeTransform(InitialRelativeTransform);
+
+	SetAmmunition(MaxMagazine);
+	CurrentFireMode = 0;
+	SetShootType(GetFireModes()[0].ShootType);
+	bHasReceivedShot = false;
+	LastReloadShotSequence = ShotSequence;
+	PredictedShots.Reset();
+	ShotValidator.Reset();
+	ResetSimulation();
+	RecordedCommands.Reset();
+}
+
 void UTP_WeaponComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	if (UFPTestWeaponAudioSubsystem* WeaponAudio = GetWorld() ? GetWorld()->GetSubsystem<UFPTestWeaponAudioSubsystem>() : nullptr)
+	{
+		WeaponAudio->ReleaseWeapon(this);
+	}
+
 	if (Character == nullptr)
 	{
 		return;
 	}
 
+	RemoveInputMapping();
+}
+
+void UTP_WeaponComponent::RemoveInputMapping()
+{
 	if (APlayerController* PlayerController = Cast<APlayerController>(Character->GetController()))
 	{
 		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
@@ -326,5 +1057,56 @@ void UTP_WeaponComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	// Add properties to replicated for the derived class
-	DOREPLIFETIME(UTP_WeaponComponent, Character);
+	// All of them are push based, they are only compared when they got marked dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UTP_WeaponComponent, Character, Params);
+
+	// The owner predicts these itself, it plays its own shots when it fires them
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UTP_WeaponComponent, CurrentAmmunition, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UTP_WeaponComponent, ShootType, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UTP_WeaponComponent, FireVisualState, Params);
+
+	// Only the owner has shots to confirm
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UTP_WeaponComponent, ConfirmedShotSequence, Params);
+}
+
+void UTP_WeaponComponent::SetCharacter(AFPTestCharacter* NewCharacter)
+{
+	if (Character == NewCharacter)
+	{
+		return;
+	}
+
+	Character = NewCharacter;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UTP_WeaponComponent, Character, this);
+}
+
+void UTP_WeaponComponent::SetAmmunition(int32 NewAmmunition)
+{
+	if (CurrentAmmunition == NewAmmunition)
+	{
+		return;
+	}
+
+	CurrentAmmunition = NewAmmunition;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UTP_WeaponComponent, CurrentAmmunition, this);
+}
+
+void UTP_WeaponComponent::SetShootType(EWeaponShootType NewShootType)
+{
+	if (ShootType == NewShootType)
+	{
+		return;
+	}
+
+	ShootType = NewShootType;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UTP_WeaponComponent, ShootType, this);
+}
+
+void UTP_WeaponComponent::MarkFireVisualStateDirty()
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME(UTP_WeaponComponent, FireVisualState, this);
 }
\ No newline at end of file
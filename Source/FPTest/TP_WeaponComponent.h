@@ -4,9 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "FPTestWeaponTypes.h"
+#include "FPTestFireModes.h"
+#include "FPTestShotValidation.h"
+#include "FPTestWeaponSimulation.h"
 #include "TP_WeaponComponent.generated.h"
 
 class AFPTestCharacter;
+class UFPTestWeaponDefinition;
+class UFPTestPenetrationTable;
+class UInputAction;
 
 // I dislike usage of channels for this in c++, because code-wise, you have no idea if this is really the correct trace channel you want
 // you need to manually check the .ini file and check in there
@@ -15,12 +22,30 @@ class AFPTestCharacter;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnAmmoChanged, int32, NewAmmo);
 
-UENUM(BlueprintType)
-enum class EWeaponShootType : uint8
+/**
+ * Runs the weapon simulation, separate from the tick of the mesh
+ * The mesh keeps ticking its pose and animation, while this only ticks while there is input to simulate
+ */
+USTRUCT()
+struct FFPTestWeaponSimulationTickFunction : public FTickFunction
 {
-	Single,
-	Automatic,
-	Charged
+	GENERATED_BODY()
+
+	/** Weapon to simulate */
+	class UTP_WeaponComponent* Weapon = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FFPTestWeaponSimulationTickFunction> : public TStructOpsTypeTraitsBase2<FFPTestWeaponSimulationTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
 };
 
 UCLASS(Blueprintable, BlueprintType, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
@@ -60,15 +85,19 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputMappingContext* FireMappingContext;
 
-	/** Fire Single Input Action */
+	/** Stats and fire modes, if not set the weapon uses its own stats and the default fire modes */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
+	TObjectPtr<UFPTestWeaponDefinition> WeaponDefinition;
+
+	/** Fire Single Input Action, used by the Single fire mode if the definition has no action for it */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* FireSingleAction;
 
-	/** Fire Automatic Input Action */
+	/** Fire Automatic Input Action, used by the Automatic fire mode if the definition has no action for it */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* FireAutomaticAction;
 
-	/** Fire Charged Input Action */
+	/** Fire Charged Input Action, used by the Charged fire mode if the definition has no action for it */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* FireChargedAction;
 
@@ -88,21 +117,33 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
 	float HitImpulse = 100000.0f;
 
+	/** Which surfaces the shots go through, if not set they stop at the first hit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
+	TObjectPtr<UFPTestPenetrationTable> PenetrationTable;
+
+	/** Surfaces and characters a shot goes through at most */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay, meta = (ClampMin = "0"))
+	int32 MaxPenetrations = 3;
+
 	/** How many ammunition the weapon can hold at Max */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
 	int32 MaxMagazine = 30;
 
-	/** Cooldown for Automatic Shot */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
+	/** Cooldown for Automatic Shot, only used without a WeaponDefinition and read when the game starts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay, meta = (DeprecatedProperty, DeprecationMessage = "Set the Cooldown of the Automatic fire mode in a WeaponDefinition instead."))
 	float AutomaticCooldown = 0.2f;
 
-	/** Ammunition the weapon holds currently */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
+	/** Limit of automatic shots in one frame, only used without a WeaponDefinition and read when the game starts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay, meta = (DeprecatedProperty, DeprecationMessage = "Set the MaxShotsPerFrame of the Automatic fire mode in a WeaponDefinition instead."))
+	int32 MaxAutomaticShotsPerFrame = 4;
+
+	/** Ammunition the weapon holds currently, the owner predicts it and the others get it from the server */
+	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
 	int CurrentAmmunition = 0;
 
 
-	/** How many ammunition the weapon can hold at Max */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
+	/** Shoot type of the selected fire mode, the others get it from the shots the server received */
+	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
 	EWeaponShootType ShootType = EWeaponShootType::Single;
 
 
@@ -110,6 +151,14 @@ public:
 	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadOnly)
 	AFPTestCharacter* Character;
 
+	/** Counters and last shot, drives the cosmetic effects on the clients */
+	UPROPERTY(ReplicatedUsing = OnRep_FireVisualState, VisibleAnywhere, BlueprintReadOnly, Category = Gameplay)
+	FFPTestFireVisualState FireVisualState;
+
+	/** Sequence of the last shot the server accepted, only the owner gets it to confirm its predicted shots */
+	UPROPERTY(ReplicatedUsing = OnRep_ConfirmedShotSequence)
+	uint16 ConfirmedShotSequence = 0;
+
 	/** Sets default values for this component's properties */
 	UTP_WeaponComponent();
 
@@ -117,32 +166,67 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Weapon")
 	void AttachWeapon(AFPTestCharacter* TargetCharacter);
 
-	/** Fire a single Shot */
+	/** Presses the trigger of the selected fire mode, like the Started event of its input */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
-	void FireSingle();
+	void PressTrigger();
 
-	/** Fire a single Shot */
+	/** Triggers the selected fire mode, like the Triggered event of its input. Modes firing while held keep firing until ReleaseTrigger */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
-	void FireAutomatic();
+	void HoldTrigger();
 
-	/** Fire a charged Shot */
+	/** Releases the trigger, like the Completed event of its input */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	void ReleaseTrigger();
+
+	/** Fire a single Shot, if the Single fire mode is selected */
+	UFUNCTION(BlueprintCallable, Category = "Weapon", meta = (DeprecatedFunction, DeprecationMessage = "Use PressTrigger, HoldTrigger and ReleaseTrigger instead."))
+	void FireSingle();
+
+	/** Fire an automatic Shot if the cooldown allows it, if the Automatic fire mode is selected */
+	UFUNCTION(BlueprintCallable, Category = "Weapon", meta = (DeprecatedFunction, DeprecationMessage = "Use PressTrigger, HoldTrigger and ReleaseTrigger instead."))
+	void FireAutomatic();
+
+	/** Fire a charged Shot, if the Charged fire mode is selected */
+	UFUNCTION(BlueprintCallable, Category = "Weapon", meta = (DeprecatedFunction, DeprecationMessage = "Use PressTrigger, HoldTrigger and ReleaseTrigger instead."))
 	void FireCharged();
 
-	/** Start a charged Shot */
-	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	/** Start a charged Shot, if the Charged fire mode is selected */
+	UFUNCTION(BlueprintCallable, Category = "Weapon", meta = (DeprecatedFunction, DeprecationMessage = "Use PressTrigger, HoldTrigger and ReleaseTrigger instead."))
 	void StartFireCharged();
 
-	/** Common function for firing all */
-	void Fire_Internal(float ImpactModifier, int32 Damage);
+	/** Common function for firing all, sends NumShots shots of the mode, the simulation already took the ammunition */
+	void Fire_Internal(const FFPTestFireMode& FireMode, int32 NumShots, int32 AmmoAfterShots);
+
+	/** Plays the charge effects and tells the server about it */
+	void StartCharging();
 
-	/** Do the fire logic on the server */
-	UFUNCTION(Server, reliable, BlueprintCallable, Category = "Weapon")
-	void Server_FireTrace(FVector StartLocation, FVector EndLocation, float ImpactModifier, int32 Damage);
+	/** Input recorded while FPTest.WeaponSim.Record is set, for FPTest.WeaponSim.Replay */
+	const TArray<FFPTestWeaponCommand>& GetRecordedCommands() const { return RecordedCommands; }
 
-	/* Do the Visual for everyone  */
-	UFUNCTION(NetMulticast, reliable, BlueprintCallable, Category = "Weapon")
-	void All_FireVisual(FVector StartLocation, FVector EndLocation);
+	/** Fire modes of the weapon, from the definition or the defaults */
+	const FFPTestFireModeTable& GetFireModes() const;
+
+	/** Do the fire logic on the server, unreliable as a lost shot is better than a stalled reliable buffer */
+	UFUNCTION(Server, unreliable, WithValidation)
+	void Server_FireShot(const FFPTestShotPacket& Shot);
+
+	/** The server had different ammunition after the shot than we predicted, we take it and subtract the shots it did not get yet. Dropped if we reloaded after Epoch */
+	UFUNCTION(Client, unreliable)
+	void Client_ReconcileAmmo(uint16 Sequence, uint8 Epoch, uint8 ServerAmmo);
+
+	/** The server did not accept the predicted shot, we roll it back. ServerAmmo is what the server had after ServerSequence in Epoch */
+	UFUNCTION(Client, unreliable)
+	void Client_RejectShot(uint16 Sequence, uint16 ServerSequence, uint8 Epoch, uint8 ServerAmmo);
+
+	/** Applies the blocking hit of a resolved shot trace, only called on the server. FiredShootType is the mode the shot was fired with */
+	void ApplyShotHit(const FHitResult& OutHit, float ImpactModifier, int32 Damage, EWeaponShootType FiredShootType);
+
+	/* Plays the visuals of a shot locally */
+	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	void PlayFireVisual(FVector StartLocation, FVector EndLocation);
+
+	/** Length of the shot trace */
+	float GetTraceDistance() const;
 
 	/** Make the weapon Reload */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
@@ -152,28 +236,162 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	void ToggleType();
 
-	/** Call of Reload executed for everyone to handle visual or sound */
-	UFUNCTION(netMulticast, reliable, BlueprintCallable, Category = "Weapon")
-	void All_Reload();
+	/** Tells the server about the reload, so the other clients get the effects. Sequence is the last shot before the reload */
+	UFUNCTION(Server, reliable)
+	void Server_Reload(uint8 Epoch, uint16 Sequence);
+
+	/** Tells the server about the fire mode switch, so the replicated shoot type follows it */
+	UFUNCTION(Server, reliable)
+	void Server_SetFireMode(uint8 FireModeIndex);
 
-	/** Call of Charge executed for everyone to handle visual or sound */
-	UFUNCTION(netMulticast, reliable, BlueprintCallable, Category = "Weapon")
-	void All_StartCharging();
+	/** Tells the server about the charge, so the other clients get the effects */
+	UFUNCTION(Server, unreliable)
+	void Server_StartCharging();
+
+	/** Plays the reload visual or sound locally */
+	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	void PlayReloadEffects();
+
+	/** Plays the charge visual or sound locally */
+	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	void PlayChargeEffects();
 
 	/** Attaches the actor to a FirstPersonCharacter */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	void DestroySelf();
 
+	/** Puts the weapon back into the state it was spawned with, called when it gets returned to the pool */
+	void ResetForPool();
+
 protected:
+	/** Called when the game starts */
+	virtual void BeginPlay() override;
+
 	/** Ends gameplay for this component. */
 	UFUNCTION()
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	/** Registers the simulation tick next to the tick of the mesh */
+	virtual void RegisterComponentTickFunctions(bool bRegister) override;
+
 	// Override Replicate Properties function
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	/** Plays the effects for everything that happened since the state we saw last */
+	UFUNCTION()
+	void OnRep_FireVisualState();
+
+	/** Drops the predicted shots the server accepted */
+	UFUNCTION()
+	void OnRep_ConfirmedShotSequence();
+
 
 private:
-	/** Boolean just for the cooldown */
-	bool CanShoot = true;
+	friend struct FFPTestWeaponSimulationTickFunction;
+
+	/** Runs the weapon simulation on the machine controlling the character */
+	void TickSimulation();
+
+	/** Removes the fire mapping context from the character we are attached to */
+	void RemoveInputMapping();
+
+	/** Input events of the fire modes, only passed on if the mode is selected */
+	void OnFireModeStarted(int32 FireModeIndex);
+	void OnFireModeTriggered(int32 FireModeIndex);
+	void OnFireModeCompleted(int32 FireModeIndex);
+
+	/** Buffers the input for the simulation with the current time */
+	void QueueInput(EFPTestWeaponInput Input);
+
+	/** Starts the simulation over with our ammunition */
+	void ResetSimulation();
+
+	/** Turns the events of the simulated ticks into shots and effects */
+	void RunSimulationEvents();
+
+	/** Server side, counts the shot as not fired and tells the owner */
+	void RejectShot(uint16 Sequence);
+
+	/** Takes the ammunition the server had after the shot, minus the shots we fired since */
+	void ReconcileAmmo(uint16 Sequence, uint8 Epoch, uint8 ServerAmmo);
+
+	/** Server side, refills the magazine for a reload of the owner unless we already got it */
+	void ReceiveReload(uint8 Epoch, uint16 Sequence);
+
+	/** Stops the effects of a rejected shot if they are still playing */
+	void RollBackShotVisual();
+
+	/** Builds LegacyFireModes if the deprecated automatic properties got changed */
+	void BuildLegacyFireModes();
+
+	/** Own input action for the shoot type, for fire modes without an action */
+	UInputAction* GetDefaultInputAction(EWeaponShootType FireType) const;
+
+	/** Index of the selected fire mode in the fire mode table */
+	int32 CurrentFireMode = 0;
+
+	/** Default fire modes with AutomaticCooldown and MaxAutomaticShotsPerFrame, for weapons set up before there were definitions */
+	FFPTestFireModeTable LegacyFireModes;
+	bool bUsesLegacyFireModes = false;
+
+	/** Setters for the replicated properties, they are push based and only marked dirty when they change */
+	void SetCharacter(AFPTestCharacter* NewCharacter);
+	void SetAmmunition(int32 NewAmmunition);
+	void SetShootType(EWeaponShootType NewShootType);
+	void MarkFireVisualStateDirty();
+
+	/** Parent we got spawned attached to, we attach back to it when we get pooled */
+	UPROPERTY()
+	TObjectPtr<USceneComponent> InitialAttachParent;
+
+	/** Relative transform we got spawned with */
+	FTransform InitialRelativeTransform;
+
+	/** True if our character is controlled on this machine, it plays its own effects right away */
+	bool IsLocallyControlledOwner() const;
+
+	/** Set where nobody looks, see FFPTestCosmetics. No sounds or montages get played */
+	bool bCosmeticsStripped = false;
+
+	/** Fire logic at a fixed tick, input goes in, shots come out */
+	FFPTestWeaponSimulation Simulation;
+
+	/** Only enabled while there is input to simulate, the primary tick stays with the mesh */
+	FFPTestWeaponSimulationTickFunction SimulationTick;
+
+	/** Input recorded for replays */
+	TArray<FFPTestWeaponCommand> RecordedCommands;
+
+	/** Sequence of the last shot before our last reload, shots up to it came from the old magazine */
+	uint16 LastReloadShotSequence = 0;
+
+	/** Increased with every reload we simulate, sent with the shots. Server answers for an older one are dropped */
+	uint8 ReloadEpoch = 0;
+
+	/** Sequence of the last shot we sent */
+	uint16 ShotSequence = 0;
+
+	/** Shots we played but the server did not confirm or reject yet, oldest first */
+	TArray<FFPTestPredictedShot> PredictedShots;
+
+	/** Sequence of the last shot the server received */
+	uint16 LastReceivedShotSequence = 0;
+
+	/** If the server received any shot yet, the first one is always accepted */
+	bool bHasReceivedShot = false;
+
+	/** Latest reload epoch of the owner the server knows of, only shots of it are checked against our ammunition */
+	uint8 ReceivedReloadEpoch = 0;
+
+	/** Last shot of the owner before that reload, shots of an older epoch after it cannot exist */
+	uint16 ReceivedReloadShotSequence = 0;
+
+	/** Fire visual state of the last update we got, the effects are played for the steps since then */
+	FFPTestFireVisualState SeenFireVisualState;
+
+	/** False until the first fire visual state arrived, that one only sets the counters */
+	bool bHasSeenFireVisualState = false;
+
+	/** Server side checks of the shots of a remote owner */
+	FFPTestShotValidator ShotValidator;
 };
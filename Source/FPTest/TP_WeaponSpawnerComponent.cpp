@@ -2,6 +2,9 @@
 
 #include "TP_WeaponSpawnerComponent.h"
 #include "TP_PickupComponent.h"
+#include "FPTestCooldownSubsystem.h"
+#include "FPTestStats.h"
+#include "FPTestWeaponPoolSubsystem.h"
 
 UTP_WeaponSpawnerComponent::UTP_WeaponSpawnerComponent()
 {
@@ -16,37 +19,46 @@ void UTP_WeaponSpawnerComponent::BeginPlay()
 
 void UTP_WeaponSpawnerComponent::SpawnWeapon()
 {
+	FPTEST_SCOPE(SpawnWeapon);
+
 	UWorld* const World = GetWorld();
 	if (!World)
 	{
 		return;
 	}
 
-	//Set Spawn Collision Handling Override
-	FActorSpawnParameters ActorSpawnParams;
-	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	UFPTestWeaponPoolSubsystem* WeaponPool = World->GetSubsystem<UFPTestWeaponPoolSubsystem>();
+	if (!WeaponPool)
+	{
+		return;
+	}
 
 	// Spawn at the Position of the WeaponSpawnerComponent
 	// So with this the Spawner can be offset from the ActorPosition
 	const FRotator SpawnRotation = FRotator::ZeroRotator;
 	const FVector SpawnLocation = GetComponentLocation();
 
-	// Now spawn it
-	AActor* SpawnedWeapon = World->SpawnActor<AActor>(WeaponClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
-	if (!SpawnedWeapon)
+	// Now take it from the pool, it only gets spawned if the pool is empty
+	AActor* Weapon = WeaponPool->AcquireWeapon(WeaponClass, FTransform(SpawnRotation, SpawnLocation));
+	if (!Weapon)
 	{
 		return;
 	}
+	SpawnedWeapon = Weapon;
+
+	// Nothing changes on a weapon lying around, so it only replicates once and then goes dormant until picked up
+	Weapon->SetNetDormancy(DORM_DormantAll);
+	Weapon->FlushNetDormancy();
 
 	// Check for the Pickup Component
-	UTP_PickUpComponent* PickupComponent = SpawnedWeapon->GetComponentByClass<UTP_PickUpComponent>();
+	UTP_PickUpComponent* PickupComponent = Weapon->GetComponentByClass<UTP_PickUpComponent>();
 	if (!PickupComponent)
 	{
 		return;
 	}
 
 	// Add a Callback so we can spawn another Weapon once picked up
-	PickupComponent->OnPickUp.AddDynamic(this, &UTP_WeaponSpawnerComponent::OnPickUp);
+	PickupComponent->OnPickUp.AddUniqueDynamic(this, &UTP_WeaponSpawnerComponent::OnPickUp);
 }
 
 void UTP_WeaponSpawnerComponent::OnPickUp(AFPTestCharacter* Character)
@@ -63,18 +75,22 @@ void UTP_WeaponSpawnerComponent::OnPickUp(AFPTestCharacter* Character)
 		return;
 	}
 
+	// The weapon is not ours anymore, if it gets returned to the pool another spawner might use it
+	if (AActor* Weapon = SpawnedWeapon.Get())
+	{
+		if (UTP_PickUpComponent* PickupComponent = Weapon->GetComponentByClass<UTP_PickUpComponent>())
+		{
+			PickupComponent->OnPickUp.RemoveDynamic(this, &UTP_WeaponSpawnerComponent::OnPickUp);
+		}
+	}
+	SpawnedWeapon.Reset();
+
 	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("OnPickUp"));
 
-	// Add a Delegate to spawn the weapon after the delay
+	// Let the cooldown subsystem spawn the weapon after the respawn delay
 
-	FTimerDelegate TimerDelegate;
-	TimerDelegate.BindLambda([&]
+	if (UFPTestCooldownSubsystem* Cooldowns = World->GetSubsystem<UFPTestCooldownSubsystem>())
 	{
-		SpawnWeapon();
-	});
-
-	// Add the timer to have the Respawn Delay
-
-	FTimerHandle TimerHandle;
-	World->GetTimerManager().SetTimer(TimerHandle, TimerDelegate, WeaponRespawnTimerInSeconds, false);
+		Cooldowns->ScheduleRespawn(this, WeaponRespawnTimerInSeconds);
+	}
 }
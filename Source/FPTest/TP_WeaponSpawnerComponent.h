@@ -24,16 +24,24 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Weapon)
 	float WeaponRespawnTimerInSeconds = 5.0f;
 
+	/** How many weapons the pool creates for this spawner when the map is loaded */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Weapon)
+	int32 PoolPrewarmCount = 2;
+
+	/** Code to spawn the Weapon, also called by the cooldown subsystem once the respawn delay passed */
+	UFUNCTION()
+	void SpawnWeapon();
+
 protected:
 
 	/** Called when the game starts */
 	virtual void BeginPlay() override;
 
-	/** Code to spawn the Weapon */
-	UFUNCTION()
-	void SpawnWeapon();
-
 	/** Callback for when the weapon is picked up */
 	UFUNCTION()
 	void OnPickUp(AFPTestCharacter* Character);
+
+private:
+	/** The weapon we spawned last, we stop listening to it once it is picked up as it might get reused by the pool */
+	TWeakObjectPtr<AActor> SpawnedWeapon;
 };
\ No newline at end of file
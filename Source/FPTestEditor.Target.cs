@@ -14,5 +14,8 @@ public class FPTestEditorTarget : TargetRules
         IncludeOrderVersion = EngineIncludeOrderVersion.Latest;
 
         ExtraModuleNames.Add("FPTest");
+
+        // Weapon and character state is replicated push based
+        bWithPushModel = true;
 	}
 }